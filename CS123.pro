@@ -40,6 +40,15 @@ SOURCES += \
     shapes/ExampleShape.cpp \
     shapes/ExampleShape2.cpp \
     shapes/JelloCube.cpp \
+    shapes/Checkpoint.cpp \
+    shapes/JelloEnsemble.cpp \
+    shapes/LatticeBenchmark.cpp \
+    shapes/LatticeLayout.cpp \
+    shapes/ParameterSweep.cpp \
+    shapes/Trajectory.cpp \
+    shapes/SurfaceSubdivision.cpp \
+    shapes/EmbeddedMesh.cpp \
+    shapes/EnergyMonitor.cpp \
     shapes/JelloUtil.cpp \
     shapes/OpenGLShape.cpp \
     shapes/Shape.cpp \
@@ -52,11 +61,18 @@ SOURCES += \
     ui/Databinding.cpp \
     lib/CS123XmlSceneParser.cpp \
     lib/ResourceLoader.cpp \
+    lib/MappedFile.cpp \
+    lib/SkyboxLibrary.cpp \
+    lib/FrameWriter.cpp \
+    lib/AllocationTracker.cpp \
+    lib/PerformanceMonitor.cpp \
+    lib/Profiler.cpp \
     gl/shaders/Shader.cpp \
     gl/GLDebug.cpp \
     gl/datatype/VBOAttribMarker.cpp \
     gl/datatype/VBO.cpp \
     gl/datatype/IBO.cpp \
+    gl/datatype/UBO.cpp \
     gl/datatype/VAO.cpp \
     gl/datatype/FBO.cpp \
     gl/textures/Texture.cpp \
@@ -65,8 +81,14 @@ SOURCES += \
     gl/textures/TextureParametersBuilder.cpp \
     gl/textures/RenderBuffer.cpp \
     gl/textures/DepthBuffer.cpp \
+    gl/textures/CubeMapLoader.cpp \
     gl/shaders/CS123Shader.cpp \
+    gl/shaders/FrameUniforms.cpp \
+    gl/shaders/ProgramBinaryCache.cpp \
     gl/util/FullScreenQuad.cpp \
+    gl/util/GeometryCache.cpp \
+    gl/util/PixelReadback.cpp \
+    gl/util/GpuProfiler.cpp \
     main.cpp \
     glew-1.10.0/src/glew.c \
     lib/RGBA.cpp
@@ -91,10 +113,20 @@ HEADERS += \
     shapes/ExampleShape.h \
     shapes/ExampleShape2.h \
     shapes/JelloCube.h \
+    shapes/Checkpoint.h \
+    shapes/JelloEnsemble.h \
+    shapes/LatticeBenchmark.h \
+    shapes/LatticeLayout.h \
+    shapes/ParameterSweep.h \
+    shapes/Trajectory.h \
+    shapes/SurfaceSubdivision.h \
+    shapes/EmbeddedMesh.h \
+    shapes/EnergyMonitor.h \
     shapes/JelloUtil.h \
     shapes/OpenGLShape.h \
     shapes/Shape.h \
     shapes/SpringMassCube.h \
+    shapes/SpringStencil.h \
     ui/Canvas2D.h \
     ui/SupportCanvas2D.h \
     ui/SupportCanvas3D.h \
@@ -105,9 +137,11 @@ HEADERS += \
     gl/shaders/Shader.h \
     gl/GLDebug.h \
     gl/shaders/ShaderAttribLocations.h \
+    gl/shaders/UniformBlockBindings.h \
     gl/datatype/VBOAttribMarker.h \
     gl/datatype/VBO.h \
     gl/datatype/IBO.h \
+    gl/datatype/UBO.h \
     gl/datatype/VAO.h \
     gl/datatype/FBO.h \
     gl/textures/Texture.h \
@@ -116,12 +150,25 @@ HEADERS += \
     gl/textures/TextureParametersBuilder.h \
     gl/textures/RenderBuffer.h \
     gl/textures/DepthBuffer.h \
+    gl/textures/CubeMapLoader.h \
     gl/shaders/CS123Shader.h \
+    gl/shaders/FrameUniforms.h \
+    gl/shaders/ShaderVariants.h \
+    gl/shaders/ProgramBinaryCache.h \
     gl/util/FullScreenQuad.h \
+    gl/util/GeometryCache.h \
+    gl/util/PixelReadback.h \
+    gl/util/GpuProfiler.h \
     lib/CS123XmlSceneParser.h \
     lib/CS123SceneData.h \
     lib/CS123ISceneParser.h \
     lib/ResourceLoader.h \
+    lib/MappedFile.h \
+    lib/SkyboxLibrary.h \
+    lib/FrameWriter.h \
+    lib/AllocationTracker.h \
+    lib/PerformanceMonitor.h \
+    lib/Profiler.h \
     glew-1.10.0/include/GL/glew.h \
     stb_image.h \
     lib/RGBA.h
@@ -133,6 +180,12 @@ DEPENDPATH += glm brush camera lib scenegraph ui glew-1.10.0/include
 DEFINES += _USE_MATH_DEFINES
 DEFINES += TIXML_USE_STL
 DEFINES += GLM_SWIZZLE GLM_FORCE_RADIANS
+
+# qmake CONFIG+=track_allocations counts heap allocations per tick/render phase (see AllocationTracker.h).
+track_allocations: DEFINES += TRACK_ALLOCATIONS
+
+# qmake CONFIG+=avx2 steps JelloEnsemble's eight cubes in one 8-wide AVX2 pass instead of two SSE ones.
+avx2: QMAKE_CXXFLAGS += -mavx2 -mfma
 OTHER_FILES += shaders/shader.frag \
     shaders/shader.vert \
     shaders/wireframe/wireframe.vert \
@@ -157,6 +210,8 @@ OTHER_FILES += shaders/shader.frag \
 # Don't add the -pg flag unless you know what you are doing. It makes QThreadPool freeze on Mac OS X
 QMAKE_CXXFLAGS_RELEASE -= -O2
 QMAKE_CXXFLAGS_RELEASE += -O3
+# Nothing reads errno, and without this any loop that calls sqrt can't be vectorized.
+QMAKE_CXXFLAGS_RELEASE += -fno-math-errno
 QMAKE_CXXFLAGS_WARN_ON -= -Wall
 QMAKE_CXXFLAGS_WARN_ON += -Waddress -Warray-bounds -Wc++0x-compat -Wchar-subscripts -Wformat\
                           -Wmain -Wmissing-braces -Wparentheses -Wreorder -Wreturn-type \
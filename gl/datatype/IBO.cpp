@@ -2,12 +2,13 @@
 
 namespace CS123 { namespace GL {
 
-IBO::IBO(int *data, int size) :
-    m_handle(-1)
+IBO::IBO(const GLuint *data, int size) :
+    m_handle(-1),
+    m_numIndices(size)
 {
     glGenBuffers(1, &m_handle);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_handle);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, size * sizeof(int), &(data[0]), GL_STATIC_DRAW);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, size * sizeof(GLuint), &(data[0]), GL_STATIC_DRAW);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 }
 
@@ -24,4 +25,8 @@ void IBO::unbind() const {
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 }
 
+int IBO::numberOfIndices() const {
+    return m_numIndices;
+}
+
 }}
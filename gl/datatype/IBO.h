@@ -7,15 +7,23 @@ namespace CS123 { namespace GL {
 
 class IBO {
 public:
-    IBO(int* data, int size);
+    /**
+     * @brief IBO
+     * @param data Pointer to the beginning of the index data.
+     * @param size Number of indices in the array.
+     */
+    IBO(const GLuint *data, int size);
+    IBO(const IBO&) = delete;
+    IBO& operator=(const IBO&) = delete;
     ~IBO();
 
     void bind() const;
     void unbind() const;
-
+    int numberOfIndices() const;
 
 private:
     GLuint m_handle;
+    int m_numIndices;
 };
 
 }}
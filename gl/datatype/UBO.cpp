@@ -0,0 +1,34 @@
+#include "UBO.h"
+
+namespace CS123 { namespace GL {
+
+UBO::UBO(GLsizeiptr sizeInBytes) :
+    m_handle(0),
+    m_size(sizeInBytes)
+{
+    glGenBuffers(1, &m_handle);
+    glBindBuffer(GL_UNIFORM_BUFFER, m_handle);
+    glBufferData(GL_UNIFORM_BUFFER, m_size, nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+UBO::~UBO()
+{
+    glDeleteBuffers(1, &m_handle);
+}
+
+void UBO::update(const void *data) const {
+    glBindBuffer(GL_UNIFORM_BUFFER, m_handle);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, m_size, data);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void UBO::bindBase(GLuint bindingPoint) const {
+    glBindBufferBase(GL_UNIFORM_BUFFER, bindingPoint, m_handle);
+}
+
+GLsizeiptr UBO::size() const {
+    return m_size;
+}
+
+}}
@@ -0,0 +1,41 @@
+#ifndef UBO_H
+#define UBO_H
+
+#include "GL/glew.h"
+
+namespace CS123 { namespace GL {
+
+/**
+ * @class UBO
+ *
+ * A uniform buffer object backing one std140 uniform block. The buffer is attached to a binding
+ * point, and every shader whose block is bound to the same point reads from it, so the data only
+ * has to be written once no matter how many programs use it.
+ */
+class UBO {
+public:
+    /**
+     * @brief UBO
+     * @param sizeInBytes Size of the block; must match the std140 layout declared in the shaders.
+     */
+    explicit UBO(GLsizeiptr sizeInBytes);
+    UBO(const UBO&) = delete;
+    UBO& operator=(const UBO&) = delete;
+    ~UBO();
+
+    // Overwrites the whole block.
+    void update(const void *data) const;
+
+    // Attaches the buffer to an indexed uniform binding point.
+    void bindBase(GLuint bindingPoint) const;
+
+    GLsizeiptr size() const;
+
+private:
+    GLuint m_handle;
+    GLsizeiptr m_size;
+};
+
+}}
+
+#endif // UBO_H
@@ -25,21 +25,25 @@ VAO::VAO(const VBO &vbo, int numberOfVerticesToRender) :
 VAO::VAO(const VBO &vbo, const IBO &ibo, int numberOfVerticesToRender) :
     m_drawMethod(DRAW_INDEXED),
     m_handle(0),
-    m_numVertices(numberOfVerticesToRender),
+    m_numVertices(numberOfVerticesToRender > 0 ? numberOfVerticesToRender : ibo.numberOfIndices()),
     m_size(0),
     m_triangleLayout(vbo.triangleLayout())
 {
-    // TODO [OPTIONAL]
-    // There's another way of drawing with OpenGL that uses IBOs,
-    // or Index Buffer Objects.  Feel free to look them up or ask us
-    // about them if you're curious!
-    // This constructor should be almost identical to the one above,
-    // just also bind the IBO after binding the vbo (and unbind it)
+    glGenVertexArrays(1, &m_handle);
+
+    bind();
+    vbo.bindAndEnable();
+    ibo.bind();
+    unbind();
+    // The element array binding is VAO state, so only release it once the VAO is unbound.
+    ibo.unbind();
+    vbo.unbind();
 }
 
 VAO::VAO(VAO &&that) :
     m_VBO(std::move(that.m_VBO)),
     m_drawMethod(that.m_drawMethod),
+    m_handle(that.m_handle),
     m_numVertices(that.m_numVertices),
     m_size(that.m_size),
     m_triangleLayout(that.m_triangleLayout)
@@ -78,8 +82,7 @@ void VAO::draw(int numVertices) {
             glDrawArrays(m_triangleLayout, 0, numVertices);
             break;
         case VAO::DRAW_INDEXED:
-            // TODO [OPTIONAL]
-            // If you want to use IBO's, you'll need to call glDrawElements here
+            glDrawElements(m_triangleLayout, numVertices, GL_UNSIGNED_INT, nullptr);
             break;
     }
 }
@@ -88,7 +91,15 @@ void VAO::drawPL(VBO::GEOMETRY_LAYOUT layout1, VBO::GEOMETRY_LAYOUT layout2, int
     // enable point size here, specify point size in shader.vert
     glEnable(GL_PROGRAM_POINT_SIZE);
     glDrawArrays(layout1, 0, cutoff);
-    glDrawArrays(layout2, cutoff, m_numVertices);
+    switch(m_drawMethod) {
+        case VAO::DRAW_ARRAYS:
+            glDrawArrays(layout2, cutoff, m_numVertices);
+            break;
+        case VAO::DRAW_INDEXED:
+            // Indices already address the vertices before the cutoff, so the lines share them.
+            glDrawElements(layout2, m_numVertices, GL_UNSIGNED_INT, nullptr);
+            break;
+    }
 }
 
 void VAO::bind() {
@@ -16,6 +16,7 @@ public:
     enum DRAW_METHOD { DRAW_ARRAYS, DRAW_INDEXED };
 
     VAO(const VBO &vbo, int numberOfVerticesToRender);
+    // If numberOfVerticesToRender is 0, every index in the IBO is drawn.
     VAO(const VBO &vbo, const IBO &ibo, int numberOfVerticesToRender = 0);
     VAO(const VAO &that) = delete;
     VAO& operator=(const VAO &that) = delete;
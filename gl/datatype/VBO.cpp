@@ -1,6 +1,7 @@
 #include "VBO.h"
 
 #include "gl/datatype/VBOAttribMarker.h"
+#include "PerformanceMonitor.h"
 
 namespace CS123 { namespace GL {
 
@@ -13,7 +14,8 @@ unsigned int calculateFloatsPerVertex(const std::vector<VBOAttribMarker> &marker
     return max;
 }
 
-VBO::VBO(const float *data, int sizeInFloats, std::vector<VBOAttribMarker> markers, GEOMETRY_LAYOUT layout) :
+VBO::VBO(const float *data, int sizeInFloats, std::vector<VBOAttribMarker> markers, GEOMETRY_LAYOUT layout,
+         BUFFER_USAGE usage) :
     m_handle(-1),
     m_markers(markers),
     m_bufferSizeInFloats(sizeInFloats),
@@ -24,7 +26,8 @@ VBO::VBO(const float *data, int sizeInFloats, std::vector<VBOAttribMarker> marke
     glGenBuffers(1, &m_handle);
 
     glBindBuffer(GL_ARRAY_BUFFER, m_handle);
-    glBufferData(GL_ARRAY_BUFFER, sizeInFloats * sizeof(GLfloat), &data[0], GL_STATIC_DRAW);
+    glBufferData(GL_ARRAY_BUFFER, sizeInFloats * sizeof(GLfloat), &data[0], usage);
+    PerformanceMonitor::recordVertexUpload(sizeInFloats * sizeof(GLfloat));
     glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
@@ -74,6 +77,13 @@ void VBO::bindAndEnable() const {
     }
 }
 
+void VBO::update(const float *data, int sizeInFloats) const {
+    bind();
+    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeInFloats * sizeof(GLfloat), data);
+    PerformanceMonitor::recordVertexUpload(sizeInFloats * sizeof(GLfloat));
+    unbind();
+}
+
 void VBO::unbind() const {
     glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
@@ -18,14 +18,20 @@ public:
                            LAYOUT_POINTS = GL_POINTS,
                            LAYOUT_LINES = GL_LINES};
 
+    enum BUFFER_USAGE { USAGE_STATIC_DRAW = GL_STATIC_DRAW,
+                        USAGE_DYNAMIC_DRAW = GL_DYNAMIC_DRAW,
+                        USAGE_STREAM_DRAW = GL_STREAM_DRAW };
+
     /**
      * @brief VBO
      * @param data Pointer to the beginning of the data.
      * @param sizeInFloats Number of floats in the array.
      * @param markers List of VBOAttribMarkers that describe how the data is laid out.
      * @param layout Layout of the vertex data.
+     * @param usage Hint for how often the data will be rewritten (see update()).
      */
-    VBO(const float *data, int sizeInFloats, std::vector<VBOAttribMarker> markers, GEOMETRY_LAYOUT layout = LAYOUT_TRIANGLES);
+    VBO(const float *data, int sizeInFloats, std::vector<VBOAttribMarker> markers, GEOMETRY_LAYOUT layout = LAYOUT_TRIANGLES,
+        BUFFER_USAGE usage = USAGE_STATIC_DRAW);
     VBO(const VBO&) = delete;
     VBO& operator=(const VBO&) = delete;
     VBO(VBO &&that);
@@ -37,6 +43,9 @@ public:
     int numberOfVertices() const;
     int numberOfFloatsPerVertex() const;
 
+    // Overwrites the start of the buffer in place. sizeInFloats must not exceed the original size.
+    void update(const float *data, int sizeInFloats) const;
+
     void unbind() const;
 
 private:
@@ -1,11 +1,8 @@
 #include "CS123Shader.h"
 
 #include "CS123SceneData.h"
-#include "Settings.h"
-
 
 #include "gl/GLDebug.h"
-#include <sstream>
 
 namespace CS123 { namespace GL {
 
@@ -20,49 +17,22 @@ CS123Shader::CS123Shader(const std::string &vertexSource, const std::string &geo
 {
 }
 
+void CS123Shader::onLinked() {
+    m_ambientColor = getUniform("ambient_color");
+    m_diffuseColor = getUniform("diffuse_color");
+    m_specularColor = getUniform("specular_color");
+    m_shininess = getUniform("shininess");
+}
+
 glm::vec3 toGLMVec3(const CS123SceneColor &c) {
     return glm::vec3(c.r, c.g, c.b);
 }
 
 void CS123Shader::applyMaterial(const CS123SceneMaterial &material) {
-    setUniform("ambient_color", toGLMVec3(material.cAmbient));
-    setUniform("diffuse_color", toGLMVec3(material.cDiffuse));
-    setUniform("specular_color", toGLMVec3(material.cSpecular));
-    setUniform("shininess", material.shininess);
-}
-
-void CS123Shader::setLight(const CS123SceneLightData &light) {
-    bool ignoreLight = false;
-
-    GLint lightType;
-    std::string name;
-    glm::vec3 ndir;
-    switch(light.type) {
-        case LightType::LIGHT_POINT:
-            lightType = 0;
-            name = "lightPositions";
-            setUniformArrayByIndex(name, light.pos.xyz(), light.id);
-            if (!settings.usePointLights) ignoreLight = true;
-            break;
-        case LightType::LIGHT_DIRECTIONAL:
-            lightType = 1;
-            ndir = glm::normalize(light.dir.xyz());
-            name = "lightDirections";
-            setUniformArrayByIndex(name, ndir, light.id);
-            if (!settings.useDirectionalLights) ignoreLight = true;
-            break;
-        default:
-            lightType = 0;
-            ignoreLight = true; // Light type not supported
-            break;
-    }
-
-    CS123SceneColor color = light.color;
-    if (ignoreLight) color.r = color.g = color.b = 0;
-
-    setUniformArrayByIndex("lightTypes", lightType, light.id);
-    setUniformArrayByIndex("lightColors", glm::vec3(color.r, color.g, color.b), light.id);
-//    setUniformArrayByIndex("lightAttenuations", light.function, light.id);
+    setUniform(m_ambientColor, toGLMVec3(material.cAmbient));
+    setUniform(m_diffuseColor, toGLMVec3(material.cDiffuse));
+    setUniform(m_specularColor, toGLMVec3(material.cSpecular));
+    setUniform(m_shininess, material.shininess);
 }
 
 }}
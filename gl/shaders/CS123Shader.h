@@ -4,7 +4,6 @@
 #include "Shader.h"
 
 class CS123SceneMaterial;
-class CS123SceneLightData;
 
 namespace CS123 { namespace GL {
 
@@ -13,8 +12,19 @@ public:
     CS123Shader(const std::string &vertexSource, const std::string &fragmentSource);
     CS123Shader(const std::string &vertexSource, const std::string &geometrySource, const std::string &fragmentSource);
 
+    // Lights are not per-shader: they live in the shared Lights block (see FrameUniforms).
+    // Like any setUniform, this writes to the bound program, so bind() the shader first.
     void applyMaterial(const CS123SceneMaterial &material);
-    void setLight(const CS123SceneLightData &light);
+
+protected:
+    virtual void onLinked() override;
+
+private:
+    // Resolved once the program links so materials can be set without any string lookups.
+    UniformHandle m_ambientColor;
+    UniformHandle m_diffuseColor;
+    UniformHandle m_specularColor;
+    UniformHandle m_shininess;
 };
 
 }}
@@ -0,0 +1,84 @@
+#include "FrameUniforms.h"
+
+#include "CS123SceneData.h"
+#include "Settings.h"
+
+#include "gl/datatype/UBO.h"
+
+namespace CS123 { namespace GL {
+
+FrameUniforms::FrameUniforms() :
+    m_camera(),
+    m_lights(),
+    m_object(),
+    m_cameraUBO(std::make_unique<UBO>(sizeof(CameraBlock))),
+    m_lightsUBO(std::make_unique<UBO>(sizeof(LightsBlock))),
+    m_objectUBO(std::make_unique<UBO>(sizeof(ObjectBlock)))
+{
+    setCamera(glm::mat4(1.0f), glm::mat4(1.0f));
+    m_object.m = glm::mat4(1.0f);
+    m_object.normalMatrix = glm::mat4(1.0f);
+    clearLights();
+}
+
+FrameUniforms::~FrameUniforms()
+{
+}
+
+void FrameUniforms::setCamera(const glm::mat4 &p, const glm::mat4 &v) {
+    m_camera.p = p;
+    m_camera.v = v;
+    m_camera.vInverse = glm::inverse(v);
+}
+
+void FrameUniforms::setModel(const glm::mat4 &m) {
+    m_object.m = m;
+    m_object.normalMatrix = glm::mat4(glm::transpose(glm::inverse(glm::mat3(m_camera.v * m))));
+    m_objectUBO->update(&m_object);
+}
+
+void FrameUniforms::clearLights() {
+    for (int i = 0; i < UniformBlock::MAX_LIGHTS; i++) {
+        m_lights.lightColors[i] = glm::vec4(0.0f);
+    }
+}
+
+void FrameUniforms::setLight(const CS123SceneLightData &light) {
+    if (light.id < 0 || light.id >= UniformBlock::MAX_LIGHTS) return;
+
+    bool ignoreLight = false;
+
+    int lightType;
+    switch(light.type) {
+        case LightType::LIGHT_POINT:
+            lightType = 0;
+            m_lights.lightPositions[light.id] = glm::vec4(light.pos.xyz(), 0.0f);
+            if (!settings.usePointLights) ignoreLight = true;
+            break;
+        case LightType::LIGHT_DIRECTIONAL:
+            lightType = 1;
+            m_lights.lightDirections[light.id] = glm::vec4(glm::normalize(light.dir.xyz()), 0.0f);
+            if (!settings.useDirectionalLights) ignoreLight = true;
+            break;
+        default:
+            lightType = 0;
+            ignoreLight = true; // Light type not supported
+            break;
+    }
+
+    CS123SceneColor color = light.color;
+    if (ignoreLight) color.r = color.g = color.b = 0;
+
+    m_lights.lightTypes[light.id] = glm::ivec4(lightType, 0, 0, 0);
+    m_lights.lightColors[light.id] = glm::vec4(color.r, color.g, color.b, 0.0f);
+}
+
+void FrameUniforms::upload() {
+    m_cameraUBO->update(&m_camera);
+    m_lightsUBO->update(&m_lights);
+    m_cameraUBO->bindBase(UniformBlock::CAMERA);
+    m_lightsUBO->bindBase(UniformBlock::LIGHTS);
+    m_objectUBO->bindBase(UniformBlock::OBJECT);
+}
+
+}}
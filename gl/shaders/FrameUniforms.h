@@ -0,0 +1,81 @@
+#ifndef FRAMEUNIFORMS_H
+#define FRAMEUNIFORMS_H
+
+#include <memory>
+
+#include "glm/glm.hpp"
+#include "UniformBlockBindings.h"
+
+struct CS123SceneLightData;
+
+namespace CS123 { namespace GL {
+
+class UBO;
+
+// std140 mirror of the Camera block. mat4 has the same layout on both sides.
+struct CameraBlock {
+    glm::mat4 p;
+    glm::mat4 v;
+    glm::mat4 vInverse;
+};
+
+// std140 mirror of the Object block.
+struct ObjectBlock {
+    glm::mat4 m;
+    glm::mat4 normalMatrix; // transpose(inverse(v * m)); shaders use mat3(normalMatrix)
+};
+
+// std140 mirror of the Lights block. Scalar and vec3 array elements are padded to 16 bytes.
+struct LightsBlock {
+    glm::ivec4 lightTypes[UniformBlock::MAX_LIGHTS];      // .x: 0 for point, 1 for directional
+    glm::vec4 lightPositions[UniformBlock::MAX_LIGHTS];   // .xyz, for point lights
+    glm::vec4 lightDirections[UniformBlock::MAX_LIGHTS];  // .xyz, for directional lights
+    glm::vec4 lightColors[UniformBlock::MAX_LIGHTS];      // .rgb
+};
+
+static_assert(sizeof(CameraBlock) == 3 * 64, "CameraBlock must match the std140 Camera block");
+static_assert(sizeof(ObjectBlock) == 2 * 64, "ObjectBlock must match the std140 Object block");
+static_assert(sizeof(LightsBlock) == 4 * 16 * UniformBlock::MAX_LIGHTS,
+              "LightsBlock must match the std140 Lights block");
+
+/**
+ * @class FrameUniforms
+ *
+ * Owns the camera, light and object uniform buffers. A scene fills in the CPU-side copies as it
+ * likes and calls upload() once per frame; every shader then reads the same data through its
+ * blocks instead of having the matrices and lights pushed into it one uniform at a time. The
+ * model matrix is per draw instead, and setModel() writes it to the GPU straight away.
+ */
+class FrameUniforms {
+public:
+    FrameUniforms();
+    ~FrameUniforms();
+
+    // Also derives the inverse view matrix, so shaders never invert anything. Takes effect at the
+    // next upload().
+    void setCamera(const glm::mat4 &p, const glm::mat4 &v);
+
+    // Model matrix for the draws that follow, with its normal matrix for the current camera. Call
+    // it after setCamera() and upload(); it replaces the Object block immediately.
+    void setModel(const glm::mat4 &m);
+
+    // Turns off every light (sets each color to black).
+    void clearLights();
+    void setLight(const CS123SceneLightData &light);
+
+    // Writes both blocks to the GPU and (re)attaches them to their binding points.
+    void upload();
+
+private:
+    CameraBlock m_camera;
+    LightsBlock m_lights;
+    ObjectBlock m_object;
+
+    std::unique_ptr<UBO> m_cameraUBO;
+    std::unique_ptr<UBO> m_lightsUBO;
+    std::unique_ptr<UBO> m_objectUBO;
+};
+
+}}
+
+#endif // FRAMEUNIFORMS_H
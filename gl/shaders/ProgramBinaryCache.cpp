@@ -0,0 +1,131 @@
+#include "ProgramBinaryCache.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+namespace CS123 { namespace GL {
+
+namespace {
+
+const uint32_t CACHE_MAGIC = 0x42503343; // "C3PB"
+const uint32_t CACHE_VERSION = 1;
+
+struct CacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t format;  // GLenum binary format reported by the driver
+    uint32_t length;  // bytes of binary data following the header
+};
+
+std::string glString(GLenum name) {
+    const GLubyte *s = glGetString(name);
+    return s ? std::string(reinterpret_cast<const char*>(s)) : std::string();
+}
+
+// 64-bit FNV-1a; only used to name cache files, so collisions just cost a failed load.
+uint64_t fnv1a(const std::string &data, uint64_t hash = 14695981039346656037ull) {
+    for (unsigned char c : data) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+}
+
+ProgramBinaryCache::ProgramBinaryCache(const std::string &directory) :
+    m_directory(directory),
+    m_supported(false)
+{
+    m_driver = glString(GL_VENDOR) + "|" + glString(GL_RENDERER) + "|" +
+               glString(GL_VERSION) + "|" + glString(GL_SHADING_LANGUAGE_VERSION);
+
+    if (GLEW_ARB_get_program_binary || GLEW_VERSION_4_1) {
+        GLint numFormats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+        m_supported = numFormats > 0;
+    }
+}
+
+bool ProgramBinaryCache::isSupported() const {
+    return m_supported;
+}
+
+std::string ProgramBinaryCache::keyFor(const std::vector<std::string> &sources) const {
+    uint64_t hash = fnv1a(m_driver);
+    for (const std::string &source : sources) {
+        hash = fnv1a(source, fnv1a(std::string(1, '\0'), hash));
+    }
+
+    char key[17];
+    snprintf(key, sizeof(key), "%016llx", static_cast<unsigned long long>(hash));
+    return std::string(key);
+}
+
+std::string ProgramBinaryCache::pathFor(const std::string &key) const {
+    return m_directory + "/" + key + ".bin";
+}
+
+bool ProgramBinaryCache::load(GLuint programID, const std::string &key) const {
+    if (!m_supported) return false;
+
+    std::ifstream in(pathFor(key), std::ios::binary);
+    if (!in) return false;
+
+    CacheHeader header;
+    if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+            header.magic != CACHE_MAGIC || header.version != CACHE_VERSION) {
+        return false;
+    }
+
+    std::vector<char> binary(header.length);
+    if (!in.read(binary.data(), header.length)) return false;
+
+    glProgramBinary(programID, header.format, binary.data(), header.length);
+
+    GLint linked = GL_FALSE;
+    glGetProgramiv(programID, GL_LINK_STATUS, &linked);
+    return linked == GL_TRUE;
+}
+
+void ProgramBinaryCache::store(GLuint programID, const std::string &key) const {
+    if (!m_supported) return;
+
+    GLint length = 0;
+    glGetProgramiv(programID, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) return;
+
+    std::vector<char> binary(length);
+    GLenum format = 0;
+    glGetProgramBinary(programID, length, &length, &format, binary.data());
+
+    CacheHeader header = { CACHE_MAGIC, CACHE_VERSION, format, static_cast<uint32_t>(length) };
+
+    // Write to a temporary file and rename it, so a crash never leaves a truncated entry behind.
+    std::string path = pathFor(key);
+    std::string tmpPath = path + ".tmp";
+    {
+        std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            std::cerr << "Could not write program binary cache entry: " << tmpPath << std::endl;
+            return;
+        }
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(binary.data(), length);
+        if (!out) {
+            std::cerr << "Could not write program binary cache entry: " << tmpPath << std::endl;
+            out.close();
+            std::remove(tmpPath.c_str());
+            return;
+        }
+    }
+    // rename replaces an existing entry atomically, so a crash leaves the old one or the new.
+    if (std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+        std::cerr << "Could not write program binary cache entry: " << path << std::endl;
+        std::remove(tmpPath.c_str());
+    }
+}
+
+}}
@@ -0,0 +1,46 @@
+#ifndef PROGRAMBINARYCACHE_H
+#define PROGRAMBINARYCACHE_H
+
+#include <string>
+#include <vector>
+
+#include "GL/glew.h"
+
+namespace CS123 { namespace GL {
+
+/**
+ * @class ProgramBinaryCache
+ *
+ * On-disk cache of linked program binaries (glGetProgramBinary/glProgramBinary). Entries are keyed
+ * by a hash of the shader sources and the driver (vendor, renderer and version strings), so an
+ * edited shader or a driver update simply misses and recompiles. Needs a current GL context.
+ */
+class ProgramBinaryCache {
+public:
+    // The directory must already exist.
+    explicit ProgramBinaryCache(const std::string &directory);
+
+    // False if the driver can't hand out program binaries; load() and store() then do nothing.
+    bool isSupported() const;
+
+    std::string keyFor(const std::vector<std::string> &sources) const;
+
+    // Links the program from a cached binary. Returns false on a miss or if the driver rejects
+    // the binary, in which case the program should be compiled from source as usual.
+    bool load(GLuint programID, const std::string &key) const;
+
+    // Saves a successfully linked program. The program should have been linked with
+    // GL_PROGRAM_BINARY_RETRIEVABLE_HINT set.
+    void store(GLuint programID, const std::string &key) const;
+
+private:
+    std::string pathFor(const std::string &key) const;
+
+    std::string m_directory;
+    std::string m_driver;
+    bool m_supported;
+};
+
+}}
+
+#endif // PROGRAMBINARYCACHE_H
@@ -8,55 +8,98 @@
 
 #include "gl/GLDebug.h"
 #include "gl/textures/Texture2D.h"
+#include "ProgramBinaryCache.h"
+#include "UniformBlockBindings.h"
+
+// From KHR_parallel_shader_compile, which GLEW 1.10 predates.
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
 
 namespace CS123 { namespace GL {
 
-Shader::Shader(const std::string &vertexSource, const std::string &fragmentSource)
+ProgramBinaryCache *Shader::s_binaryCache = nullptr;
+
+static bool hasExtension(const char *name) {
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; i++) {
+        const GLubyte *extension = glGetStringi(GL_EXTENSIONS, i);
+        if (extension && std::string(reinterpret_cast<const char*>(extension)) == name) return true;
+    }
+    return false;
+}
+
+static bool supportsParallelCompile() {
+    static const bool supported = hasExtension("GL_KHR_parallel_shader_compile") ||
+                                  hasExtension("GL_ARB_parallel_shader_compile");
+    return supported;
+}
+
+Shader::Shader(const std::string &vertexSource, const std::string &fragmentSource) :
+    m_linked(false)
 {
     createProgramID();
-    std::vector<GLuint> shaders;
-    shaders.push_back(createVertexShaderFromSource(vertexSource));
-    shaders.push_back(createFragmentShaderFromSource(fragmentSource));
-    buildShaderProgramFromShaders(shaders);
-    discoverShaderData();
+    buildProgram({ vertexSource, fragmentSource },
+                 { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER });
 }
 
-Shader::Shader(const std::string &vertexSource, const std::string &geometrySource, const std::string &fragmentSource) {
+Shader::Shader(const std::string &vertexSource, const std::string &geometrySource, const std::string &fragmentSource) :
+    m_linked(false)
+{
     createProgramID();
-    std::vector<GLuint> shaders;
-    shaders.push_back(createVertexShaderFromSource(vertexSource));
-    shaders.push_back(createGeometryShaderFromSource(geometrySource));
-    shaders.push_back(createFragmentShaderFromSource(fragmentSource));
-    buildShaderProgramFromShaders(shaders);
-    discoverShaderData();
+    buildProgram({ vertexSource, geometrySource, fragmentSource },
+                 { GL_VERTEX_SHADER, GL_GEOMETRY_SHADER, GL_FRAGMENT_SHADER });
 }
 
 Shader::~Shader()
 {
+    deleteShaders(m_pendingShaders);
     glDeleteProgram(m_programID);
 }
 
+void Shader::setProgramBinaryCache(ProgramBinaryCache *cache) {
+    s_binaryCache = cache;
+}
+
 Shader::Shader(Shader &&that) :
     m_programID(that.m_programID),
+    m_linked(that.m_linked),
+    m_pendingShaders(std::move(that.m_pendingShaders)),
+    m_binaryKey(std::move(that.m_binaryKey)),
     m_attributes(std::move(that.m_attributes)),
-    m_uniforms(std::move(that.m_uniforms))
+    m_uniforms(std::move(that.m_uniforms)),
+    m_uniformArrays(std::move(that.m_uniformArrays)),
+    m_textureLocations(std::move(that.m_textureLocations)),
+    m_textureSlots(std::move(that.m_textureSlots))
 {
     that.m_programID = 0;
+    that.m_linked = true;
+    that.m_pendingShaders.clear();
 }
 
 Shader& Shader::operator=(Shader &&that) {
     this->~Shader();
 
     m_programID = that.m_programID;
+    m_linked = that.m_linked;
+    m_pendingShaders = std::move(that.m_pendingShaders);
+    m_binaryKey = std::move(that.m_binaryKey);
     m_attributes = std::move(that.m_attributes);
     m_uniforms = std::move(that.m_uniforms);
+    m_uniformArrays = std::move(that.m_uniformArrays);
+    m_textureLocations = std::move(that.m_textureLocations);
+    m_textureSlots = std::move(that.m_textureSlots);
 
     that.m_programID = 0;
+    that.m_linked = true;
+    that.m_pendingShaders.clear();
 
     return *this;
 }
 
 void Shader::bind() {
+    ensureLinked();
     glUseProgram(m_programID);
 }
 
@@ -64,129 +107,219 @@ void Shader::unbind() {
     glUseProgram(0);
 }
 
+bool Shader::isReady() const {
+    if (m_linked || !supportsParallelCompile()) return true;
+    GLint complete = GL_FALSE;
+    glGetProgramiv(m_programID, GL_COMPLETION_STATUS_KHR, &complete);
+    return complete == GL_TRUE;
+}
+
+void Shader::waitUntilReady() {
+    ensureLinked();
+}
+
+Shader::UniformHandle Shader::getUniform(const std::string &name) {
+    ensureLinked();
+    auto it = m_uniforms.find(name);
+    return (it == m_uniforms.end()) ? UniformHandle() : it->second;
+}
+
+Shader::UniformHandle Shader::getUniformArrayElement(const std::string &name, size_t index) {
+    const std::vector<UniformHandle> &elements = getUniformArray(name);
+    return (index < elements.size()) ? elements[index] : UniformHandle();
+}
+
+const std::vector<Shader::UniformHandle> &Shader::getUniformArray(const std::string &name) {
+    static const std::vector<UniformHandle> empty;
+    ensureLinked();
+    auto it = m_uniformArrays.find(name);
+    return (it == m_uniformArrays.end()) ? empty : it->second;
+}
+
+void Shader::setUniform(UniformHandle handle, float f) {
+    glUniform1f(handle.location, f);
+}
+
+void Shader::setUniform(UniformHandle handle, const glm::vec2 &vec2) {
+    glUniform2fv(handle.location, 1, glm::value_ptr(vec2));
+}
+
+void Shader::setUniform(UniformHandle handle, const glm::vec3 &vec3) {
+    glUniform3fv(handle.location, 1, glm::value_ptr(vec3));
+}
+
+void Shader::setUniform(UniformHandle handle, const glm::vec4 &vec4) {
+    glUniform4fv(handle.location, 1, glm::value_ptr(vec4));
+}
+
+void Shader::setUniform(UniformHandle handle, int i) {
+    glUniform1i(handle.location, i);
+}
+
+void Shader::setUniform(UniformHandle handle, const glm::ivec2 &ivec2) {
+    glUniform2iv(handle.location, 1, glm::value_ptr(ivec2));
+}
+
+void Shader::setUniform(UniformHandle handle, const glm::ivec3 &ivec3) {
+    glUniform3iv(handle.location, 1, glm::value_ptr(ivec3));
+}
+
+void Shader::setUniform(UniformHandle handle, const glm::ivec4 &ivec4) {
+    glUniform4iv(handle.location, 1, glm::value_ptr(ivec4));
+}
+
+void Shader::setUniform(UniformHandle handle, bool b) {
+    glUniform1i(handle.location, static_cast<GLint>(b));
+}
+
+void Shader::setUniform(UniformHandle handle, const glm::bvec2 &bvec2) {
+    glUniform2iv(handle.location, 1, glm::value_ptr(glm::ivec2(bvec2)));
+}
+
+void Shader::setUniform(UniformHandle handle, const glm::bvec3 &bvec3) {
+    glUniform3iv(handle.location, 1, glm::value_ptr(glm::ivec3(bvec3)));
+}
+
+void Shader::setUniform(UniformHandle handle, const glm::bvec4 &bvec4) {
+    glUniform4iv(handle.location, 1, glm::value_ptr(glm::ivec4(bvec4)));
+}
+
+void Shader::setUniform(UniformHandle handle, const glm::mat2 &mat2) {
+    glUniformMatrix2fv(handle.location, 1, GL_FALSE, glm::value_ptr(mat2));
+}
+
+void Shader::setUniform(UniformHandle handle, const glm::mat3 &mat3) {
+    glUniformMatrix3fv(handle.location, 1, GL_FALSE, glm::value_ptr(mat3));
+}
+
+void Shader::setUniform(UniformHandle handle, const glm::mat4 &mat4) {
+    glUniformMatrix4fv(handle.location, 1, GL_FALSE, glm::value_ptr(mat4));
+}
+
 void Shader::setUniform(const std::string &name, float f) {
-    glUniform1f(m_uniforms[name], f);
+    setUniform(getUniform(name), f);
 }
 
 void Shader::setUniform(const std::string &name, const glm::vec2 &vec2) {
-    glUniform2fv(m_uniforms[name], 1, glm::value_ptr(vec2));
+    setUniform(getUniform(name), vec2);
 }
 
 void Shader::setUniform(const std::string &name, const glm::vec3 &vec3) {
-    glUniform3fv(m_uniforms[name], 1, glm::value_ptr(vec3));
+    setUniform(getUniform(name), vec3);
 }
 
 void Shader::setUniform(const std::string &name, const glm::vec4 &vec4) {
-    glUniform4fv(m_uniforms[name], 1, glm::value_ptr(vec4));
+    setUniform(getUniform(name), vec4);
 }
 
 void Shader::setUniform(const std::string &name, int i) {
-    glUniform1i(m_uniforms[name], i);
+    setUniform(getUniform(name), i);
 }
 
 void Shader::setUniform(const std::string &name, const glm::ivec2 &ivec2) {
-    glUniform2iv(m_uniforms[name], 1, glm::value_ptr(ivec2));
+    setUniform(getUniform(name), ivec2);
 }
 
 void Shader::setUniform(const std::string &name, const glm::ivec3 &ivec3) {
-    glUniform3iv(m_uniforms[name], 1, glm::value_ptr(ivec3));
+    setUniform(getUniform(name), ivec3);
 }
 
 void Shader::setUniform(const std::string &name, const glm::ivec4 &ivec4) {
-    glUniform4iv(m_uniforms[name], 1, glm::value_ptr(ivec4));
+    setUniform(getUniform(name), ivec4);
 }
 
 void Shader::setUniform(const std::string &name, bool b) {
-    glUniform1i(m_uniforms[name], static_cast<GLint>(b));
+    setUniform(getUniform(name), b);
 }
 
 void Shader::setUniform(const std::string &name, const glm::bvec2 &bvec2) {
-    glUniform2iv(m_uniforms[name], 1, glm::value_ptr(glm::ivec2(bvec2)));
+    setUniform(getUniform(name), bvec2);
 }
 
 void Shader::setUniform(const std::string &name, const glm::bvec3 &bvec3) {
-    glUniform3iv(m_uniforms[name], 1, glm::value_ptr(glm::ivec3(bvec3)));
+    setUniform(getUniform(name), bvec3);
 }
 
 void Shader::setUniform(const std::string &name, const glm::bvec4 &bvec4) {
-    glUniform4iv(m_uniforms[name], 1, glm::value_ptr(glm::ivec4(bvec4)));
+    setUniform(getUniform(name), bvec4);
 }
 
 void Shader::setUniform(const std::string &name, const glm::mat2 &mat2) {
-    glUniformMatrix2fv(m_uniforms[name], 1, GL_FALSE, glm::value_ptr(mat2));
+    setUniform(getUniform(name), mat2);
 }
 
 void Shader::setUniform(const std::string &name, const glm::mat3 &mat3) {
-    glUniformMatrix3fv(m_uniforms[name], 1, GL_FALSE, glm::value_ptr(mat3));
+    setUniform(getUniform(name), mat3);
 }
 
 void Shader::setUniform(const std::string &name, const glm::mat4 &mat4) {
-    glUniformMatrix4fv(m_uniforms[name], 1, GL_FALSE, glm::value_ptr(mat4));
+    setUniform(getUniform(name), mat4);
 }
 
 void Shader::setUniformArrayByIndex(const std::string &name, float f, size_t index) {
-    glUniform1f(m_uniformArrays[std::make_tuple(name, index)], f);
+    setUniform(getUniformArrayElement(name, index), f);
 }
 
 void Shader::setUniformArrayByIndex(const std::string &name, const glm::vec2 &vec2, size_t index) {
-    glUniform2fv(m_uniformArrays[std::make_tuple(name, index)], 1, glm::value_ptr(vec2));
+    setUniform(getUniformArrayElement(name, index), vec2);
 }
 
 void Shader::setUniformArrayByIndex(const std::string &name, const glm::vec3 &vec3, size_t index) {
-    glUniform3fv(m_uniformArrays[std::make_tuple(name, index)], 1, glm::value_ptr(vec3));
+    setUniform(getUniformArrayElement(name, index), vec3);
 }
 
 void Shader::setUniformArrayByIndex(const std::string &name, const glm::vec4 &vec4, size_t index) {
-    glUniform4fv(m_uniformArrays[std::make_tuple(name, index)], 1, glm::value_ptr(vec4));
+    setUniform(getUniformArrayElement(name, index), vec4);
 }
 
 void Shader::setUniformArrayByIndex(const std::string &name, int i, size_t index) {
-    glUniform1i(m_uniformArrays[std::make_tuple(name, index)], i);
+    setUniform(getUniformArrayElement(name, index), i);
 }
 
 void Shader::setUniformArrayByIndex(const std::string &name, const glm::ivec2 &ivec2, size_t index) {
-    glUniform2iv(m_uniformArrays[std::make_tuple(name, index)], 1, glm::value_ptr(ivec2));
+    setUniform(getUniformArrayElement(name, index), ivec2);
 }
 
 void Shader::setUniformArrayByIndex(const std::string &name, const glm::ivec3 &ivec3, size_t index) {
-    glUniform3iv(m_uniformArrays[std::make_tuple(name, index)], 1, glm::value_ptr(ivec3));
+    setUniform(getUniformArrayElement(name, index), ivec3);
 }
 
 void Shader::setUniformArrayByIndex(const std::string &name, const glm::ivec4 &ivec4, size_t index) {
-    glUniform4iv(m_uniformArrays[std::make_tuple(name, index)], 1, glm::value_ptr(ivec4));
+    setUniform(getUniformArrayElement(name, index), ivec4);
 }
 
 void Shader::setUniformArrayByIndex(const std::string &name, bool b, size_t index) {
-    glUniform1i(m_uniformArrays[std::make_tuple(name, index)], static_cast<GLint>(b));
+    setUniform(getUniformArrayElement(name, index), b);
 }
 
 void Shader::setUniformArrayByIndex(const std::string &name, const glm::bvec2 &bvec2, size_t index) {
-    glUniform2iv(m_uniformArrays[std::make_tuple(name, index)], 1, glm::value_ptr(glm::ivec2(bvec2)));
+    setUniform(getUniformArrayElement(name, index), bvec2);
 }
 
 void Shader::setUniformArrayByIndex(const std::string &name, const glm::bvec3 &bvec3, size_t index) {
-    glUniform3iv(m_uniformArrays[std::make_tuple(name, index)], 1, glm::value_ptr(glm::ivec3(bvec3)));
+    setUniform(getUniformArrayElement(name, index), bvec3);
 }
 
 void Shader::setUniformArrayByIndex(const std::string &name, const glm::bvec4 &bvec4, size_t index) {
-    glUniform4iv(m_uniformArrays[std::make_tuple(name, index)], 1, glm::value_ptr(glm::ivec4(bvec4)));
+    setUniform(getUniformArrayElement(name, index), bvec4);
 }
 
 void Shader::setUniformArrayByIndex(const std::string &name, const glm::mat2 &mat2, size_t index) {
-    glUniformMatrix2fv(m_uniformArrays[std::make_tuple(name, index)], 1, GL_FALSE, glm::value_ptr(mat2));
+    setUniform(getUniformArrayElement(name, index), mat2);
 }
 
 void Shader::setUniformArrayByIndex(const std::string &name, const glm::mat3 &mat3, size_t index) {
-    glUniformMatrix3fv(m_uniformArrays[std::make_tuple(name, index)], 1, GL_FALSE, glm::value_ptr(mat3));
+    setUniform(getUniformArrayElement(name, index), mat3);
 }
 
 void Shader::setUniformArrayByIndex(const std::string &name, const glm::mat4 &mat4, size_t index) {
-    glUniformMatrix4fv(m_uniformArrays[std::make_tuple(name, index)], 1, GL_FALSE, glm::value_ptr(mat4));
+    setUniform(getUniformArrayElement(name, index), mat4);
 }
 
 void Shader::setTexture(const std::string &name, const Texture1D &t) {}
 
 void Shader::setTexture(const std::string &name, const Texture2D &t) {
+    ensureLinked();
     GLint location = m_textureLocations[name];
     GLint slot = m_textureSlots[location];
     glActiveTexture(GL_TEXTURE0 + slot);
@@ -202,19 +335,45 @@ void Shader::attachShaders(const std::vector<GLuint> &shaders) {
     std::for_each(shaders.begin(), shaders.end(), [this](int s){ glAttachShader(m_programID, s); });
 }
 
-void Shader::buildShaderProgramFromShaders(const std::vector<GLuint> &shaders) {
-    attachShaders(shaders);
+void Shader::buildProgram(const std::vector<std::string> &sources, const std::vector<GLenum> &stages) {
+    if (s_binaryCache && s_binaryCache->isSupported()) {
+        m_binaryKey = s_binaryCache->keyFor(sources);
+        if (s_binaryCache->load(m_programID, m_binaryKey)) return;
+        glProgramParameteri(m_programID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+
+    for (size_t i = 0; i < sources.size(); i++) {
+        m_pendingShaders.push_back(createShaderFromSource(sources[i], stages[i]));
+    }
+    attachShaders(m_pendingShaders);
     linkShaderProgram();
-    detachShaders(shaders);
-    deleteShaders(shaders);
 }
 
-GLuint Shader::createFragmentShaderFromSource(const std::string &source) {
-   return createShaderFromSource(source, GL_FRAGMENT_SHADER);
-}
+void Shader::ensureLinked() {
+    if (m_linked) return;
+    m_linked = true;
+
+    if (!m_pendingShaders.empty()) {
+        // This is the first status query, so it is where we wait for the driver to finish.
+        GLint linked = GL_FALSE;
+        glGetProgramiv(m_programID, GL_LINK_STATUS, &linked);
+        if (linked == GL_FALSE) {
+            std::for_each(m_pendingShaders.begin(), m_pendingShaders.end(),
+                          [](GLuint s){ CS123::GL::checkShaderCompilationStatus(s); });
+        }
+        CS123::GL::checkShaderLinkStatus(m_programID);
+
+        detachShaders(m_pendingShaders);
+        deleteShaders(m_pendingShaders);
+        m_pendingShaders.clear();
 
-GLuint Shader::createGeometryShaderFromSource(const std::string &source) {
-    return createShaderFromSource(source, GL_GEOMETRY_SHADER);
+        if (linked == GL_TRUE && s_binaryCache) {
+            s_binaryCache->store(m_programID, m_binaryKey);
+        }
+    }
+
+    discoverShaderData();
+    onLinked();
 }
 
 void Shader::compileShader(GLuint handle, const std::string &source) {
@@ -223,14 +382,10 @@ void Shader::compileShader(GLuint handle, const std::string &source) {
     glCompileShader(handle);
 }
 
-GLuint Shader::createVertexShaderFromSource(const std::string &source) {
-    return createShaderFromSource(source, GL_VERTEX_SHADER);
-}
-
 GLuint Shader::createShaderFromSource(const std::string &source, GLenum shaderType) {
     GLuint shaderHandle = glCreateShader(shaderType);
     compileShader(shaderHandle, source);
-    CS123::GL::checkShaderCompilationStatus(shaderHandle);
+    // The compile status is only checked if linking fails (see ensureLinked).
     return shaderHandle;
 }
 
@@ -247,13 +402,15 @@ void Shader::deleteShaders(const std::vector<GLuint> &shaders) {
 }
 
 void Shader::linkShaderProgram() {
+    // No status query here: with KHR_parallel_shader_compile the driver compiles and links on
+    // its own threads until something actually needs the program.
     glLinkProgram(m_programID);
-    CS123::GL::checkShaderLinkStatus(m_programID);
 }
 
 void Shader::discoverShaderData() {
     discoverAttributes();
     discoverUniforms();
+    discoverUniformBlocks();
 }
 
 void Shader::discoverAttributes() {
@@ -286,6 +443,12 @@ void Shader::discoverUniforms() {
         glGetActiveUniform(m_programID, i, bufSize, &nameLength, &arraySize, &type, name);
         name[std::min(nameLength, bufSize - 1)] = 0;
 
+        // Members of a uniform block have no location; they are written through the block's UBO.
+        GLuint index = i;
+        GLint blockIndex = -1;
+        glGetActiveUniformsiv(m_programID, 1, &index, GL_UNIFORM_BLOCK_INDEX, &blockIndex);
+        if (blockIndex != -1) continue;
+
         std::string strname(name);
         if (isUniformArray(name, nameLength)) {
             addUniformArray(strname, arraySize);
@@ -298,6 +461,19 @@ void Shader::discoverUniforms() {
     unbind();
 }
 
+void Shader::discoverUniformBlocks() {
+    bindUniformBlock(UniformBlock::CAMERA_NAME, UniformBlock::CAMERA);
+    bindUniformBlock(UniformBlock::LIGHTS_NAME, UniformBlock::LIGHTS);
+    bindUniformBlock(UniformBlock::OBJECT_NAME, UniformBlock::OBJECT);
+}
+
+void Shader::bindUniformBlock(const char *blockName, GLuint bindingPoint) {
+    GLuint blockIndex = glGetUniformBlockIndex(m_programID, blockName);
+    if (blockIndex != GL_INVALID_INDEX) {
+        glUniformBlockBinding(m_programID, blockIndex, bindingPoint);
+    }
+}
+
 bool Shader::isUniformArray(const GLchar *name, GLsizei nameLength) {
     // Check if the last 3 characters are '[0]'
     return (name[nameLength - 3] == '[') &&
@@ -312,11 +488,12 @@ bool Shader::isTexture(GLenum type) {
 
 void Shader::addUniformArray(const std::string &name, size_t size) {
     std::string cleanName = name.substr(0, name.length() - 3);
+    std::vector<UniformHandle> &elements = m_uniformArrays[cleanName];
+    elements.clear();
+    elements.reserve(size);
     for (auto i = static_cast<size_t>(0); i < size; i++) {
-        std::string enumeratedName = name;
-        enumeratedName[enumeratedName.length() - 2] = static_cast<char>('0' + i);
-        std::tuple< std::string, size_t > nameIndexTuple = std::make_tuple(cleanName, i);
-        m_uniformArrays[nameIndexTuple] = glGetUniformLocation(m_programID, enumeratedName.c_str());
+        std::string enumeratedName = cleanName + "[" + std::to_string(i) + "]";
+        elements.push_back(UniformHandle(glGetUniformLocation(m_programID, enumeratedName.c_str())));
     }
 }
 
@@ -328,7 +505,7 @@ void Shader::addTexture(const std::string &name) {
 }
 
 void Shader::addUniform(const std::string &name) {
-    m_uniforms[name] = glGetUniformLocation(m_programID, name.c_str());
+    m_uniforms[name] = UniformHandle(glGetUniformLocation(m_programID, name.c_str()));
 }
 
 }}
@@ -3,7 +3,6 @@
 
 #include <map>
 #include <string>
-#include <tuple>
 #include <vector>
 
 #include "GL/glew.h"
@@ -15,7 +14,17 @@ class Texture1D;
 class Texture2D;
 class Texture3D;
 class TextureCube;
-
+class ProgramBinaryCache;
+
+/**
+ * @class Shader
+ *
+ * A linked GLSL program. Construction only submits the compile and link; the program is waited on
+ * (and its uniforms discovered) the first time it is bound or queried, so constructing several
+ * shaders back to back lets a driver with KHR_parallel_shader_compile build them concurrently.
+ * If a ProgramBinaryCache is installed, programs are loaded from it when possible and saved to it
+ * after a fresh link.
+ */
 class Shader {
 public:
     Shader(const std::string &vertexSource, const std::string &fragmentSource);
@@ -27,6 +36,51 @@ public:
     Shader(Shader &&that);
     Shader& operator=(Shader &&that);
 
+    // Used by every Shader constructed afterwards; pass nullptr to stop caching.
+    static void setProgramBinaryCache(ProgramBinaryCache *cache);
+
+    // True once the program can be used without stalling. Without KHR_parallel_shader_compile
+    // this is always true (the first use simply waits).
+    bool isReady() const;
+
+    // Blocks until the driver has finished linking the program; isReady() is true afterwards.
+    void waitUntilReady();
+
+
+    /**
+     * A uniform location resolved once, when the shader is loaded. Setting a uniform through a
+     * handle skips the name lookup entirely. A default-constructed handle (or one for a uniform
+     * the driver optimized out) is invalid, and setting it is a no-op, like glUniform* with -1.
+     */
+    struct UniformHandle {
+        UniformHandle() : location(-1) {}
+        explicit UniformHandle(GLint location) : location(location) {}
+        bool isValid() const { return location != -1; }
+
+        GLint location;
+    };
+
+    UniformHandle getUniform(const std::string &name);
+    UniformHandle getUniformArrayElement(const std::string &name, size_t index);
+
+    // Handles for every element of a uniform array, precomputed at load. Empty if not active.
+    const std::vector<UniformHandle> &getUniformArray(const std::string &name);
+
+    void setUniform(UniformHandle handle, float f);
+    void setUniform(UniformHandle handle, const glm::vec2 &vec2);
+    void setUniform(UniformHandle handle, const glm::vec3 &vec3);
+    void setUniform(UniformHandle handle, const glm::vec4 &vec4);
+    void setUniform(UniformHandle handle, int i);
+    void setUniform(UniformHandle handle, const glm::ivec2 &ivec2);
+    void setUniform(UniformHandle handle, const glm::ivec3 &ivec3);
+    void setUniform(UniformHandle handle, const glm::ivec4 &ivec4);
+    void setUniform(UniformHandle handle, bool b);
+    void setUniform(UniformHandle handle, const glm::bvec2 &bvec2);
+    void setUniform(UniformHandle handle, const glm::bvec3 &bvec3);
+    void setUniform(UniformHandle handle, const glm::bvec4 &bvec4);
+    void setUniform(UniformHandle handle, const glm::mat2 &mat2);
+    void setUniform(UniformHandle handle, const glm::mat3 &mat3);
+    void setUniform(UniformHandle handle, const glm::mat4 &mat4);
 
     void setUniform(const std::string &name, float f);
     void setUniform(const std::string &name, const glm::vec2 &vec2);
@@ -69,18 +123,20 @@ public:
     void unbind();
     GLuint getID() const { return m_programID; }
 
+protected:
+    // Called once the program has linked and its uniforms have been discovered.
+    virtual void onLinked() {}
+
 private:
 
-    GLuint createFragmentShaderFromSource(const std::string &source);
-    GLuint createGeometryShaderFromSource(const std::string &source);
     void compileShader(GLuint handle, const std::string &source);
-    GLuint createVertexShaderFromSource(const std::string &source);
     GLuint createShaderFromSource(const std::string &source, GLenum shaderType);
 
     void createProgramID();
     void attachShaders(const std::vector<GLuint> &shaders);
-    void buildShaderProgramFromShaders(const std::vector<GLuint> &shaders);
+    void buildProgram(const std::vector<std::string> &sources, const std::vector<GLenum> &stages);
     void linkShaderProgram();
+    void ensureLinked();
     void detachShaders(const std::vector<GLuint> &shaders);
     void deleteShaders(const std::vector<GLuint> &shaders);
 
@@ -88,16 +144,25 @@ private:
     void discoverAttributes();
     void discoverUniforms();
 
+    // Attaches the shared Camera/Lights blocks (if declared) to their fixed binding points.
+    void discoverUniformBlocks();
+    void bindUniformBlock(const char *blockName, GLuint bindingPoint);
+
     bool isUniformArray(const GLchar *name , GLsizei nameLength);
     bool isTexture(GLenum type);
     void addUniform(const std::string &name);
     void addUniformArray(const std::string &name, size_t size);
     void addTexture(const std::string &name);
     GLuint m_programID;
+    bool m_linked;                        // link finished and uniforms discovered
+    std::vector<GLuint> m_pendingShaders; // stages still attached while the link is in flight
+    std::string m_binaryKey;
+
+    static ProgramBinaryCache *s_binaryCache;
 
     std::map<std::string, GLuint> m_attributes;
-    std::map<std::string, GLuint> m_uniforms;
-    std::map<std::tuple<std::string, size_t>, GLuint> m_uniformArrays;
+    std::map<std::string, UniformHandle> m_uniforms;
+    std::map<std::string, std::vector<UniformHandle>> m_uniformArrays; // array name to per-element handles
     std::map<std::string, GLuint> m_textureLocations; // name to uniform location
     std::map<GLuint, GLuint> m_textureSlots; // uniform location to texture slot
 };
@@ -0,0 +1,67 @@
+#ifndef SHADERVARIANTS_H
+#define SHADERVARIANTS_H
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ResourceLoader.h"
+
+namespace CS123 { namespace GL {
+
+/**
+ * @class ShaderVariants
+ *
+ * Compile-time permutations of one vertex/fragment pair. Instead of branching on uniforms per
+ * vertex or fragment, a shader can #ifdef on a feature and each combination of defines is compiled
+ * into its own program. Sources are read once; a variant is compiled the first time it is asked
+ * for and then reused, so switching between them is just picking a different program.
+ *
+ * ShaderType is Shader or CS123Shader (anything constructible from vertex and fragment source).
+ */
+template <typename ShaderType>
+class ShaderVariants {
+public:
+    ShaderVariants(const std::string &vertexResource, const std::string &fragmentResource) :
+        m_vertexSource(ResourceLoader::loadResourceFileToString(vertexResource)),
+        m_fragmentSource(ResourceLoader::loadResourceFileToString(fragmentResource))
+    {
+    }
+
+    ShaderVariants(const ShaderVariants&) = delete;
+    ShaderVariants& operator=(const ShaderVariants&) = delete;
+
+    // Returns the program built with exactly these defines, compiling it on first use. The order
+    // of the defines does not matter.
+    ShaderType *get(std::vector<std::string> defines) {
+        std::sort(defines.begin(), defines.end());
+
+        std::string key;
+        for (const std::string &define : defines) {
+            key += define + ";";
+        }
+
+        std::unique_ptr<ShaderType> &variant = m_variants[key];
+        if (!variant) {
+            variant = std::make_unique<ShaderType>(
+                        ResourceLoader::injectDefines(m_vertexSource, defines),
+                        ResourceLoader::injectDefines(m_fragmentSource, defines));
+        }
+        return variant.get();
+    }
+
+    // Number of permutations compiled so far.
+    size_t size() const { return m_variants.size(); }
+
+private:
+    std::string m_vertexSource;
+    std::string m_fragmentSource;
+
+    std::map<std::string, std::unique_ptr<ShaderType>> m_variants; // sorted defines to program
+};
+
+}}
+
+#endif // SHADERVARIANTS_H
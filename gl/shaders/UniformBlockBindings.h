@@ -0,0 +1,34 @@
+#ifndef UNIFORMBLOCKBINDINGS_H
+#define UNIFORMBLOCKBINDINGS_H
+
+#include "GL/glew.h"
+
+/**
+ * Binding points for the uniform blocks shared by every shader. A shader that declares a block
+ * with one of these names gets it bound to the matching point when it is loaded, so the block
+ * layouts (std140) must match the structs in FrameUniforms.h exactly:
+ *
+ *     layout(std140) uniform Camera { mat4 p; mat4 v; mat4 vInverse; };
+ *     layout(std140) uniform Object { mat4 m; mat4 normalMatrix; };
+ *     layout(std140) uniform Lights { int lightTypes[10]; vec3 lightPositions[10];
+ *                                     vec3 lightDirections[10]; vec3 lightColors[10]; };
+ *
+ * Camera and Lights hold for a whole frame. Object is the one being drawn, so it is rewritten
+ * before each draw that has a different model matrix.
+ */
+namespace CS123 { namespace GL { namespace UniformBlock {
+
+    const GLuint CAMERA = 0;
+    const GLuint LIGHTS = 1;
+    const GLuint OBJECT = 2;
+
+    const char * const CAMERA_NAME = "Camera";
+    const char * const LIGHTS_NAME = "Lights";
+    const char * const OBJECT_NAME = "Object";
+
+    // Length of the light arrays in the Lights block (MAX_LIGHTS in the shaders).
+    const int MAX_LIGHTS = 10;
+
+}}}
+
+#endif // UNIFORMBLOCKBINDINGS_H
@@ -0,0 +1,286 @@
+#include "CubeMapLoader.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include "MappedFile.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+namespace CS123 { namespace GL {
+
+namespace {
+
+const int NUM_FACES = 6;
+const int CHANNELS = 3;
+
+const uint32_t CACHE_MAGIC = 0x4D433343; // "C3CM"
+const uint32_t CACHE_VERSION = 1;
+
+// Followed by every face of level 0, then every face of level 1, and so on, as tightly packed RGB8.
+struct CacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t size;    // edge length of level 0
+    uint32_t levels;
+};
+
+int levelSize(int size, int level) {
+    return std::max(1, size >> level);
+}
+
+// Full chain down to 1x1.
+int mipLevels(int size) {
+    int levels = 1;
+    while ((size >> levels) > 0) levels++;
+    return levels;
+}
+
+size_t faceBytes(int size, int level) {
+    size_t edge = levelSize(size, level);
+    return edge * edge * CHANNELS;
+}
+
+size_t chainBytes(int size, int levels) {
+    size_t bytes = 0;
+    for (int level = 0; level < levels; level++) {
+        bytes += faceBytes(size, level);
+    }
+    return bytes;
+}
+
+// Halves a square image with a 2x2 box filter.
+void downsample(const unsigned char *src, int srcSize, unsigned char *dst) {
+    int dstSize = std::max(1, srcSize / 2);
+    for (int y = 0; y < dstSize; y++) {
+        int y0 = std::min(2 * y, srcSize - 1), y1 = std::min(2 * y + 1, srcSize - 1);
+        for (int x = 0; x < dstSize; x++) {
+            int x0 = std::min(2 * x, srcSize - 1), x1 = std::min(2 * x + 1, srcSize - 1);
+            for (int c = 0; c < CHANNELS; c++) {
+                int sum = src[(y0 * srcSize + x0) * CHANNELS + c] + src[(y0 * srcSize + x1) * CHANNELS + c] +
+                          src[(y1 * srcSize + x0) * CHANNELS + c] + src[(y1 * srcSize + x1) * CHANNELS + c];
+                dst[(y * dstSize + x) * CHANNELS + c] = static_cast<unsigned char>((sum + 2) / 4);
+            }
+        }
+    }
+}
+
+// One face with all of its levels back to back. A size of 0 means it failed to load.
+struct FaceChain {
+    int size;
+    std::vector<unsigned char> pixels;
+};
+
+FaceChain decodeFace(const std::string &path) {
+    FaceChain face = { 0, {} };
+
+    int width = 0, height = 0, channels = 0;
+    unsigned char *data = stbi_load(path.c_str(), &width, &height, &channels, CHANNELS);
+    if (!data) return face;
+    if (width != height) {
+        stbi_image_free(data);
+        return face;
+    }
+
+    int levels = mipLevels(width);
+    face.size = width;
+    face.pixels.resize(chainBytes(width, levels));
+    std::memcpy(face.pixels.data(), data, faceBytes(width, 0));
+    stbi_image_free(data);
+
+    unsigned char *level = face.pixels.data();
+    for (int i = 1; i < levels; i++) {
+        unsigned char *next = level + faceBytes(width, i - 1);
+        downsample(level, levelSize(width, i - 1), next);
+        level = next;
+    }
+    return face;
+}
+
+}
+
+CubeMapLoader::CubeMapLoader(const std::vector<std::string> &facePaths, const std::string &cachePath) :
+    m_chain(std::async(std::launch::async, &CubeMapLoader::load, facePaths, cachePath))
+{
+}
+
+CubeMapLoader::~CubeMapLoader()
+{
+    // The future's destructor joins the worker, so an unused loader just waits for it here.
+}
+
+bool CubeMapLoader::isDecoded() const {
+    return m_chain.valid() &&
+           m_chain.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+CubeMapLoader::MipChain CubeMapLoader::load(std::vector<std::string> facePaths, std::string cachePath) {
+    MipChain cached = loadCache(cachePath);
+    if (cached.levels > 0) return cached;
+
+    MipChain decoded = decodeFaces(facePaths);
+    if (decoded.failedFaces.empty() && writeCache(decoded, cachePath)) {
+        // Swap the decoded copy for the mapped file, so a set that was loaded ahead of time but
+        // isn't shown yet costs no heap memory.
+        cached = loadCache(cachePath);
+        if (cached.levels > 0) return cached;
+    }
+    return decoded;
+}
+
+CubeMapLoader::MipChain CubeMapLoader::loadCache(const std::string &cachePath) {
+    MipChain chain = { 0, 0, {}, {}, nullptr };
+    if (cachePath.empty()) return chain;
+
+    std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>(cachePath);
+    if (!file->isValid() || file->size() < sizeof(CacheHeader)) return chain;
+
+    CacheHeader header;
+    std::memcpy(&header, file->data(), sizeof(header));
+    if (header.magic != CACHE_MAGIC || header.version != CACHE_VERSION || header.size == 0 ||
+            header.levels != static_cast<uint32_t>(mipLevels(header.size)) ||
+            file->size() != sizeof(header) + NUM_FACES * chainBytes(header.size, header.levels)) {
+        return chain;
+    }
+
+    // Touch every page now, so the upload on the render thread never waits on the disk.
+    volatile unsigned char sink = 0;
+    for (size_t offset = 0; offset < file->size(); offset += 4096) {
+        sink += file->data()[offset];
+    }
+
+    const unsigned char *pixels = file->data() + sizeof(header);
+    for (int level = 0; level < static_cast<int>(header.levels); level++) {
+        for (int face = 0; face < NUM_FACES; face++) {
+            chain.faces.push_back(pixels);
+            pixels += faceBytes(header.size, level);
+        }
+    }
+    chain.size = header.size;
+    chain.levels = header.levels;
+    chain.storage = file;
+    return chain;
+}
+
+CubeMapLoader::MipChain CubeMapLoader::decodeFaces(const std::vector<std::string> &facePaths) {
+    // Decoding a 2048x2048 JPEG and filtering its mips dominates the load, so each face gets its
+    // own task.
+    std::vector<std::future<FaceChain>> tasks;
+    for (const std::string &path : facePaths) {
+        tasks.push_back(std::async(std::launch::async, decodeFace, path));
+    }
+
+    auto faces = std::make_shared<std::vector<FaceChain>>();
+    for (std::future<FaceChain> &task : tasks) {
+        faces->push_back(task.get());
+    }
+    faces->resize(NUM_FACES, FaceChain{ 0, {} });
+
+    MipChain chain = { 0, 0, {}, {}, nullptr };
+    for (const FaceChain &face : *faces) {
+        if (face.size > 0) {
+            chain.size = face.size;
+            break;
+        }
+    }
+    if (chain.size == 0) chain.size = 1;
+    chain.levels = mipLevels(chain.size);
+
+    // Missing faces, and faces that don't match the others, are left black.
+    for (int face = 0; face < NUM_FACES; face++) {
+        FaceChain &faceChain = (*faces)[face];
+        if (faceChain.size != chain.size) {
+            chain.failedFaces.push_back(face < static_cast<int>(facePaths.size()) ? facePaths[face] : "");
+            faceChain.size = chain.size;
+            faceChain.pixels.assign(chainBytes(chain.size, chain.levels), 0);
+        }
+    }
+
+    size_t offset = 0;
+    for (int level = 0; level < chain.levels; level++) {
+        for (int face = 0; face < NUM_FACES; face++) {
+            chain.faces.push_back((*faces)[face].pixels.data() + offset);
+        }
+        offset += faceBytes(chain.size, level);
+    }
+    chain.storage = faces;
+    return chain;
+}
+
+bool CubeMapLoader::writeCache(const MipChain &chain, const std::string &cachePath) {
+    if (cachePath.empty()) return false;
+
+    CacheHeader header = { CACHE_MAGIC, CACHE_VERSION,
+                           static_cast<uint32_t>(chain.size), static_cast<uint32_t>(chain.levels) };
+
+    // Write to a temporary file and rename it, so a crash never leaves a truncated cache behind.
+    std::string tmpPath = cachePath + ".tmp";
+    {
+        std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            std::cerr << "Could not write cube map cache: " << tmpPath << std::endl;
+            return false;
+        }
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        for (int level = 0; level < chain.levels; level++) {
+            for (int face = 0; face < NUM_FACES; face++) {
+                out.write(reinterpret_cast<const char*>(chain.faces[level * NUM_FACES + face]),
+                          faceBytes(chain.size, level));
+            }
+        }
+        if (!out) {
+            std::cerr << "Could not write cube map cache: " << tmpPath << std::endl;
+            out.close();
+            std::remove(tmpPath.c_str());
+            return false;
+        }
+    }
+    // rename replaces an existing cache atomically, so a crash leaves the old one or the new.
+    if (std::rename(tmpPath.c_str(), cachePath.c_str()) != 0) {
+        std::cerr << "Could not write cube map cache: " << cachePath << std::endl;
+        std::remove(tmpPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+GLuint CubeMapLoader::createTexture() {
+    MipChain chain = m_chain.get();
+
+    for (const std::string &path : chain.failedFaces) {
+        std::cout << "Cubemap tex failed to load at path: " << path << std::endl;
+    }
+
+    GLuint textureID;
+    glGenTextures(1, &textureID);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
+
+    // Rows of an RGB image are not necessarily 4-byte aligned.
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (int level = 0; level < chain.levels; level++) {
+        int size = levelSize(chain.size, level);
+        for (int face = 0; face < NUM_FACES; face++) {
+            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, level, GL_RGB8, size, size, 0,
+                         GL_RGB, GL_UNSIGNED_BYTE, chain.faces[level * NUM_FACES + face]);
+        }
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, chain.levels - 1);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+
+    return textureID;
+}
+
+}}
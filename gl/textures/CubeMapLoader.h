@@ -0,0 +1,58 @@
+#ifndef CUBEMAPLOADER_H
+#define CUBEMAPLOADER_H
+
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "GL/glew.h"
+
+namespace CS123 { namespace GL {
+
+/**
+ * @class CubeMapLoader
+ *
+ * Loads a cube map with its full mip chain on a worker thread as soon as it is constructed, so the
+ * loading overlaps with rendering. The first time a set is loaded its faces are decoded in
+ * parallel, mipmapped and written to a cache file; after that the cache file is just mapped into
+ * memory. Only createTexture() touches OpenGL, and it must be called on the thread that owns the
+ * context.
+ */
+class CubeMapLoader {
+public:
+    // Faces in GL order: +x, -x, +y, -y, +z, -z. The faces must be square and the same size.
+    CubeMapLoader(const std::vector<std::string> &facePaths, const std::string &cachePath);
+    CubeMapLoader(const CubeMapLoader&) = delete;
+    CubeMapLoader& operator=(const CubeMapLoader&) = delete;
+    ~CubeMapLoader();
+
+    // True once every level of every face is in memory (or failed to load); never blocks.
+    bool isDecoded() const;
+
+    // Uploads the mip chain into a new GL_TEXTURE_CUBE_MAP, waiting for the worker first if
+    // needed. Faces that failed to load are reported and left black. Can only be called once.
+    GLuint createTexture();
+
+private:
+    // RGB8 pixels for every level of every face, backed by either the mapped cache file or the
+    // freshly decoded images.
+    struct MipChain {
+        int size;                                // edge length of level 0
+        int levels;
+        std::vector<const unsigned char*> faces; // [level * 6 + face]
+        std::vector<std::string> failedFaces;
+        std::shared_ptr<const void> storage;     // keeps the pixels above alive
+    };
+
+    static MipChain load(std::vector<std::string> facePaths, std::string cachePath);
+    static MipChain loadCache(const std::string &cachePath);
+    static MipChain decodeFaces(const std::vector<std::string> &facePaths);
+    static bool writeCache(const MipChain &chain, const std::string &cachePath);
+
+    std::future<MipChain> m_chain;
+};
+
+}}
+
+#endif // CUBEMAPLOADER_H
@@ -7,7 +7,7 @@ using namespace CS123::GL;
 RenderBuffer::RenderBuffer() :
     m_handle(0)
 {
-    // TODO [Task 8] Call glGenRenderbuffers
+    glGenRenderbuffers(1, &m_handle);
 }
 
 RenderBuffer::RenderBuffer(RenderBuffer &&that) :
@@ -25,11 +25,11 @@ RenderBuffer& RenderBuffer::operator=(RenderBuffer &&that) {
 
 RenderBuffer::~RenderBuffer()
 {
-    // TODO Don't forget to delete!
+    glDeleteRenderbuffers(1, &m_handle);
 }
 
 void RenderBuffer::bind() const {
-    // TODO [Task 8] Bind the renderbuffer
+    glBindRenderbuffer(GL_RENDERBUFFER, m_handle);
 }
 
 unsigned int RenderBuffer::id() const {
@@ -37,5 +37,5 @@ unsigned int RenderBuffer::id() const {
 }
 
 void RenderBuffer::unbind() const {
-    // TODO Don't forget to unbind!
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
 }
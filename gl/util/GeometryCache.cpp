@@ -0,0 +1,63 @@
+#include "GeometryCache.h"
+
+#include "gl/datatype/VAO.h"
+#include "gl/shaders/ShaderAttribLocations.h"
+
+namespace CS123 { namespace GL {
+
+GeometryCache::GeometryCache()
+{
+}
+
+GeometryCache::~GeometryCache()
+{
+}
+
+GeometryCache::Handle GeometryCache::upload(const std::string &key, const std::vector<float> &data,
+                                            const std::vector<VBOAttribMarker> &markers,
+                                            VBO::GEOMETRY_LAYOUT layout) {
+    Handle existing = find(key);
+    if (existing != INVALID_HANDLE) {
+        return existing;
+    }
+
+    VBO vbo(data.data(), data.size(), markers, layout);
+    m_meshes.push_back(std::make_unique<VAO>(vbo, vbo.numberOfVertices()));
+
+    Handle handle = static_cast<Handle>(m_meshes.size()) - 1;
+    m_handles[key] = handle;
+    return handle;
+}
+
+GeometryCache::Handle GeometryCache::upload(const std::string &key, const std::vector<float> &data,
+                                            VBO::GEOMETRY_LAYOUT layout) {
+    std::vector<VBOAttribMarker> markers;
+    markers.push_back(VBOAttribMarker(ShaderAttrib::POSITION, 3, 0));
+    return upload(key, data, markers, layout);
+}
+
+GeometryCache::Handle GeometryCache::find(const std::string &key) const {
+    auto it = m_handles.find(key);
+    return (it == m_handles.end()) ? INVALID_HANDLE : it->second;
+}
+
+void GeometryCache::draw(Handle handle) {
+    if (handle < 0 || handle >= static_cast<Handle>(m_meshes.size())) {
+        return;
+    }
+    VAO *vao = m_meshes[handle].get();
+    vao->bind();
+    vao->draw();
+    vao->unbind();
+}
+
+void GeometryCache::drawDoubleSided(Handle handle) {
+    GLboolean culling = glIsEnabled(GL_CULL_FACE);
+    glDisable(GL_CULL_FACE);
+    draw(handle);
+    if (culling) {
+        glEnable(GL_CULL_FACE);
+    }
+}
+
+}}
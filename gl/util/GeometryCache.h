@@ -0,0 +1,56 @@
+#ifndef GEOMETRYCACHE_H
+#define GEOMETRYCACHE_H
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gl/datatype/VBO.h"
+#include "gl/datatype/VBOAttribMarker.h"
+
+namespace CS123 { namespace GL {
+
+class VAO;
+
+/**
+ * @class GeometryCache
+ *
+ * Holds meshes that never change after they are created (the bounding box, the collision plane,
+ * the skybox cube, ...). Each mesh is uploaded once, the first time its key is seen, and is
+ * then drawn through the returned handle, so nothing is allocated or uploaded per frame.
+ */
+class GeometryCache {
+public:
+    typedef int Handle;
+    static const Handle INVALID_HANDLE = -1;
+
+    GeometryCache();
+    ~GeometryCache();
+
+    /**
+     * Uploads the mesh under the given key, or returns the existing handle if the key has
+     * already been uploaded (the data is then ignored).
+     */
+    Handle upload(const std::string &key, const std::vector<float> &data,
+                  const std::vector<VBOAttribMarker> &markers, VBO::GEOMETRY_LAYOUT layout);
+
+    // Convenience overload for position-only meshes.
+    Handle upload(const std::string &key, const std::vector<float> &data, VBO::GEOMETRY_LAYOUT layout);
+
+    // Returns INVALID_HANDLE if nothing was uploaded under the key.
+    Handle find(const std::string &key) const;
+
+    void draw(Handle handle);
+
+    // Draws both faces of the mesh in a single call by turning off face culling around it.
+    void drawDoubleSided(Handle handle);
+
+private:
+    std::map<std::string, Handle> m_handles;
+    std::vector<std::unique_ptr<VAO>> m_meshes;
+};
+
+}}
+
+#endif // GEOMETRYCACHE_H
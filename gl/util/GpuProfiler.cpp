@@ -0,0 +1,144 @@
+#include "GpuProfiler.h"
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+namespace CS123 { namespace GL {
+
+void GpuProfiler::RollingAverage::add(float sample) {
+    if (count == static_cast<int>(samples.size())) {
+        sum -= samples[next];
+    } else {
+        count++;
+    }
+    samples[next] = sample;
+    sum += sample;
+    next = (next + 1) % samples.size();
+}
+
+float GpuProfiler::RollingAverage::average() const {
+    return count > 0 ? sum / count : 0.f;
+}
+
+GpuProfiler::GpuProfiler(int window) :
+    m_window(window > 0 ? window : 1),
+    m_slot(0),
+    m_active(-1),
+    m_gpuTrack(Profiler::track("GPU")),
+    m_supported(GLEW_ARB_timer_query || GLEW_VERSION_3_3)
+{
+    if (!m_supported) {
+        std::cerr << "Timer queries are not supported; only CPU times will be profiled" << std::endl;
+    }
+}
+
+GpuProfiler::~GpuProfiler()
+{
+    for (PassTimer &pass : m_passes) {
+        glDeleteQueries(2, pass.queries);
+    }
+}
+
+GpuProfiler::Pass GpuProfiler::addPass(const std::string &name) {
+    PassTimer pass;
+    pass.name = name;
+    pass.traceName = Profiler::intern(name);
+    pass.queries[0] = pass.queries[1] = 0;
+    pass.pending[0] = pass.pending[1] = false;
+    pass.cpuMs[0] = pass.cpuMs[1] = 0.f;
+    pass.cpuStart[0] = pass.cpuStart[1] = 0;
+    pass.gpu = { std::vector<float>(m_window), 0, 0, 0.f };
+    pass.cpu = { std::vector<float>(m_window), 0, 0, 0.f };
+    if (m_supported) {
+        glGenQueries(2, pass.queries);
+    }
+    m_passes.push_back(pass);
+    return static_cast<Pass>(m_passes.size() - 1);
+}
+
+void GpuProfiler::beginFrame() {
+    m_slot = 1 - m_slot;
+
+    // The queries in this slot were issued two frames ago. Anything not finished by now is
+    // dropped rather than waited for.
+    for (PassTimer &pass : m_passes) {
+        if (!pass.pending[m_slot]) continue;
+        pass.pending[m_slot] = false;
+
+        GLuint available = GL_FALSE;
+        glGetQueryObjectuiv(pass.queries[m_slot], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) continue;
+
+        GLuint64 nanoseconds = 0;
+        glGetQueryObjectui64v(pass.queries[m_slot], GL_QUERY_RESULT, &nanoseconds);
+        pass.gpu.add(nanoseconds / 1.0e6f);
+        pass.cpu.add(pass.cpuMs[m_slot]);
+        Profiler::record(m_gpuTrack, pass.traceName, pass.cpuStart[m_slot], nanoseconds);
+    }
+}
+
+void GpuProfiler::begin(Pass pass) {
+    if (m_active != -1) {
+        std::cerr << "GpuProfiler: \"" << m_passes[pass].name << "\" overlaps \""
+                  << m_passes[m_active].name << "\"; timer queries can't nest" << std::endl;
+        return;
+    }
+    m_active = pass;
+
+    PassTimer &timer = m_passes[pass];
+    if (m_supported) {
+        glBeginQuery(GL_TIME_ELAPSED, timer.queries[m_slot]);
+    }
+    timer.cpuStart[m_slot] = Profiler::now();
+}
+
+void GpuProfiler::end(Pass pass) {
+    if (m_active != pass) return;
+    m_active = -1;
+
+    PassTimer &timer = m_passes[pass];
+    int64_t cpuNs = Profiler::now() - timer.cpuStart[m_slot];
+    Profiler::record(timer.traceName, timer.cpuStart[m_slot], cpuNs);
+    timer.cpuMs[m_slot] = cpuNs / 1.0e6f;
+
+    if (m_supported) {
+        glEndQuery(GL_TIME_ELAPSED);
+        timer.pending[m_slot] = true;
+    } else {
+        timer.cpu.add(timer.cpuMs[m_slot]);
+    }
+}
+
+std::vector<GpuProfiler::Stats> GpuProfiler::stats() const {
+    std::vector<Stats> result;
+    for (const PassTimer &pass : m_passes) {
+        result.push_back({ pass.name, pass.gpu.average(), pass.cpu.average(), pass.cpu.count });
+    }
+    return result;
+}
+
+void GpuProfiler::report(std::ostream &out) const {
+    out << std::left << std::setw(12) << "pass" << std::right << std::setw(10) << "gpu ms"
+        << std::setw(10) << "cpu ms" << std::setw(9) << "frames" << std::endl;
+    for (const Stats &pass : stats()) {
+        out << std::left << std::setw(12) << pass.name << std::right << std::fixed << std::setprecision(3)
+            << std::setw(10) << pass.gpuMs << std::setw(10) << pass.cpuMs << std::setw(9) << pass.samples
+            << std::endl;
+    }
+}
+
+bool GpuProfiler::writeCSV(const std::string &path) const {
+    std::ofstream out(path);
+    if (!out) {
+        std::cerr << "Could not write GPU profile: " << path << std::endl;
+        return false;
+    }
+    out << "pass,gpu_ms,cpu_ms,samples\n";
+    for (const Stats &pass : stats()) {
+        out << pass.name << "," << pass.gpuMs << "," << pass.cpuMs << "," << pass.samples << "\n";
+    }
+    return static_cast<bool>(out);
+}
+
+}}
@@ -0,0 +1,104 @@
+#ifndef GPUPROFILER_H
+#define GPUPROFILER_H
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "GL/glew.h"
+#include "Profiler.h"
+
+namespace CS123 { namespace GL {
+
+/**
+ * @class GpuProfiler
+ *
+ * Times render passes on the GPU with GL_TIME_ELAPSED queries, next to the CPU time spent
+ * submitting them. Each pass has two queries used on alternate frames, and a result is only read
+ * once the driver says it is available, so profiling never waits on the GPU; a result that still
+ * isn't ready two frames later is dropped. Times are averaged over the last few frames.
+ *
+ * Every pass also shows up in the Profiler trace: the CPU span on the calling thread, and the GPU
+ * time on a "GPU" track, drawn from when the pass was submitted (timer queries give a duration, not
+ * a start time).
+ *
+ * Timer queries can't nest, so passes must not overlap.
+ */
+class GpuProfiler {
+public:
+    typedef int Pass;
+
+    struct Stats {
+        std::string name;
+        float gpuMs;    // average GPU time
+        float cpuMs;    // average CPU time between begin() and end()
+        int samples;    // frames the averages cover
+    };
+
+    // Averages over the last `window` frames in which a pass ran.
+    explicit GpuProfiler(int window = 60);
+    GpuProfiler(const GpuProfiler&) = delete;
+    GpuProfiler& operator=(const GpuProfiler&) = delete;
+    ~GpuProfiler();
+
+    // Registers a pass once, up front, so timing it each frame needs no name lookup.
+    Pass addPass(const std::string &name);
+
+    // Call once at the start of every frame; picks up the results from two frames ago.
+    void beginFrame();
+
+    void begin(Pass pass);
+    void end(Pass pass);
+
+    // Times a pass for the lifetime of the object.
+    class Scope {
+    public:
+        Scope(GpuProfiler &profiler, Pass pass) : m_profiler(profiler), m_pass(pass) { m_profiler.begin(m_pass); }
+        ~Scope() { m_profiler.end(m_pass); }
+    private:
+        GpuProfiler &m_profiler;
+        Pass m_pass;
+    };
+
+    std::vector<Stats> stats() const;
+
+    // Writes a table of the averages, one pass per line.
+    void report(std::ostream &out) const;
+
+    // Writes the averages as CSV (pass,gpu_ms,cpu_ms,samples). Returns false if the file can't be written.
+    bool writeCSV(const std::string &path) const;
+
+private:
+    struct RollingAverage {
+        std::vector<float> samples;
+        int next;
+        int count;
+        float sum;
+
+        void add(float sample);
+        float average() const;
+    };
+
+    struct PassTimer {
+        std::string name;
+        const char *traceName;  // name as recorded in the CPU profiler's trace
+        GLuint queries[2];
+        bool pending[2];
+        float cpuMs[2];     // CPU time of the frame each query belongs to
+        int64_t cpuStart[2];  // Profiler::now() when each query began
+        RollingAverage gpu;
+        RollingAverage cpu;
+    };
+
+    std::vector<PassTimer> m_passes;
+    int m_window;
+    int m_slot;         // which of the two queries this frame uses
+    Pass m_active;      // pass between begin() and end(), or -1
+    Profiler::Track *m_gpuTrack;
+    bool m_supported;
+};
+
+}}
+
+#endif // GPUPROFILER_H
@@ -0,0 +1,101 @@
+#include "PixelReadback.h"
+
+#include <cstring>
+
+namespace CS123 { namespace GL {
+
+namespace {
+
+const int BYTES_PER_PIXEL = 4;
+
+// How long collect(frame, true) waits for the GPU before giving up.
+const GLuint64 WAIT_TIMEOUT_NS = 1000000000;
+
+}
+
+PixelReadback::PixelReadback(int ringSize) :
+    m_slots(ringSize),
+    m_next(0),
+    m_pending(0)
+{
+    for (Slot &slot : m_slots) {
+        slot = { 0, 0, nullptr, 0, 0 };
+        glGenBuffers(1, &slot.buffer);
+    }
+}
+
+PixelReadback::~PixelReadback()
+{
+    for (Slot &slot : m_slots) {
+        if (slot.fence) glDeleteSync(slot.fence);
+        glDeleteBuffers(1, &slot.buffer);
+    }
+}
+
+bool PixelReadback::request(int width, int height) {
+    if (m_pending == static_cast<int>(m_slots.size()) || width <= 0 || height <= 0) return false;
+
+    Slot &slot = m_slots[m_next];
+    GLsizeiptr bytes = static_cast<GLsizeiptr>(width) * height * BYTES_PER_PIXEL;
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    if (slot.capacity < bytes) {
+        glBufferData(GL_PIXEL_PACK_BUFFER, bytes, nullptr, GL_STREAM_READ);
+        slot.capacity = bytes;
+    }
+
+    // With a pack buffer bound, glReadPixels only queues the copy and returns immediately.
+    glPixelStorei(GL_PACK_ALIGNMENT, BYTES_PER_PIXEL);
+    glReadPixels(0, 0, width, height, GL_BGRA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot.width = width;
+    slot.height = height;
+
+    m_next = (m_next + 1) % m_slots.size();
+    m_pending++;
+    return true;
+}
+
+bool PixelReadback::collect(Frame &frame, bool wait) {
+    if (m_pending == 0) return false;
+
+    int oldest = (m_next - m_pending + m_slots.size()) % m_slots.size();
+    Slot &slot = m_slots[oldest];
+
+    // The flush bit makes sure the fence is actually submitted, or a zero-timeout poll could
+    // never see it signal.
+    GLenum status = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, wait ? WAIT_TIMEOUT_NS : 0);
+    if (status == GL_TIMEOUT_EXPIRED) return false;
+
+    glDeleteSync(slot.fence);
+    slot.fence = nullptr;
+    m_pending--;
+
+    if (status == GL_WAIT_FAILED) return false;
+
+    size_t rowBytes = static_cast<size_t>(slot.width) * BYTES_PER_PIXEL;
+    frame.width = slot.width;
+    frame.height = slot.height;
+    frame.pixels.resize(rowBytes * slot.height);
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    const unsigned char *mapped = static_cast<const unsigned char*>(
+                glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, rowBytes * slot.height, GL_MAP_READ_BIT));
+    if (mapped) {
+        // Flip while copying out, one row at a time.
+        for (int y = 0; y < slot.height; y++) {
+            std::memcpy(&frame.pixels[y * rowBytes], mapped + (slot.height - 1 - y) * rowBytes, rowBytes);
+        }
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    return mapped != nullptr;
+}
+
+int PixelReadback::pending() const {
+    return m_pending;
+}
+
+}}
@@ -0,0 +1,58 @@
+#ifndef PIXELREADBACK_H
+#define PIXELREADBACK_H
+
+#include <vector>
+
+#include "GL/glew.h"
+
+namespace CS123 { namespace GL {
+
+/**
+ * @class PixelReadback
+ *
+ * Reads the framebuffer back without stalling: request() starts a glReadPixels into one of a
+ * ring of pixel pack buffers and fences it, and collect() picks the result up once the GPU is
+ * done with it, typically a frame or two later. Reads complete in the order they were requested.
+ */
+class PixelReadback {
+public:
+    // A finished read, with the top row first (OpenGL returns the bottom row first).
+    struct Frame {
+        int width;
+        int height;
+        std::vector<unsigned char> pixels; // 4 bytes per pixel, GL_BGRA order
+    };
+
+    explicit PixelReadback(int ringSize = 3);
+    PixelReadback(const PixelReadback&) = delete;
+    PixelReadback& operator=(const PixelReadback&) = delete;
+    ~PixelReadback();
+
+    // Queues a read of the bottom-left width x height pixels of the current read framebuffer.
+    // Returns false, without reading, if every buffer in the ring is still waiting to be collected.
+    bool request(int width, int height);
+
+    // Takes the oldest queued read. Returns false if nothing is queued, or if wait is false and the
+    // GPU hasn't finished it yet. The frame's storage is reused, so pass the same Frame each time.
+    bool collect(Frame &frame, bool wait);
+
+    // Number of reads requested but not yet collected.
+    int pending() const;
+
+private:
+    struct Slot {
+        GLuint buffer;
+        GLsizeiptr capacity;
+        GLsync fence;
+        int width;
+        int height;
+    };
+
+    std::vector<Slot> m_slots;
+    int m_next;     // slot the next request() writes into
+    int m_pending;
+};
+
+}}
+
+#endif // PIXELREADBACK_H
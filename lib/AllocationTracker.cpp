@@ -0,0 +1,132 @@
+#include "AllocationTracker.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <new>
+
+namespace {
+
+thread_local uint64_t t_allocations = 0;
+thread_local uint64_t t_bytes = 0;
+
+std::mutex &phaseMutex() {
+    static std::mutex mutex;
+    return mutex;
+}
+
+// Phases are never freed, so the pointers handed out by phase() stay valid.
+std::vector<std::unique_ptr<AllocationTracker::Phase>> &phases() {
+    static std::vector<std::unique_ptr<AllocationTracker::Phase>> s_phases;
+    return s_phases;
+}
+
+AllocationTracker::Stats statsOf(const AllocationTracker::Phase &phase) {
+    return { phase.name, phase.entries.load(), phase.allocations.load(), phase.bytes.load() };
+}
+
+}
+
+bool AllocationTracker::isEnabled() {
+#ifdef TRACK_ALLOCATIONS
+    return true;
+#else
+    return false;
+#endif
+}
+
+AllocationTracker::Phase *AllocationTracker::phase(const char *name) {
+    std::lock_guard<std::mutex> lock(phaseMutex());
+    for (const std::unique_ptr<Phase> &phase : phases()) {
+        if (std::string(phase->name) == name) return phase.get();
+    }
+    std::unique_ptr<Phase> phase(new Phase());
+    phase->name = name;
+    phase->entries = 0;
+    phase->allocations = 0;
+    phase->bytes = 0;
+    phases().push_back(std::move(phase));
+    return phases().back().get();
+}
+
+std::vector<AllocationTracker::Stats> AllocationTracker::stats() {
+    std::lock_guard<std::mutex> lock(phaseMutex());
+    std::vector<Stats> stats;
+    for (const std::unique_ptr<Phase> &phase : phases()) {
+        stats.push_back(statsOf(*phase));
+    }
+    return stats;
+}
+
+AllocationTracker::Stats AllocationTracker::stats(const std::string &name) {
+    std::lock_guard<std::mutex> lock(phaseMutex());
+    for (const std::unique_ptr<Phase> &phase : phases()) {
+        if (phase->name == name) return statsOf(*phase);
+    }
+    return { name, 0, 0, 0 };
+}
+
+void AllocationTracker::report(std::ostream &out) {
+    if (!isEnabled()) {
+        out << "Allocation tracking is off; rebuild with CONFIG+=track_allocations" << std::endl;
+        return;
+    }
+    out << "Heap allocations per phase:" << std::endl;
+    for (const Stats &phase : stats()) {
+        double entries = std::max<uint64_t>(phase.entries, 1);
+        out << "  " << phase.name << ": " << phase.allocations << " allocations, " << phase.bytes
+            << " bytes over " << phase.entries << " entries (" << phase.allocations / entries
+            << " allocations, " << phase.bytes / entries << " bytes each)" << std::endl;
+    }
+}
+
+uint64_t AllocationTracker::threadAllocations() {
+    return t_allocations;
+}
+
+uint64_t AllocationTracker::threadBytes() {
+    return t_bytes;
+}
+
+#ifdef TRACK_ALLOCATIONS
+
+// Replacements for the global allocation functions. The aligned overloads aren't replaced; this
+// codebase doesn't over-align anything on the heap.
+
+namespace {
+
+void *allocate(std::size_t size) {
+    t_allocations++;
+    t_bytes += size;
+    for (;;) {
+        if (void *pointer = std::malloc(size ? size : 1)) return pointer;
+        std::new_handler handler = std::get_new_handler();
+        if (!handler) throw std::bad_alloc();
+        handler();
+    }
+}
+
+void *allocateNoThrow(std::size_t size) noexcept {
+    try {
+        return allocate(size);
+    } catch (const std::bad_alloc&) {
+        return nullptr;
+    }
+}
+
+}
+
+void *operator new(std::size_t size) { return allocate(size); }
+void *operator new[](std::size_t size) { return allocate(size); }
+void *operator new(std::size_t size, const std::nothrow_t&) noexcept { return allocateNoThrow(size); }
+void *operator new[](std::size_t size, const std::nothrow_t&) noexcept { return allocateNoThrow(size); }
+
+void operator delete(void *pointer) noexcept { std::free(pointer); }
+void operator delete[](void *pointer) noexcept { std::free(pointer); }
+void operator delete(void *pointer, std::size_t) noexcept { std::free(pointer); }
+void operator delete[](void *pointer, std::size_t) noexcept { std::free(pointer); }
+void operator delete(void *pointer, const std::nothrow_t&) noexcept { std::free(pointer); }
+void operator delete[](void *pointer, const std::nothrow_t&) noexcept { std::free(pointer); }
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef ALLOCATIONTRACKER_H
+#define ALLOCATIONTRACKER_H
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * @class AllocationTracker
+ *
+ * Counts heap allocations made inside named phases such as "tick" and "render". It is opt-in:
+ * only builds configured with CONFIG+=track_allocations (which defines TRACK_ALLOCATIONS) replace
+ * the global operator new, and in every other build ALLOCATION_PHASE compiles to nothing.
+ *
+ * operator new bumps two thread-local counters; a phase scope reads them on entry and exit and
+ * adds the difference to the phase's totals, so nested phases count their inner phases too.
+ */
+class AllocationTracker {
+public:
+    struct Phase {
+        const char *name;
+        std::atomic<uint64_t> entries;
+        std::atomic<uint64_t> allocations;
+        std::atomic<uint64_t> bytes;
+    };
+
+    struct Stats {
+        std::string name;
+        uint64_t entries;
+        uint64_t allocations;
+        uint64_t bytes;
+    };
+
+    // False unless the build has TRACK_ALLOCATIONS.
+    static bool isEnabled();
+
+    // The phase with this name, created on first use. The name must outlive the program, e.g. a
+    // string literal.
+    static Phase *phase(const char *name);
+
+    // Every phase so far, in the order they were first entered.
+    static std::vector<Stats> stats();
+
+    // Totals for one phase; all zero if it hasn't been entered.
+    static Stats stats(const std::string &name);
+
+    // Prints allocations and bytes per phase, in total and per entry.
+    static void report(std::ostream &out);
+
+    // Allocations made so far by the calling thread.
+    static uint64_t threadAllocations();
+    static uint64_t threadBytes();
+
+    class Scope {
+    public:
+        explicit Scope(Phase *phase) :
+            m_phase(phase), m_allocations(threadAllocations()), m_bytes(threadBytes()) {}
+        ~Scope() {
+            m_phase->entries.fetch_add(1, std::memory_order_relaxed);
+            m_phase->allocations.fetch_add(threadAllocations() - m_allocations, std::memory_order_relaxed);
+            m_phase->bytes.fetch_add(threadBytes() - m_bytes, std::memory_order_relaxed);
+        }
+    private:
+        Phase *m_phase;
+        uint64_t m_allocations;
+        uint64_t m_bytes;
+    };
+};
+
+#ifdef TRACK_ALLOCATIONS
+#define ALLOCATION_CONCAT_(a, b) a##b
+#define ALLOCATION_CONCAT(a, b) ALLOCATION_CONCAT_(a, b)
+#define ALLOCATION_PHASE(name) \
+    static AllocationTracker::Phase *ALLOCATION_CONCAT(allocationPhase, __LINE__) = AllocationTracker::phase(name); \
+    AllocationTracker::Scope ALLOCATION_CONCAT(allocationScope, __LINE__)(ALLOCATION_CONCAT(allocationPhase, __LINE__))
+#else
+#define ALLOCATION_PHASE(name) do {} while (0)
+#endif
+
+#endif // ALLOCATIONTRACKER_H
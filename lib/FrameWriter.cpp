@@ -0,0 +1,171 @@
+#include "FrameWriter.h"
+
+#include <algorithm>
+#include <iostream>
+
+#include "Profiler.h"
+
+#include <QImage>
+#include <QString>
+
+FrameWriter::FrameWriter(const std::string &directory, Format format, int framesPerSecond, size_t queueCapacity) :
+    m_directory(directory),
+    m_format(format),
+    m_framesPerSecond(framesPerSecond),
+    m_queueCapacity(std::max<size_t>(queueCapacity, 1)),
+    m_closing(false),
+    m_failed(false),
+    m_framesWritten(0),
+    m_clipWidth(0),
+    m_clipHeight(0),
+    m_thread(&FrameWriter::run, this)
+{
+}
+
+FrameWriter::~FrameWriter()
+{
+    finish();
+}
+
+void FrameWriter::push(int width, int height, std::vector<unsigned char> &&pixels) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_notFull.wait(lock, [this] { return m_queue.size() < m_queueCapacity; });
+    m_queue.push_back({ width, height, std::move(pixels) });
+    m_notEmpty.notify_one();
+}
+
+bool FrameWriter::finish() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_closing = true;
+    }
+    m_notEmpty.notify_one();
+    if (m_thread.joinable()) m_thread.join();
+    if (m_clip.is_open()) m_clip.close();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return !m_failed;
+}
+
+int FrameWriter::framesWritten() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_framesWritten;
+}
+
+void FrameWriter::run() {
+    int index = 0;
+    while (true) {
+        Frame frame;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_notEmpty.wait(lock, [this] { return !m_queue.empty() || m_closing; });
+            if (m_queue.empty()) return;
+            frame = std::move(m_queue.front());
+            m_queue.pop_front();
+        }
+        m_notFull.notify_one();
+
+        // Encoding happens outside the lock, so the renderer can keep queueing meanwhile.
+        bool written = write(frame, index++);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (written) {
+            m_framesWritten++;
+        } else {
+            m_failed = true;
+        }
+    }
+}
+
+bool FrameWriter::write(const Frame &frame, int index) {
+    PROFILE_SCOPE("encode frame");
+    switch (m_format) {
+        case Format::PNG:
+            return writePNG(frame, index);
+        case Format::Y4M:
+            return writeY4M(frame);
+    }
+    return false;
+}
+
+bool FrameWriter::writePNG(const Frame &frame, int index) {
+    // BGRA bytes are exactly QImage's 32-bit 0xAARRGGBB pixels on a little-endian machine.
+    QImage image(frame.pixels.data(), frame.width, frame.height, frame.width * 4, QImage::Format_RGB32);
+    QString path = QString("%1/frame-%2.png")
+            .arg(QString::fromStdString(m_directory))
+            .arg(index, 5, 10, QChar('0'));
+    if (!image.save(path, "PNG")) {
+        std::cerr << "Could not write " << path.toStdString() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool FrameWriter::writeY4M(const Frame &frame) {
+    int width = frame.width, height = frame.height;
+    int chromaWidth = (width + 1) / 2, chromaHeight = (height + 1) / 2;
+
+    if (!m_clip.is_open()) {
+        std::string path = m_directory + "/clip.y4m";
+        m_clip.open(path, std::ios::binary | std::ios::trunc);
+        if (!m_clip) {
+            std::cerr << "Could not write " << path << std::endl;
+            return false;
+        }
+        // Y4M readers assume limited-range BT.601 (Y 16-235, chroma 16-240), so that is what is
+        // written. C420jpeg only says each chroma sample sits in the middle of its 2x2 block.
+        m_clip << "YUV4MPEG2 W" << width << " H" << height << " F" << m_framesPerSecond << ":1"
+               << " Ip A1:1 C420jpeg\n";
+        m_clipWidth = width;
+        m_clipHeight = height;
+    } else if (width != m_clipWidth || height != m_clipHeight) {
+        std::cerr << "Skipping a " << width << "x" << height << " frame in a "
+                  << m_clipWidth << "x" << m_clipHeight << " clip" << std::endl;
+        return false;
+    }
+
+    m_yuv.resize(width * height + 2 * chromaWidth * chromaHeight);
+    unsigned char *yPlane = m_yuv.data();
+    unsigned char *uPlane = yPlane + width * height;
+    unsigned char *vPlane = uPlane + chromaWidth * chromaHeight;
+
+    const unsigned char *bgra = frame.pixels.data();
+    for (int i = 0; i < width * height; i++) {
+        const unsigned char *p = bgra + 4 * i;
+        float y = 16.f + (219.f / 255.f) * (0.299f * p[2] + 0.587f * p[1] + 0.114f * p[0]);
+        yPlane[i] = static_cast<unsigned char>(std::min(235.f, y + 0.5f));
+    }
+
+    // Chroma is averaged over each 2x2 block.
+    for (int cy = 0; cy < chromaHeight; cy++) {
+        for (int cx = 0; cx < chromaWidth; cx++) {
+            float r = 0, g = 0, b = 0;
+            int count = 0;
+            for (int y = 2 * cy; y < std::min(2 * cy + 2, height); y++) {
+                for (int x = 2 * cx; x < std::min(2 * cx + 2, width); x++) {
+                    const unsigned char *p = bgra + 4 * (y * width + x);
+                    b += p[0];
+                    g += p[1];
+                    r += p[2];
+                    count++;
+                }
+            }
+            r /= count;
+            g /= count;
+            b /= count;
+            const float chromaScale = 224.f / 255.f;
+            float u = 128.f + chromaScale * (-0.168736f * r - 0.331264f * g + 0.5f * b);
+            float v = 128.f + chromaScale * (0.5f * r - 0.418688f * g - 0.081312f * b);
+            uPlane[cy * chromaWidth + cx] = static_cast<unsigned char>(std::min(240.f, std::max(16.f, u + 0.5f)));
+            vPlane[cy * chromaWidth + cx] = static_cast<unsigned char>(std::min(240.f, std::max(16.f, v + 0.5f)));
+        }
+    }
+
+    m_clip << "FRAME\n";
+    m_clip.write(reinterpret_cast<const char*>(m_yuv.data()), m_yuv.size());
+    if (!m_clip) {
+        std::cerr << "Could not write frame to " << m_directory << "/clip.y4m" << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,73 @@
+#ifndef FRAMEWRITER_H
+#define FRAMEWRITER_H
+
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @class FrameWriter
+ *
+ * Encodes rendered frames on its own thread. push() hands a frame over through a bounded queue,
+ * so the renderer only waits when encoding falls behind by more than the queue holds.
+ *
+ * PNG writes one numbered image per frame. Y4M writes a single uncompressed 4:2:0 clip that ffmpeg
+ * and most players read directly; every frame must then be the same size.
+ */
+class FrameWriter {
+public:
+    enum class Format { PNG, Y4M };
+
+    // The directory must already exist.
+    FrameWriter(const std::string &directory, Format format, int framesPerSecond, size_t queueCapacity = 8);
+    FrameWriter(const FrameWriter&) = delete;
+    FrameWriter& operator=(const FrameWriter&) = delete;
+    ~FrameWriter();
+
+    // Queues a frame of 4 bytes per pixel in GL_BGRA order, top row first. Blocks while the queue
+    // is full.
+    void push(int width, int height, std::vector<unsigned char> &&pixels);
+
+    // Waits until every queued frame is written and stops the thread. Returns false if any frame
+    // failed to write.
+    bool finish();
+
+    int framesWritten() const;
+
+private:
+    struct Frame {
+        int width;
+        int height;
+        std::vector<unsigned char> pixels;
+    };
+
+    void run();
+    bool write(const Frame &frame, int index);
+    bool writePNG(const Frame &frame, int index);
+    bool writeY4M(const Frame &frame);
+
+    std::string m_directory;
+    Format m_format;
+    int m_framesPerSecond;
+    size_t m_queueCapacity;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_notEmpty;
+    std::condition_variable m_notFull;
+    std::deque<Frame> m_queue;
+    bool m_closing;
+    bool m_failed;
+    int m_framesWritten;
+
+    std::ofstream m_clip;           // Y4M only
+    int m_clipWidth;
+    int m_clipHeight;
+    std::vector<unsigned char> m_yuv;
+    std::thread m_thread;
+};
+
+#endif // FRAMEWRITER_H
@@ -0,0 +1,35 @@
+#include "MappedFile.h"
+
+#include <QFile>
+
+MappedFile::MappedFile(const std::string &path) :
+    m_file(std::make_unique<QFile>(QString::fromStdString(path))),
+    m_data(nullptr),
+    m_size(0)
+{
+    if (!m_file->open(QIODevice::ReadOnly) || m_file->size() <= 0) return;
+
+    m_data = m_file->map(0, m_file->size());
+    if (m_data) {
+        m_size = static_cast<size_t>(m_file->size());
+    }
+}
+
+MappedFile::~MappedFile()
+{
+    if (m_data) {
+        m_file->unmap(m_data);
+    }
+}
+
+bool MappedFile::isValid() const {
+    return m_data != nullptr;
+}
+
+const unsigned char *MappedFile::data() const {
+    return m_data;
+}
+
+size_t MappedFile::size() const {
+    return m_size;
+}
@@ -0,0 +1,35 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+class QFile;
+
+/**
+ * @class MappedFile
+ *
+ * A whole file mapped read-only into memory. Pages are only read from disk when touched, so large
+ * cache files can be opened without copying them. The mapping lives as long as the object.
+ */
+class MappedFile {
+public:
+    explicit MappedFile(const std::string &path);
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile();
+
+    // False if the file doesn't exist or couldn't be mapped.
+    bool isValid() const;
+
+    const unsigned char *data() const;
+    size_t size() const;
+
+private:
+    std::unique_ptr<QFile> m_file;
+    unsigned char *m_data;
+    size_t m_size;
+};
+
+#endif // MAPPEDFILE_H
@@ -0,0 +1,159 @@
+#include "PerformanceMonitor.h"
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+
+#include "AllocationTracker.h"
+#include "Profiler.h"
+
+namespace {
+
+// Frame intervals kept for the percentiles; about five seconds at 48 fps.
+const size_t FRAME_WINDOW = 240;
+
+// Written only by the render thread; the sampler reads anything newer than its last look.
+const uint64_t FRAME_RING = 1024;
+float s_frameRing[FRAME_RING];
+std::atomic<uint64_t> s_frameHead(0);
+int64_t s_lastFrameTime = 0;
+
+std::atomic<uint64_t> s_steps(0);
+std::atomic<uint64_t> s_simNs(0);
+std::atomic<uint64_t> s_vertexBytes(0);
+
+// Stages shown in the panel.
+const size_t MAX_STAGES = 12;
+
+float percentile(std::vector<float> values, float p) {
+    if (values.empty()) return 0;
+    size_t index = std::min(values.size() - 1, static_cast<size_t>(p * values.size()));
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+}
+
+}
+
+void PerformanceMonitor::recordSimStep(float dt) {
+    s_steps.fetch_add(1, std::memory_order_relaxed);
+    s_simNs.fetch_add(static_cast<uint64_t>(dt * 1e9), std::memory_order_relaxed);
+}
+
+void PerformanceMonitor::recordFrame() {
+    int64_t now = Profiler::now();
+    if (s_lastFrameTime != 0) {
+        uint64_t head = s_frameHead.load(std::memory_order_relaxed);
+        s_frameRing[head % FRAME_RING] = (now - s_lastFrameTime) / 1e6f;
+        s_frameHead.store(head + 1, std::memory_order_release);
+    }
+    s_lastFrameTime = now;
+}
+
+void PerformanceMonitor::recordVertexUpload(long long bytes) {
+    s_vertexBytes.fetch_add(static_cast<uint64_t>(bytes), std::memory_order_relaxed);
+}
+
+PerformanceMonitor::PerformanceMonitor(float targetStepsPerSecond, int intervalMs) :
+    m_targetStepsPerSecond(targetStepsPerSecond),
+    m_intervalMs(intervalMs),
+    m_lastSteps(s_steps.load()),
+    m_lastSimNs(s_simNs.load()),
+    m_lastVertexBytes(s_vertexBytes.load()),
+    m_lastFrameHead(s_frameHead.load()),
+    m_lastSampleTime(Profiler::now()),
+    m_lastTicks(AllocationTracker::stats("tick").entries),
+    m_lastTickAllocations(AllocationTracker::stats("tick").allocations),
+    m_stopping(false)
+{
+    m_snapshot.targetStepsPerSecond = targetStepsPerSecond;
+    m_thread = std::thread(&PerformanceMonitor::run, this);
+}
+
+PerformanceMonitor::~PerformanceMonitor()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+    m_thread.join();
+}
+
+PerformanceMonitor::Snapshot PerformanceMonitor::snapshot() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_snapshot;
+}
+
+void PerformanceMonitor::run() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_wake.wait_for(lock, std::chrono::milliseconds(m_intervalMs), [this] { return m_stopping; })) {
+        lock.unlock();
+        int64_t now = Profiler::now();
+        Snapshot snapshot = sample((now - m_lastSampleTime) / 1e9);
+        m_lastSampleTime = now;
+        lock.lock();
+        m_snapshot = std::move(snapshot);
+    }
+}
+
+PerformanceMonitor::Snapshot PerformanceMonitor::sample(double seconds) {
+    Snapshot snapshot;
+    snapshot.targetStepsPerSecond = m_targetStepsPerSecond;
+    if (seconds <= 0) return snapshot;
+
+    uint64_t steps = s_steps.load(std::memory_order_relaxed);
+    uint64_t simNs = s_simNs.load(std::memory_order_relaxed);
+    uint64_t vertexBytes = s_vertexBytes.load(std::memory_order_relaxed);
+    uint64_t frameHead = s_frameHead.load(std::memory_order_acquire);
+
+    uint64_t frames = frameHead - m_lastFrameHead;
+    snapshot.stepsPerSecond = (steps - m_lastSteps) / seconds;
+    snapshot.realTimeFactor = (simNs - m_lastSimNs) / 1e9 / seconds;
+    snapshot.framesPerSecond = frames / seconds;
+    snapshot.vertexBytesPerFrame = frames > 0 ? static_cast<float>(vertexBytes - m_lastVertexBytes) / frames : 0;
+
+    // A static shape doesn't step at all, which isn't the simulation falling behind.
+    snapshot.overBudget = snapshot.stepsPerSecond > 0 &&
+                          snapshot.stepsPerSecond < 0.95f * m_targetStepsPerSecond;
+
+    if (AllocationTracker::isEnabled()) {
+        AllocationTracker::Stats tick = AllocationTracker::stats("tick");
+        uint64_t ticks = tick.entries - m_lastTicks;
+        snapshot.allocationsPerTick = ticks > 0 ? static_cast<long long>((tick.allocations - m_lastTickAllocations) / ticks) : 0;
+        m_lastTicks = tick.entries;
+        m_lastTickAllocations = tick.allocations;
+    }
+
+    // If the render thread lapped the ring, the oldest intervals are gone; skip them.
+    for (uint64_t i = std::max(m_lastFrameHead, frameHead > FRAME_RING ? frameHead - FRAME_RING : 0);
+            i < frameHead; i++) {
+        m_frameMs.push_back(s_frameRing[i % FRAME_RING]);
+    }
+    while (m_frameMs.size() > FRAME_WINDOW) m_frameMs.pop_front();
+    std::vector<float> window(m_frameMs.begin(), m_frameMs.end());
+    snapshot.frameMsP50 = percentile(window, 0.5f);
+    snapshot.frameMsP99 = percentile(window, 0.99f);
+
+    // Time per frame spent in each profiled stage since the last sample.
+    std::vector<Profiler::Sample> events;
+    Profiler::eventsSince(m_lastSampleTime, events);
+    // CPU stages are merged across threads; the GPU track's passes are kept apart.
+    std::map<std::string, int64_t> totals;
+    for (const Profiler::Sample &event : events) {
+        bool gpu = std::string(event.track) == "GPU";
+        totals[gpu ? std::string("GPU ") + event.name : std::string(event.name)] += event.duration;
+    }
+    float perFrame = frames > 0 ? 1.0f / frames : 1.0f;
+    for (const auto &total : totals) {
+        snapshot.stages.push_back({ total.first, total.second / 1e6f * perFrame });
+    }
+    std::sort(snapshot.stages.begin(), snapshot.stages.end(),
+              [](const Stage &a, const Stage &b) { return a.msPerFrame > b.msPerFrame; });
+    if (snapshot.stages.size() > MAX_STAGES) snapshot.stages.resize(MAX_STAGES);
+
+    m_lastSteps = steps;
+    m_lastSimNs = simNs;
+    m_lastVertexBytes = vertexBytes;
+    m_lastFrameHead = frameHead;
+    return snapshot;
+}
@@ -0,0 +1,81 @@
+#ifndef PERFORMANCEMONITOR_H
+#define PERFORMANCEMONITOR_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @class PerformanceMonitor
+ *
+ * Live numbers for the metrics panel. The simulation and render loops only bump a few relaxed
+ * atomics through the static record*() hooks; a sampling thread owned by the monitor turns those
+ * counters, and the Profiler's recent events, into a Snapshot a few times a second. The UI just
+ * copies the latest snapshot, so showing the panel costs the hot loop nothing.
+ */
+class PerformanceMonitor {
+public:
+    struct Stage {
+        std::string name;   // profiler event name, prefixed with "GPU " for GPU passes
+        float msPerFrame;
+    };
+
+    struct Snapshot {
+        float stepsPerSecond = 0;
+        float realTimeFactor = 0;      // simulated seconds per wall-clock second
+        float framesPerSecond = 0;
+        float frameMsP50 = 0;
+        float frameMsP99 = 0;
+        long long allocationsPerTick = -1; // -1 unless built with allocation tracking
+        float vertexBytesPerFrame = 0;
+        float targetStepsPerSecond = 0;
+        bool overBudget = false;       // stepping slower than the target rate
+        std::vector<Stage> stages;     // most expensive first
+    };
+
+    // Hot-path hooks; each is a couple of relaxed atomic operations.
+    static void recordSimStep(float dt);
+    static void recordFrame();          // call once per rendered frame, from the render thread
+    static void recordVertexUpload(long long bytes);
+
+    // Starts sampling every intervalMs. The simulation is over budget when it steps at less than
+    // 95% of targetStepsPerSecond.
+    PerformanceMonitor(float targetStepsPerSecond, int intervalMs = 500);
+    PerformanceMonitor(const PerformanceMonitor&) = delete;
+    PerformanceMonitor& operator=(const PerformanceMonitor&) = delete;
+    ~PerformanceMonitor();
+
+    // The most recent sample; never blocks on the sampler for more than a copy.
+    Snapshot snapshot() const;
+
+private:
+    void run();
+    Snapshot sample(double seconds);
+
+    float m_targetStepsPerSecond;
+    int m_intervalMs;
+
+    // Counter values at the previous sample.
+    uint64_t m_lastSteps;
+    uint64_t m_lastSimNs;
+    uint64_t m_lastVertexBytes;
+    uint64_t m_lastFrameHead;
+    int64_t m_lastSampleTime;
+    uint64_t m_lastTicks;          // entries into the "tick" allocation phase
+    uint64_t m_lastTickAllocations;
+
+    std::deque<float> m_frameMs; // the most recent frame intervals, oldest first
+
+    mutable std::mutex m_mutex;
+    Snapshot m_snapshot;
+    bool m_stopping;
+    std::condition_variable m_wake;
+    std::thread m_thread;
+};
+
+#endif // PERFORMANCEMONITOR_H
@@ -0,0 +1,189 @@
+#include "Profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Events kept per track; at 24 bytes each this is under 400 KB per thread.
+const uint64_t TRACK_CAPACITY = 16384;
+
+struct Event {
+    const char *name;
+    int64_t start;
+    int64_t duration;
+};
+
+std::mutex &registryMutex() {
+    static std::mutex mutex;
+    return mutex;
+}
+
+}
+
+struct Profiler::Track {
+    int id;
+    std::string name;
+    std::unique_ptr<Event[]> events;
+    std::atomic<uint64_t> head; // total events ever written; the ring holds the last TRACK_CAPACITY
+
+    void write(const Event &event) {
+        uint64_t index = head.load(std::memory_order_relaxed);
+        events[index % TRACK_CAPACITY] = event;
+        head.store(index + 1, std::memory_order_release);
+    }
+};
+
+namespace {
+
+// Tracks are never freed, so events from threads that have exited still show up in a dump.
+std::vector<std::unique_ptr<Profiler::Track>> &tracks() {
+    static std::vector<std::unique_ptr<Profiler::Track>> s_tracks;
+    return s_tracks;
+}
+
+Profiler::Track *createTrack(const std::string &name) {
+    std::lock_guard<std::mutex> lock(registryMutex());
+    std::unique_ptr<Profiler::Track> track(new Profiler::Track());
+    track->id = static_cast<int>(tracks().size()) + 1;
+    track->name = name;
+    track->events.reset(new Event[TRACK_CAPACITY]);
+    track->head = 0;
+    tracks().push_back(std::move(track));
+    return tracks().back().get();
+}
+
+Profiler::Track *threadTrack() {
+    thread_local Profiler::Track *t_track = nullptr;
+    if (!t_track) {
+        std::ostringstream name;
+        name << "thread " << std::this_thread::get_id();
+        t_track = createTrack(name.str());
+    }
+    return t_track;
+}
+
+void writeEscaped(std::ostream &out, const char *text) {
+    for (const char *c = text; *c; c++) {
+        if (*c == '"' || *c == '\\') out << '\\';
+        out << *c;
+    }
+}
+
+}
+
+int64_t Profiler::now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Profiler::record(const char *name, int64_t start, int64_t duration) {
+    threadTrack()->write({ name, start, duration });
+}
+
+void Profiler::record(Track *track, const char *name, int64_t start, int64_t duration) {
+    track->write({ name, start, duration });
+}
+
+Profiler::Track *Profiler::track(const std::string &name) {
+    {
+        std::lock_guard<std::mutex> lock(registryMutex());
+        for (const std::unique_ptr<Track> &track : tracks()) {
+            if (track->name == name) return track.get();
+        }
+    }
+    return createTrack(name);
+}
+
+const char *Profiler::intern(const std::string &name) {
+    static std::set<std::string> s_names;
+    std::lock_guard<std::mutex> lock(registryMutex());
+    return s_names.insert(name).first->c_str();
+}
+
+namespace {
+
+// Copies a track's ring, oldest first, leaving out anything the owning thread wrote over while we
+// were copying.
+void copyRecent(const Profiler::Track *track, std::vector<Event> &events) {
+    uint64_t end = track->head.load(std::memory_order_acquire);
+    uint64_t begin = end > TRACK_CAPACITY ? end - TRACK_CAPACITY : 0;
+    for (uint64_t i = begin; i < end; i++) {
+        events.push_back(track->events[i % TRACK_CAPACITY]);
+    }
+
+    uint64_t after = track->head.load(std::memory_order_acquire);
+    uint64_t firstIntact = after >= TRACK_CAPACITY ? after - TRACK_CAPACITY + 1 : 0;
+    if (firstIntact > begin) {
+        events.erase(events.begin(), events.begin() + std::min<uint64_t>(firstIntact - begin, events.size()));
+    }
+}
+
+std::vector<Profiler::Track*> snapshotTracks() {
+    std::lock_guard<std::mutex> lock(registryMutex());
+    std::vector<Profiler::Track*> snapshot;
+    for (const std::unique_ptr<Profiler::Track> &track : tracks()) snapshot.push_back(track.get());
+    return snapshot;
+}
+
+}
+
+bool Profiler::writeChromeTrace(const std::string &path) {
+    std::ofstream out(path);
+    if (!out) {
+        std::cerr << "Could not write trace: " << path << std::endl;
+        return false;
+    }
+
+    std::vector<Track*> snapshot = snapshotTracks();
+
+    int64_t origin = now();
+    std::vector<std::vector<Event>> events(snapshot.size());
+    for (size_t t = 0; t < snapshot.size(); t++) {
+        copyRecent(snapshot[t], events[t]);
+        for (const Event &event : events[t]) origin = std::min(origin, event.start);
+    }
+
+    // Timestamps are in microseconds from the oldest event in the dump.
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    for (size_t t = 0; t < snapshot.size(); t++) {
+        out << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"
+            << snapshot[t]->id << ",\"args\":{\"name\":\"";
+        writeEscaped(out, snapshot[t]->name.c_str());
+        out << "\"}}";
+        first = false;
+
+        for (const Event &event : events[t]) {
+            out << ",\n{\"name\":\"";
+            writeEscaped(out, event.name);
+            out << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << snapshot[t]->id
+                << ",\"ts\":" << (event.start - origin) / 1000.0
+                << ",\"dur\":" << event.duration / 1000.0 << "}";
+        }
+    }
+    out << "\n]}\n";
+    return static_cast<bool>(out);
+}
+
+void Profiler::eventsSince(int64_t since, std::vector<Sample> &samples) {
+    std::vector<Event> events;
+    for (Track *track : snapshotTracks()) {
+        events.clear();
+        copyRecent(track, events);
+        for (const Event &event : events) {
+            if (event.start >= since) {
+                samples.push_back({ track->name.c_str(), event.name, event.start, event.duration });
+            }
+        }
+    }
+}
@@ -0,0 +1,68 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @class Profiler
+ *
+ * Always-on CPU timeline. PROFILE_SCOPE("name") at the top of a block records how long the block
+ * took. Every thread writes into its own fixed-size ring (no locks, no allocation per sample), so
+ * the last few thousand events on each thread are always available, and writeChromeTrace() dumps
+ * them in the trace-event JSON that chrome://tracing and Perfetto open.
+ *
+ * Names are stored as pointers, so they must outlive the profiler: pass string literals, or
+ * strings returned by intern().
+ */
+class Profiler {
+public:
+    // A row in the trace. Each thread gets one automatically; others (e.g. "GPU") can be made with
+    // track() for samples that aren't timed on the calling thread.
+    struct Track;
+
+    // Nanoseconds on a steady clock.
+    static int64_t now();
+
+    // Records an event on the calling thread's track.
+    static void record(const char *name, int64_t start, int64_t duration);
+    static void record(Track *track, const char *name, int64_t start, int64_t duration);
+
+    // The track with this name, created on first use. Events on one track must come from one
+    // thread at a time.
+    static Track *track(const std::string &name);
+
+    // A copy of name that lives until the program exits. Not for per-frame use.
+    static const char *intern(const std::string &name);
+
+    // Writes every track's recent events as Chrome trace-event JSON. Safe to call while other
+    // threads keep recording.
+    static bool writeChromeTrace(const std::string &path);
+
+    struct Sample {
+        const char *track;
+        const char *name;
+        int64_t start;
+        int64_t duration;
+    };
+
+    // Appends every event that started at or after `since`, from every track. Like
+    // writeChromeTrace(), safe to call from any thread while others record.
+    static void eventsSince(int64_t since, std::vector<Sample> &samples);
+
+    class Scope {
+    public:
+        explicit Scope(const char *name) : m_name(name), m_start(now()) {}
+        ~Scope() { record(m_name, m_start, now() - m_start); }
+    private:
+        const char *m_name;
+        int64_t m_start;
+    };
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(name) Profiler::Scope PROFILE_CONCAT(profileScope, __LINE__)(name)
+
+#endif // PROFILER_H
@@ -14,3 +14,31 @@ std::string ResourceLoader::loadResourceFileToString(const std::string &resource
     }
     throw CS123::IOException("Could not open file: " + resourcePath);
 }
+
+std::string ResourceLoader::injectDefines(const std::string &shaderSource, const std::vector<std::string> &defines)
+{
+    if (defines.empty()) return shaderSource;
+
+    // #version has to stay the first directive, so the defines go on the line after it.
+    size_t insertAt = 0;
+    int nextLine = 1;
+    size_t version = shaderSource.find("#version");
+    if (version != std::string::npos) {
+        size_t endOfLine = shaderSource.find('\n', version);
+        insertAt = (endOfLine == std::string::npos) ? shaderSource.length() : endOfLine + 1;
+        for (size_t i = 0; i < insertAt; i++) {
+            if (shaderSource[i] == '\n') nextLine++;
+        }
+        if (endOfLine == std::string::npos) nextLine++; // a newline is added after #version below
+    }
+
+    std::string block;
+    for (const std::string &define : defines) {
+        block += "#define " + define + "\n";
+    }
+    block += "#line " + std::to_string(nextLine) + "\n";
+
+    std::string result = shaderSource.substr(0, insertAt);
+    if (insertAt > 0 && result.back() != '\n') result += '\n';
+    return result + block + shaderSource.substr(insertAt);
+}
@@ -3,6 +3,7 @@
 
 #include <exception>
 #include <string>
+#include <vector>
 
 #include "GL/glew.h"
 
@@ -24,6 +25,10 @@ class ResourceLoader
 {
 public:
     static std::string loadResourceFileToString(const std::string &resourcePath);
+
+    // Inserts "#define <entry>" for each entry right after the shader's #version line (entries
+    // may carry a value, e.g. "JELLO_COLOR 2"). A #line directive keeps error line numbers intact.
+    static std::string injectDefines(const std::string &shaderSource, const std::vector<std::string> &defines);
 };
 
 #endif // RESOURCELOADER_H
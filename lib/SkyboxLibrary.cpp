@@ -0,0 +1,96 @@
+#include "SkyboxLibrary.h"
+
+#include <iostream>
+
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QStandardPaths>
+
+namespace {
+
+const char *FACE_NAMES[] = { "posx", "negx", "posy", "negy", "posz", "negz" };
+const char *FACE_EXTENSIONS[] = { "jpg", "jpeg", "png" };
+
+QString findFace(const QDir &dir, const char *faceName) {
+    for (const char *extension : FACE_EXTENSIONS) {
+        QString path = dir.filePath(QString("%1.%2").arg(faceName, extension));
+        if (QFileInfo(path).isFile()) return path;
+    }
+    return QString();
+}
+
+QString findTexturesDirectory() {
+    QStringList starts = { QCoreApplication::applicationDirPath(), QDir::currentPath() };
+    for (const QString &start : starts) {
+        QDir dir(start);
+        do {
+            if (dir.exists("textures")) return dir.filePath("textures");
+        } while (dir.cdUp());
+    }
+    return QString();
+}
+
+}
+
+const std::vector<SkyboxSet> &SkyboxLibrary::sets() {
+    static const std::vector<SkyboxSet> s_sets = discover();
+    return s_sets;
+}
+
+const SkyboxSet *SkyboxLibrary::find(const std::string &name) {
+    const std::vector<SkyboxSet> &all = sets();
+    for (const SkyboxSet &set : all) {
+        if (set.name == name) return &set;
+    }
+    return all.empty() ? nullptr : &all.front();
+}
+
+std::vector<SkyboxSet> SkyboxLibrary::discover() {
+    std::vector<SkyboxSet> found;
+
+    QString texturesPath = findTexturesDirectory();
+    if (texturesPath.isEmpty()) {
+        std::cerr << "No textures/ folder found near " << QCoreApplication::applicationDirPath().toStdString()
+                  << "; the glass look needs a skybox" << std::endl;
+        return found;
+    }
+
+    QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/skyboxes";
+    if (!QDir().mkpath(cacheDir)) {
+        std::cerr << "Could not create skybox cache directory: " << cacheDir.toStdString() << std::endl;
+    }
+
+    QDir textures(texturesPath);
+    for (const QString &entry : textures.entryList(QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name)) {
+        QDir dir(textures.filePath(entry));
+
+        SkyboxSet set;
+        set.name = entry.toStdString();
+
+        // Any change to a face (or which file is used for it) gives the set a new cache file.
+        QCryptographicHash hash(QCryptographicHash::Md5);
+        for (const char *faceName : FACE_NAMES) {
+            QString path = findFace(dir, faceName);
+            if (path.isEmpty()) break;
+
+            QFileInfo info(path);
+            hash.addData(info.absoluteFilePath().toUtf8());
+            hash.addData(QByteArray::number(info.size()));
+            hash.addData(QByteArray::number(info.lastModified().toMSecsSinceEpoch()));
+            set.faces.push_back(info.absoluteFilePath().toStdString());
+        }
+        if (set.faces.size() != 6) continue;
+
+        QString key = QString::fromLatin1(hash.result().toHex().left(16));
+        set.cachePath = QString("%1/%2-%3.cube").arg(cacheDir, entry, key).toStdString();
+        found.push_back(set);
+    }
+
+    if (found.empty()) {
+        std::cerr << "No skybox sets found in " << texturesPath.toStdString() << std::endl;
+    }
+    return found;
+}
@@ -0,0 +1,32 @@
+#ifndef SKYBOXLIBRARY_H
+#define SKYBOXLIBRARY_H
+
+#include <string>
+#include <vector>
+
+// One skybox: a folder holding posx, negx, posy, negy, posz and negz images.
+struct SkyboxSet {
+    std::string name;                // folder name, e.g. "DallasW"
+    std::vector<std::string> faces;  // absolute paths in GL order: +x, -x, +y, -y, +z, -z
+    std::string cachePath;           // decoded, mipmapped copy; named after the faces' size and mtime
+};
+
+/**
+ * @class SkyboxLibrary
+ *
+ * Finds the skybox sets in the textures/ folder, looking next to the executable and then in each
+ * folder above it (so it works from a build directory or an app bundle), and in the working
+ * directory. The folder is only scanned once.
+ */
+class SkyboxLibrary {
+public:
+    static const std::vector<SkyboxSet> &sets();
+
+    // The set with this name, or the first set if there is none. Null if no sets were found.
+    static const SkyboxSet *find(const std::string &name);
+
+private:
+    static std::vector<SkyboxSet> discover();
+};
+
+#endif // SKYBOXLIBRARY_H
@@ -1,11 +1,236 @@
 #include <QApplication>
+#include <QCommandLineParser>
+#include <QDir>
+#include <iostream>
+#include <map>
+#include <memory>
 #include "mainwindow.h"
+#include "AllocationTracker.h"
+#include "shapes/EnergyMonitor.h"
+#include "shapes/LatticeBenchmark.h"
+#include "shapes/LatticeLayout.h"
+#include "shapes/ParameterSweep.h"
+#include "FrameWriter.h"
+#include "Profiler.h"
+#include "Settings.h"
 
 
 int main(int argc, char *argv[]) {
 
     QApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption exportOption("export",
+            "Render frames offscreen into <directory> and exit, without showing the window.", "directory");
+    QCommandLineOption captureOption("capture",
+            "Record every frame the window draws into <directory>, as --format at --fps, until it closes.",
+            "directory");
+    QCommandLineOption formatOption("format", "Format of exported or captured frames: png or y4m (default png).", "format", "png");
+    QCommandLineOption sizeOption("size", "Export resolution (default 1280x720).", "WxH", "1280x720");
+    QCommandLineOption framesOption("frames", "Number of frames to export (default 240).", "count", "240");
+    QCommandLineOption ticksOption("ticks-per-frame", "Simulation steps between frames (default 1).", "count", "1");
+    QCommandLineOption fpsOption("fps", "Frame rate stored in the y4m header (default 48).", "rate", "48");
+    QCommandLineOption profileOption("profile", "On exit, write per-pass render timings to <file> as CSV.", "file");
+    QCommandLineOption traceOption("trace", "On exit, write the recent CPU/GPU timeline to <file> as Chrome trace JSON.", "file");
+    QCommandLineOption allocationsOption("allocations",
+            "On exit, print heap allocations per tick/render phase (needs CONFIG+=track_allocations).");
+    QCommandLineOption allocationFreeOption("allocation-free",
+            "Exit with an error if any of these comma-separated phases (tick, render) allocated.", "phases");
+    QCommandLineOption energyOption("energy",
+            "Write the energy and momentum of every simulation step to <file> as CSV.", "file");
+    QCommandLineOption loadCheckpointOption("load-checkpoint", "Start the simulation from a saved checkpoint.", "file");
+    QCommandLineOption saveCheckpointOption("save-checkpoint", "On exit, save the simulation to <file>.", "file");
+    QCommandLineOption recordOption("record", "Record the simulation to <file> as a compressed trajectory.", "file");
+    QCommandLineOption recordEveryOption("record-every", "Record every Nth simulation step (default 1).", "N", "1");
+    QCommandLineOption playOption("play", "Play a recorded trajectory back instead of simulating.", "file");
+    QCommandLineOption sweepOption("sweep",
+            "Simulate many material parameter sets headlessly, write their scores to <file> as CSV, and exit.", "file");
+    QCommandLineOption sweepGridOption("sweep-grid",
+            "Ranges to sweep, e.g. kElastic=100:400:4,dElastic=0.1:0.3:3 (low:high:count); other parameters "
+            "keep their saved values.", "ranges");
+    QCommandLineOption sweepSamplesOption("sweep-samples",
+            "Draw this many random parameter sets from the ranges instead of every combination.", "count");
+    QCommandLineOption sweepSecondsOption("sweep-seconds", "Simulated seconds per run (default 5).", "seconds", "5");
+    QCommandLineOption sweepThreadsOption("sweep-threads", "Runs simulated at once (default one per core).", "count", "0");
+    QCommandLineOption latticeOption("lattice",
+            "Order the lattice points are stored in: row-major or tiled (default row-major).", "order");
+    QCommandLineOption renderMeshOption("render-mesh",
+            "Draw this OBJ, deformed by the simulated lattice, instead of the lattice's surface.", "file");
+    QCommandLineOption benchmarkLatticeOption("benchmark-lattice",
+            "Time simulation steps and count cache misses in each lattice order at param1 16, 32, 64 and 128, "
+            "print them, and exit.");
+    parser.addOptions({ exportOption, captureOption, formatOption, sizeOption, framesOption, ticksOption, fpsOption,
+                        profileOption, traceOption, allocationsOption, allocationFreeOption, energyOption,
+                        loadCheckpointOption, saveCheckpointOption, recordOption, recordEveryOption, playOption,
+                        sweepOption, sweepGridOption, sweepSamplesOption, sweepSecondsOption, sweepThreadsOption,
+                        latticeOption, benchmarkLatticeOption, renderMeshOption });
+    parser.process(app);
+
+    if (parser.isSet(latticeOption)) {
+        LatticeLayout::Order order;
+        if (!LatticeLayout::parseOrder(parser.value(latticeOption).toStdString(), order)) {
+            std::cerr << "Invalid lattice order " << parser.value(latticeOption).toStdString() << "; see --help"
+                      << std::endl;
+            return 1;
+        }
+        LatticeLayout::setDefaultOrder(order);
+    }
+
+    if (parser.isSet(benchmarkLatticeOption)) {
+        settings.loadSettingsOrDefaults();
+        LatticeBenchmark::Material material = { settings.kElastic, settings.dElastic, settings.kCollision,
+                                                settings.dCollision, settings.mass, settings.gravity };
+        LatticeBenchmark::print(std::cout, LatticeBenchmark::run({ 16, 32, 64, 128 }, material, 1.0));
+        return 0;
+    }
+
+    if (parser.isSet(sweepOption)) {
+        // The sweep starts from the saved settings, so it doesn't need the window at all.
+        settings.loadSettingsOrDefaults();
+        std::map<QString, ParameterSweep::Range> ranges = {
+            { "kElastic", { settings.kElastic, settings.kElastic, 1 } },
+            { "dElastic", { settings.dElastic, settings.dElastic, 1 } },
+            { "kCollision", { settings.kCollision, settings.kCollision, 1 } },
+            { "dCollision", { settings.dCollision, settings.dCollision, 1 } },
+            { "mass", { settings.mass, settings.mass, 1 } },
+        };
+        for (const QString &range : parser.value(sweepGridOption).split(',', QString::SkipEmptyParts)) {
+            QStringList nameAndValues = range.split('=');
+            QStringList values = nameAndValues.value(1).split(':');
+            bool lowOk = false, highOk = false, countOk = false;
+            ParameterSweep::Range parsed = { values.value(0).toFloat(&lowOk), values.value(1).toFloat(&highOk),
+                                             values.value(2).toInt(&countOk) };
+            if (nameAndValues.size() != 2 || !ranges.count(nameAndValues[0].trimmed()) || values.size() != 3 ||
+                    !lowOk || !highOk || !countOk || parsed.count < 1 || parsed.low > parsed.high) {
+                std::cerr << "Invalid sweep range " << range.toStdString() << "; see --help" << std::endl;
+                return 1;
+            }
+            ranges[nameAndValues[0].trimmed()] = parsed;
+        }
+        bool samplesOk = true;
+        int samples = parser.isSet(sweepSamplesOption) ? parser.value(sweepSamplesOption).toInt(&samplesOk) : 0;
+        if (!samplesOk) {
+            std::cerr << "Invalid sweep sample count " << parser.value(sweepSamplesOption).toStdString()
+                      << "; see --help" << std::endl;
+            return 1;
+        }
+
+        std::vector<ParameterSweep::Parameters> parameters = parser.isSet(sweepSamplesOption) ?
+                ParameterSweep::sample(ranges["kElastic"], ranges["dElastic"], ranges["kCollision"],
+                                       ranges["dCollision"], ranges["mass"], samples, 1) :
+                ParameterSweep::grid(ranges["kElastic"], ranges["dElastic"], ranges["kCollision"],
+                                     ranges["dCollision"], ranges["mass"]);
+        ParameterSweep::Scenario scenario = { settings.shapeParameter1, settings.gravity, 0.001f,
+                                              parser.value(sweepSecondsOption).toFloat() };
+        if (parameters.empty() || scenario.seconds <= 0) {
+            std::cerr << "Invalid sweep options; see --help" << std::endl;
+            return 1;
+        }
+
+        std::cout << "Sweeping " << parameters.size() << " parameter sets" << std::endl;
+        std::vector<ParameterSweep::Result> results =
+                ParameterSweep::run(parameters, scenario, parser.value(sweepThreadsOption).toInt());
+        return ParameterSweep::writeCSV(parser.value(sweepOption).toStdString(), results) ? 0 : 1;
+    }
+
+    if (parser.isSet(energyOption) && !EnergyMonitor::setCSV(parser.value(energyOption).toStdString())) {
+        return 1;
+    }
+
     MainWindow w;
+    if (parser.isSet(renderMeshOption) && !w.setRenderMesh(parser.value(renderMeshOption).toStdString())) {
+        return 1;
+    }
+    if (parser.isSet(loadCheckpointOption) && !w.loadCheckpoint(parser.value(loadCheckpointOption).toStdString())) {
+        return 1;
+    }
+    if (parser.isSet(playOption) && !w.startPlayback(parser.value(playOption).toStdString())) {
+        return 1;
+    }
+    if (parser.isSet(recordOption) &&
+            !w.startRecording(parser.value(recordOption).toStdString(), parser.value(recordEveryOption).toInt())) {
+        return 1;
+    }
+    auto saveOnExit = [&] {
+        if (parser.isSet(profileOption)) w.saveProfile(parser.value(profileOption).toStdString());
+        if (parser.isSet(traceOption)) Profiler::writeChromeTrace(parser.value(traceOption).toStdString());
+        if (parser.isSet(allocationsOption)) AllocationTracker::report(std::cout);
+        if (parser.isSet(saveCheckpointOption)) w.saveCheckpoint(parser.value(saveCheckpointOption).toStdString());
+    };
+
+    // For benchmark runs: phases that are supposed to be allocation-free fail the run if they weren't.
+    auto checkAllocations = [&] {
+        if (!parser.isSet(allocationFreeOption)) return true;
+        if (!AllocationTracker::isEnabled()) {
+            std::cerr << "--allocation-free needs a build with CONFIG+=track_allocations" << std::endl;
+            return false;
+        }
+        bool clean = true;
+        for (const QString &name : parser.value(allocationFreeOption).split(',', QString::SkipEmptyParts)) {
+            AllocationTracker::Stats phase = AllocationTracker::stats(name.trimmed().toStdString());
+            if (phase.allocations > 0) {
+                std::cerr << "Phase " << phase.name << " allocated " << phase.allocations << " times ("
+                          << phase.bytes << " bytes) over " << phase.entries << " entries" << std::endl;
+                clean = false;
+            }
+        }
+        return clean;
+    };
+
+    // --export and --capture write frames the same way. Null, after printing why, if the options
+    // are bad or the directory can't be created.
+    auto makeFrameWriter = [&](const QString &directory) -> std::unique_ptr<FrameWriter> {
+        int fps = parser.value(fpsOption).toInt();
+        QString format = parser.value(formatOption).toLower();
+        if (fps <= 0 || (format != "png" && format != "y4m")) {
+            std::cerr << "Invalid frame format options; see --help" << std::endl;
+            return nullptr;
+        }
+        if (!QDir().mkpath(directory)) {
+            std::cerr << "Could not create " << directory.toStdString() << std::endl;
+            return nullptr;
+        }
+        return std::make_unique<FrameWriter>(directory.toStdString(),
+                                             format == "y4m" ? FrameWriter::Format::Y4M : FrameWriter::Format::PNG,
+                                             fps);
+    };
+
+    if (parser.isSet(exportOption)) {
+        QStringList size = parser.value(sizeOption).split('x');
+        int width = size.value(0).toInt(), height = size.value(1).toInt();
+        int frames = parser.value(framesOption).toInt();
+        int ticksPerFrame = parser.value(ticksOption).toInt();
+
+        if (width <= 0 || height <= 0 || frames <= 0 || ticksPerFrame <= 0) {
+            std::cerr << "Invalid export options; see --help" << std::endl;
+            return 1;
+        }
+        std::unique_ptr<FrameWriter> writer = makeFrameWriter(parser.value(exportOption));
+        if (!writer) return 1;
+
+        bool exported = w.exportFrames(*writer, width, height, frames, ticksPerFrame);
+        saveOnExit();
+        // The blow-up itself was reported when it was detected; an unstable run is a failed export.
+        bool stable = !EnergyMonitor::blownUp();
+        return exported && checkAllocations() && stable ? 0 : 1;
+    }
+
+    // Unlike --export, this records the interactive window as it runs; the reads don't stall it.
+    std::unique_ptr<FrameWriter> capture;
+    if (parser.isSet(captureOption)) {
+        capture = makeFrameWriter(parser.value(captureOption));
+        if (!capture) return 1;
+        w.setFrameCapture(capture.get());
+    }
+
     w.show();
-    return app.exec();
+    int result = app.exec();
+    if (capture) {
+        w.setFrameCapture(nullptr);
+        if (!capture->finish()) result = 1;
+        std::cout << "Captured " << capture->framesWritten() << " frames" << std::endl;
+    }
+    saveOnExit();
+    return checkAllocations() ? result : 1;
 }
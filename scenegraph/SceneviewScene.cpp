@@ -7,10 +7,14 @@
 #include "SupportCanvas3D.h"
 #include "ResourceLoader.h"
 #include "gl/shaders/CS123Shader.h"
+#include "gl/shaders/FrameUniforms.h"
+#include "gl/shaders/ShaderVariants.h"
 using namespace CS123::GL;
 
 
-SceneviewScene::SceneviewScene()
+SceneviewScene::SceneviewScene() :
+    m_phongShader(nullptr),
+    m_frameUniforms(std::make_unique<FrameUniforms>())
 {
     // TODO: [SCENEVIEW] Set up anything you need for your Sceneview scene here...
     loadPhongShader();
@@ -24,9 +28,8 @@ SceneviewScene::~SceneviewScene()
 }
 
 void SceneviewScene::loadPhongShader() {
-    std::string vertexSource = ResourceLoader::loadResourceFileToString(":/shaders/default.vert");
-    std::string fragmentSource = ResourceLoader::loadResourceFileToString(":/shaders/default.frag");
-    m_phongShader = std::make_unique<CS123Shader>(vertexSource, fragmentSource);
+    m_phongVariants = std::make_unique<ShaderVariants<CS123Shader>>(":/shaders/default.vert", ":/shaders/default.frag");
+    settingsChanged();
 }
 
 void SceneviewScene::loadWireframeShader() {
@@ -64,24 +67,17 @@ void SceneviewScene::render(SupportCanvas3D *context) {
 
 void SceneviewScene::setSceneUniforms(SupportCanvas3D *context) {
     Camera *camera = context->getCamera();
-    m_phongShader->setUniform("useLighting", settings.useLighting);
-    m_phongShader->setUniform("useArrowOffsets", false);
-    m_phongShader->setUniform("p" , camera->getProjectionMatrix());
-    m_phongShader->setUniform("v", camera->getViewMatrix());
-}
-
-void SceneviewScene::setMatrixUniforms(Shader *shader, SupportCanvas3D *context) {
-    shader->setUniform("p", context->getCamera()->getProjectionMatrix());
-    shader->setUniform("v", context->getCamera()->getViewMatrix());
+    m_frameUniforms->setCamera(camera->getProjectionMatrix(), camera->getViewMatrix());
 }
 
 void SceneviewScene::setLights()
 {
     // TODO: [SCENEVIEW] Fill this in...
     //
-    // Set up the lighting for your scene using m_phongShader.
+    // Set up the lighting for your scene using m_frameUniforms->setLight().
     // The lighting information will most likely be stored in CS123SceneLightData structures.
     //
+    m_frameUniforms->upload();
 }
 
 void SceneviewScene::renderGeometry() {
@@ -92,12 +88,16 @@ void SceneviewScene::renderGeometry() {
     //
     // This is where you should render the geometry of the scene. Use what you
     // know about OpenGL and leverage your Shapes classes to get the job done.
+    // Call m_frameUniforms->setModel() with each primitive's matrix before drawing it.
     //
 
 }
 
 void SceneviewScene::settingsChanged() {
     // TODO: [SCENEVIEW] Fill this in if applicable.
+    std::vector<std::string> phongDefines;
+    if (settings.useLighting) phongDefines.push_back("USE_LIGHTING");
+    m_phongShader = m_phongVariants->get(phongDefines);
 }
 
 void SceneviewScene::tick(float current) {
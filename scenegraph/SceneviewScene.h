@@ -11,6 +11,8 @@ namespace CS123 { namespace GL {
     class Shader;
     class CS123Shader;
     class Texture2D;
+    class FrameUniforms;
+    template <typename ShaderType> class ShaderVariants;
 }}
 
 /**
@@ -51,16 +53,19 @@ private:
     void loadNormalsShader();
     void loadNormalsArrowShader();
 
-    void setSceneUniforms(SupportCanvas3D *context);\
-    void setMatrixUniforms(CS123::GL::Shader *shader, SupportCanvas3D *context);
+    void setSceneUniforms(SupportCanvas3D *context);
     void setLights();
     void renderGeometry();
 
-    std::unique_ptr<CS123::GL::CS123Shader> m_phongShader;
+    std::unique_ptr<CS123::GL::ShaderVariants<CS123::GL::CS123Shader>> m_phongVariants;
+    CS123::GL::CS123Shader *m_phongShader; // variant for the current settings
     std::unique_ptr<CS123::GL::Shader> m_wireframeShader;
     std::unique_ptr<CS123::GL::Shader> m_normalsShader;
     std::unique_ptr<CS123::GL::Shader> m_normalsArrowShader;
 
+    // Camera and light blocks shared by all of the shaders above.
+    std::unique_ptr<CS123::GL::FrameUniforms> m_frameUniforms;
+
 };
 
 #endif // SCENEVIEWSCENE_H
@@ -5,7 +5,7 @@
 #include <SupportCanvas3D.h>
 #include <QFileDialog>
 
-#include <sstream>
+#include <cstring>
 #include <iostream>
 
 #include "shapes/ExampleShape.h"
@@ -13,26 +13,51 @@
 
 using namespace CS123::GL;
 #include "gl/shaders/CS123Shader.h"
+#include "gl/shaders/FrameUniforms.h"
 #include "gl/shaders/Shader.h"
 #include "gl/shaders/ShaderAttribLocations.h"
-
+#include "gl/shaders/ShaderVariants.h"
+#include "gl/textures/CubeMapLoader.h"
+
+#include "AllocationTracker.h"
+#include "shapes/Checkpoint.h"
+#include "shapes/EmbeddedMesh.h"
+#include "PerformanceMonitor.h"
+#include "Profiler.h"
 #include "ResourceLoader.h"
+#include "SkyboxLibrary.h"
 #include "shapes/ExampleShape.h"
 #include "shapes/JelloCube.h"
 #include "shapes/Bbox.h"
 #include "shapes/SpringMassCube.h"
+#include "shapes/Trajectory.h"
 
 
 #include "gl/shaders/ShaderAttribLocations.h"
 
-// added by Marc - from lab 11
-#define STB_IMAGE_IMPLEMENTATION
-#include "stb_image.h"
-
 ShapesScene::ShapesScene(int width, int height) :
+    m_skyboxCube(GeometryCache::INVALID_HANDLE),
+    m_cubeMapTexture(0),
+    m_glassReady(false),
+    m_jelloShader(nullptr),
+    m_phongShader(nullptr),
+    m_gpuProfiler(std::make_unique<GpuProfiler>()),
+    m_uniformsPass(m_gpuProfiler->addPass("uniforms")),
+    m_bboxPass(m_gpuProfiler->addPass("bbox")),
+    m_phongPass(m_gpuProfiler->addPass("phong")),
+    m_wireframePass(m_gpuProfiler->addPass("wireframe")),
+    m_normalsPass(m_gpuProfiler->addPass("normals")),
+    m_skyboxPass(m_gpuProfiler->addPass("skybox")),
+    m_glassPass(m_gpuProfiler->addPass("glass")),
+    m_frameUniforms(std::make_unique<FrameUniforms>()),
+    m_geometryCache(std::make_unique<GeometryCache>()),
     m_shape(nullptr),
-    m_bbox(std::make_unique<Bbox>()),
+    m_bbox(std::make_unique<Bbox>(*m_geometryCache)),
+    m_recordEvery(1),
+    m_recordSteps(0),
+    m_playbackFrame(0),
     m_shapeParameter1(-1),
+    m_renderDetail(0),
     m_width(width),
     m_height(height),
     m_simType(-1),
@@ -41,15 +66,11 @@ ShapesScene::ShapesScene(int width, int height) :
     initializeSceneMaterial();
     initializeSceneLight();
     loadPhongShader();
-    loadWireframeShader();
-    loadNormalsShader();
-    loadNormalsArrowShader();
     loadTestShader();
+    selectShaderVariants();
+    resolveUniformHandles();
 
-    //added by Marc
-    loadSkyboxShader();
-    m_cubeMapTexture = setSkyboxUniforms(m_skyboxShader.get());
-    loadJelloShader();
+    // The wireframe, normals, skybox and glass passes are only built the first time they're drawn.
     //glDisable(GL_DEPTH_TEST);
 
     // [SHAPES] Allocate any additional memory you need...
@@ -58,6 +79,9 @@ ShapesScene::ShapesScene(int width, int height) :
 ShapesScene::~ShapesScene()
 {
     // Pro-tip: If you use smart pointers properly, this destructor should be empty
+    for (auto &texture : m_cubeMapTextures) {
+        glDeleteTextures(1, &texture.second);
+    }
 }
 
 void ShapesScene::initializeSceneMaterial() {
@@ -80,11 +104,46 @@ void ShapesScene::initializeSceneLight() {
     m_light.id = 0;
 }
 
-void ShapesScene::loadJelloShader() {
-    std::string vertexSource = ResourceLoader::loadResourceFileToString(":/shaders/glass.vert");
-    std::string fragmentSource = ResourceLoader::loadResourceFileToString(":/shaders/glass.frag");
+void ShapesScene::resolveUniformHandles() {
+    m_testColorUniform = m_testShader->getUniform("color");
+}
+
+void ShapesScene::selectShaderVariants() {
+    std::vector<std::string> phongDefines;
+    if (settings.useLighting) phongDefines.push_back("USE_LIGHTING");
+    m_phongShader = m_phongVariants->get(phongDefines);
+
+    if (!m_jelloVariants) return;
 
-    m_jelloShader = std::make_unique<CS123Shader>(vertexSource, fragmentSource);
+    // Matches the JELLO_COLOR values in glass.frag.
+    int color = 0;
+    if (settings.jelloColor == JC_Red) {
+        color = 1;
+    } else if (settings.jelloColor == JC_Green) {
+        color = 2;
+    } else if (settings.jelloColor == JC_Blue) {
+        color = 0;
+    } else {
+        // white
+        color = 3;
+    }
+
+    std::vector<std::string> jelloDefines;
+    jelloDefines.push_back("JELLO_COLOR " + std::to_string(color));
+    if (settings.useLighting) jelloDefines.push_back("USE_LIGHTING");
+    if (settings.useChromaticRefraction) jelloDefines.push_back("CHROMATIC_REFRACTION");
+    CS123Shader *previous = m_jelloShader;
+    m_jelloShader = m_jelloVariants->get(jelloDefines);
+
+    // A variant that hasn't been used yet may still be compiling, so readiness is checked again.
+    if (m_jelloShader != previous && m_glassReady) {
+        m_glassReady = false;
+        m_glassRequestTime = std::chrono::steady_clock::now();
+    }
+}
+
+void ShapesScene::loadJelloShader() {
+    m_jelloVariants = std::make_unique<ShaderVariants<CS123Shader>>(":/shaders/glass.vert", ":/shaders/glass.frag");
 }
 
 void ShapesScene::loadSkyboxShader() {
@@ -96,13 +155,15 @@ void ShapesScene::loadSkyboxShader() {
     m_skyboxShader = std::make_unique<Shader>(vertexSource, fragmentSource);
 
 //      Loading CubeMap data
-    m_skyboxCube = std::make_unique<ExampleShape2>(1);
+    std::vector<float> cubeData = CUBE_DATA_POSITIONS_2;
+    std::vector<VBOAttribMarker> markers;
+    markers.push_back(VBOAttribMarker(ShaderAttrib::POSITION, 3, 0));
+    markers.push_back(VBOAttribMarker(ShaderAttrib::NORMAL, 3, 3*sizeof(float)));
+    m_skyboxCube = m_geometryCache->upload("skybox", cubeData, markers, VBO::GEOMETRY_LAYOUT::LAYOUT_TRIANGLES);
 }
 
 void ShapesScene::loadPhongShader() {
-    std::string vertexSource = ResourceLoader::loadResourceFileToString(":/shaders/default.vert");
-    std::string fragmentSource = ResourceLoader::loadResourceFileToString(":/shaders/default.frag");
-    m_phongShader = std::make_unique<CS123Shader>(vertexSource, fragmentSource);
+    m_phongVariants = std::make_unique<ShaderVariants<CS123Shader>>(":/shaders/default.vert", ":/shaders/default.frag");
 }
 
 void ShapesScene::loadWireframeShader() {
@@ -132,6 +193,8 @@ void ShapesScene::loadTestShader() {
 }
 
 void ShapesScene::render(SupportCanvas3D *context) {
+    PROFILE_SCOPE("ShapesScene::render");
+    ALLOCATION_PHASE("render");
     // Clear the screen in preparation for the next frame. (Use a gray background instead of a
     // black one for drawing wireframe or normals so they will show up against the background.)
     glm::mat4x4 viewMat = context->getCamera()->getViewMatrix();
@@ -141,14 +204,24 @@ void ShapesScene::render(SupportCanvas3D *context) {
     m_shape->setGravity(settings.gravity,
                         glm::inverse(glm::transpose(glm::mat3x3(viewMat)))*worldSpaceDown);
 
+    m_gpuProfiler->beginFrame();
+
     setClearColor();
+    {
+        GpuProfiler::Scope timer(*m_gpuProfiler, m_uniformsPass);
+        updateFrameUniforms(context);
+    }
 
     glm::vec3 planeColor = glm::vec3(0.01, 0.66, 0.99);
 
-    if (m_usePhong) {
+    // The glass look needs the cubemap and glass shaders; until they have loaded in the
+    // background, the cheap phong pass stands in for it.
+    bool useGlass = !m_usePhong && glassResourcesReady();
+
+    if (!useGlass) {
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        m_gpuProfiler->begin(m_bboxPass);
         m_testShader->bind();
-        setMatrixUniforms(m_testShader.get(), context);
         glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
         m_bbox->drawBbox();
         glm::vec3 color = glm::vec3(0.1, 0.8, 0.1);
@@ -156,12 +229,13 @@ void ShapesScene::render(SupportCanvas3D *context) {
 //        m_bbox->drawFloor();
 
         if (settings.usePlane) {
-            m_testShader->setUniform("color", planeColor);
+            m_testShader->setUniform(m_testColorUniform, planeColor);
             m_bbox->drawPlane();
         }
 
-        m_testShader->setUniform("color", color);
+        m_testShader->setUniform(m_testColorUniform, color);
         m_testShader->unbind();
+        m_gpuProfiler->end(m_bboxPass);
 
         renderPhongPass(context);
 
@@ -180,19 +254,20 @@ void ShapesScene::render(SupportCanvas3D *context) {
 
         renderSkybox(context);
 
+        m_gpuProfiler->begin(m_bboxPass);
         m_testShader->bind();
-        setMatrixUniforms(m_testShader.get(), context);
         glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
         m_bbox->drawBbox();
         glm::vec3 color = glm::vec3(0.1, 0.8, 0.1);
 //        m_testShader->setUniform("color", color);
 //        m_bbox->drawFloor();
         if (settings.usePlane) {
-            m_testShader->setUniform("color", planeColor);
+            m_testShader->setUniform(m_testColorUniform, planeColor);
             m_bbox->drawPlane();
         }
-        m_testShader->setUniform("color", color);
+        m_testShader->setUniform(m_testColorUniform, color);
         m_testShader->unbind();
+        m_gpuProfiler->end(m_bboxPass);
 
         renderJelloPass(context);
 
@@ -205,46 +280,139 @@ void ShapesScene::render(SupportCanvas3D *context) {
   
 }
 
-// Need to confirm this works for both orbiting and camtrans camera D:
-void ShapesScene::renderJelloPass(SupportCanvas3D *context) {
-    m_jelloShader->bind();
+void ShapesScene::requestGlassResources() {
+    m_glassRequestTime = std::chrono::steady_clock::now();
+
+    // Loading the cubemap is the slow part, so it starts first and runs on worker threads while
+    // the shaders compile.
+    skyboxTexture(settings.skybox);
+    loadSkyboxShader();
+    loadJelloShader();
+    selectShaderVariants();
+}
+
+bool ShapesScene::glassResourcesReady() {
+    if (!m_skyboxShader) requestGlassResources();
+
+    // After a switch, the previous set stays up until the new one has loaded.
+    GLuint selected = skyboxTexture(settings.skybox);
+    if (selected != 0) m_cubeMapTexture = selected;
 
-    // clearLights()
-    for (int i = 0; i < MAX_NUM_LIGHTS; i++) {
-        std::ostringstream os;
-        os << i;
-        std::string indexString = "[" + os.str() + "]"; // e.g. [0], [1], etc.
-        m_jelloShader->setUniform("lightColors" + indexString, glm::vec3(0.0f, 0.0f, 0.0f));
+    if (m_cubeMapTexture == 0 || !m_skyboxShader->isReady() || !m_jelloShader->isReady()) {
+        return false;
     }
 
-    // setLights()
-    m_light.dir = glm::inverse(context->getCamera()->getViewMatrix()) * m_lightDirection;
+    if (!m_glassReady) {
+        m_glassReady = true;
+        std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - m_glassRequestTime;
+        std::cout << "Glass resources ready after " << elapsed.count() << " ms" << std::endl;
+    }
 
-    // clearLights();
-    for (int i = 0; i < MAX_NUM_LIGHTS; i++) {
-        std::ostringstream os;
-        os << i;
-        std::string indexString = "[" + os.str() + "]"; // e.g. [0], [1], etc.
-        m_jelloShader->setUniform("lightColors" + indexString, glm::vec3(0.0f, 0.0f, 0.0f));
+    prefetchSkyboxes();
+    return true;
+}
+
+bool ShapesScene::saveCheckpoint(const std::string &path) {
+    SimulationState state;
+    if (!m_shape || !m_shape->getState(state)) {
+        std::cerr << "The current shape has no simulation to checkpoint" << std::endl;
+        return false;
     }
-    m_jelloShader->setLight(m_light);
+    state.shapeType = m_shapeType;
+    return Checkpoint::save(path, state);
+}
 
-    m_jelloShader->setUniform("useLighting", settings.useLighting);
-    int color = 0;
-    if (settings.jelloColor == JC_Red) {
-        color = 1;
-    } else if (settings.jelloColor == JC_Green) {
-        color = 2;
-    } else if (settings.jelloColor == JC_Blue) {
-        color = 0;
-    } else {
-        // white
-        color = 3;
+bool ShapesScene::loadCheckpoint(const std::string &path) {
+    auto start = std::chrono::steady_clock::now();
+    Checkpoint checkpoint(path);
+    if (!checkpoint.isValid()) return false;
+
+    const SimulationState &state = checkpoint.state();
+    if (state.shapeType < 0 || state.shapeType >= NUM_SHAPE_TYPES) {
+        std::cerr << "Checkpoint " << path << " has an unknown shape type " << state.shapeType << std::endl;
+        return false;
     }
-    m_jelloShader->setUniform("jelloColor", color);
 
-    // Pass in uniforms for view, projection, model (mat4(1.0))
-    setMatrixUniforms(m_jelloShader.get(), context);
+    settings.shapeType = state.shapeType;
+    settings.shapeParameter1 = state.param1;
+    settings.kElastic = state.kElastic;
+    settings.dElastic = state.dElastic;
+    settings.kCollision = state.kCollision;
+    settings.dCollision = state.dCollision;
+    settings.mass = state.mass;
+    settings.gravity = glm::length(state.gravity);
+    if (!m_shape || m_shapeType != state.shapeType || m_shapeParameter1 != state.param1) {
+        settingsChanged();
+    }
+
+    if (!m_shape->setState(state)) {
+        std::cerr << "Checkpoint " << path << " doesn't fit the current shape" << std::endl;
+        return false;
+    }
+
+    std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "Restored " << state.count << " points from " << path << " in " << elapsed.count() << " ms" << std::endl;
+    return true;
+}
+
+void ShapesScene::finishLoading() {
+    if (m_usePhong) return;
+
+    if (!m_skyboxShader) requestGlassResources();
+
+    // Each of these blocks on its own loader thread or on the driver, rather than polling.
+    skyboxTexture(settings.skybox, true);
+    m_skyboxShader->waitUntilReady();
+    m_jelloShader->waitUntilReady();
+    glassResourcesReady();
+}
+
+GLuint ShapesScene::skyboxTexture(const std::string &name, bool wait) {
+    const SkyboxSet *set = SkyboxLibrary::find(name);
+    if (!set) return 0;
+
+    auto resident = m_cubeMapTextures.find(set->name);
+    if (resident != m_cubeMapTextures.end()) return resident->second;
+
+    std::unique_ptr<CubeMapLoader> &loader = m_cubeMapLoaders[set->name];
+    if (!loader) {
+        loader = std::make_unique<CubeMapLoader>(set->faces, set->cachePath);
+    }
+    if (!wait && !loader->isDecoded()) return 0;
+
+    GLuint texture = loader->createTexture();
+    m_cubeMapLoaders.erase(set->name);
+    m_cubeMapTextures[set->name] = texture;
+    return texture;
+}
+
+void ShapesScene::prefetchSkyboxes() {
+    // One set at a time, so prefetching never competes with the set that is actually selected.
+    for (const auto &loading : m_cubeMapLoaders) {
+        if (!loading.second->isDecoded()) return;
+    }
+
+    for (const SkyboxSet &set : SkyboxLibrary::sets()) {
+        if (m_cubeMapTextures.count(set.name) || m_cubeMapLoaders.count(set.name)) continue;
+        m_cubeMapLoaders[set.name] = std::make_unique<CubeMapLoader>(set.faces, set.cachePath);
+        return;
+    }
+}
+
+void ShapesScene::updateFrameUniforms(SupportCanvas3D *context) {
+    Camera *camera = context->getCamera();
+    m_frameUniforms->setCamera(camera->getProjectionMatrix(), camera->getViewMatrix());
+    setLights(camera->getViewMatrix());
+    m_frameUniforms->upload();
+    // Everything in this scene is drawn where its vertices already are.
+    m_frameUniforms->setModel(glm::mat4(1.0f));
+}
+
+// Need to confirm this works for both orbiting and camtrans camera D:
+void ShapesScene::renderJelloPass(SupportCanvas3D *context) {
+    GpuProfiler::Scope timer(*m_gpuProfiler, m_glassPass);
+    m_jelloShader->bind();
+
     // Pass in our environment map
     glBindTexture(GL_TEXTURE_CUBE_MAP, m_cubeMapTexture);
 
@@ -254,6 +422,7 @@ void ShapesScene::renderJelloPass(SupportCanvas3D *context) {
 }
 
 void ShapesScene::renderSkybox(SupportCanvas3D *context) {
+    GpuProfiler::Scope timer(*m_gpuProfiler, m_skyboxPass);
 
 //    glFrontFace(GL_CW);
 
@@ -264,12 +433,9 @@ void ShapesScene::renderSkybox(SupportCanvas3D *context) {
     glDepthMask(GL_FALSE);
 
 //    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    m_skyboxShader->setUniform("projection", context->getCamera()->getProjectionMatrix());
-    m_skyboxShader->setUniform("view", glm::mat4(glm::mat3(context->getCamera()->getViewMatrix())));
-
     glBindTexture(GL_TEXTURE_CUBE_MAP, m_cubeMapTexture);
     glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-    m_skyboxCube->draw();
+    m_geometryCache->draw(m_skyboxCube);
 
     glDepthMask(GL_TRUE);
     glFrontFace(GL_CCW);
@@ -280,85 +446,33 @@ void ShapesScene::renderSkybox(SupportCanvas3D *context) {
 //    glFrontFace(GL_CCW);
 }
 
-unsigned int ShapesScene::setSkyboxUniforms(Shader *shader) {
-    // [NOTE] Need to use absolute paths
-    std::vector<std::string> faces =  {"/Users/seanzhan/course/cs1230/jellooo-bois/textures/bridge-waterfall/posx.jpg",
-                                       "/Users/seanzhan/course/cs1230/jellooo-bois/textures/bridge-waterfall/negx.jpg",
-                                       "/Users/seanzhan/course/cs1230/jellooo-bois/textures/bridge-waterfall/posy.jpg",
-                                       "/Users/seanzhan/course/cs1230/jellooo-bois/textures/bridge-waterfall/negy.jpg",
-                                       "/Users/seanzhan/course/cs1230/jellooo-bois/textures/bridge-waterfall/posz.jpg",
-                                       "/Users/seanzhan/course/cs1230/jellooo-bois/textures/bridge-waterfall/negz.jpg"};
-
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
-
-    int width, height, nrChannels;
-    for (unsigned int i = 0; i < 6; i++)
-    {
-        unsigned char *data = stbi_load(faces[i].c_str(), &width, &height, &nrChannels, 0);
-//        std::cout << width << std::endl;
-//        std::cout << height << std::endl;
-//        std::cout << nrChannels << std::endl;
-        if (data)
-        {
-            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i,
-                         0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data
-            );
-            free(data);
-        }
-        else
-        {
-            std::cout << "Cubemap tex failed to load at path: " << faces[i] << std::endl;
-            std::cout << "Possible Fix: Change texture paths in ShapesScene.cpp :D" << std::endl;
-            free(data);
-        }
-    }
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-
-    return textureID;
-}
-
 void ShapesScene::renderPhongPass(SupportCanvas3D *context) {
+    GpuProfiler::Scope timer(*m_gpuProfiler, m_phongPass);
     m_phongShader->bind();
 
         // -------------------------------------------------
 //    if (m_usePhong) {
 //        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 //    }
-    clearLights();
-    setLights(context->getCamera()->getViewMatrix());
     setPhongSceneUniforms();
-    setMatrixUniforms(m_phongShader.get(), context);
     renderGeometryAsFilledPolygons();
 
     m_phongShader->unbind();
 }
 
 void ShapesScene::setPhongSceneUniforms() {
-    m_phongShader->setUniform("useLighting", settings.useLighting);
-    m_phongShader->setUniform("useArrowOffsets", false);
     m_phongShader->applyMaterial(m_material);
 }
 
-void ShapesScene::setMatrixUniforms(Shader *shader, SupportCanvas3D *context) {
-    shader->setUniform("p", context->getCamera()->getProjectionMatrix());
-    shader->setUniform("v", context->getCamera()->getViewMatrix());
-    shader->setUniform("m", glm::mat4(1.0f));
-}
-
 void ShapesScene::renderGeometryAsFilledPolygons() {
     glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
     renderGeometry();
 }
 
 void ShapesScene::renderWireframePass(SupportCanvas3D *context) {
+    GpuProfiler::Scope timer(*m_gpuProfiler, m_wireframePass);
+    if (!m_wireframeShader) loadWireframeShader();
     m_wireframeShader->bind();
-    setMatrixUniforms(m_wireframeShader.get(), context);
     renderGeometryAsWireframe();
     m_wireframeShader->unbind();
 }
@@ -372,15 +486,19 @@ void ShapesScene::renderGeometryAsWireframe() {
 }
 
 void ShapesScene::renderNormalsPass (SupportCanvas3D *context) {
+    GpuProfiler::Scope timer(*m_gpuProfiler, m_normalsPass);
+    if (!m_normalsShader) {
+        loadNormalsShader();
+        loadNormalsArrowShader();
+    }
+
     // Render the lines.
     m_normalsShader->bind();
-    setMatrixUniforms(m_normalsShader.get(), context);
     renderGeometryAsWireframe();
     m_normalsShader->unbind();
 
     // Render the arrows.
     m_normalsArrowShader->bind();
-    setMatrixUniforms(m_normalsArrowShader.get(), context);
     renderGeometryAsFilledPolygons();
     m_normalsArrowShader->unbind();
 }
@@ -396,13 +514,7 @@ void ShapesScene::renderGeometry() {
 }
 
 void ShapesScene::clearLights() {
-    for (int i = 0; i < MAX_NUM_LIGHTS; i++) {
-        std::ostringstream os;
-        os << i;
-        std::string indexString = "[" + os.str() + "]"; // e.g. [0], [1], etc.
-        m_phongShader->setUniform("lightColors" + indexString, glm::vec3(0.0f, 0.0f, 0.0f));
-        m_testShader->setUniform("lightColors" + indexString, glm::vec3(0.0f, 0.0f, 0.0f));
-    }
+    m_frameUniforms->clearLights();
 }
 
 void ShapesScene::setLights(const glm::mat4 viewMatrix) {
@@ -411,13 +523,30 @@ void ShapesScene::setLights(const glm::mat4 viewMatrix) {
     m_light.dir = glm::inverse(viewMatrix) * m_lightDirection;
 
     clearLights();
-    m_phongShader->setLight(m_light);
-    m_testShader->setLight(m_light);
+    m_frameUniforms->setLight(m_light);
 }
 
 void ShapesScene::settingsChanged() {
-    // Change SIMULATION Type Here based on Settings
-    // TODO: eventually add if statements and member variables to check what type of setting was changed
+    // Render-only settings (colors, wireframe, skybox, ...) are read every frame; only the shader
+    // variants have to be picked again.
+    selectShaderVariants();
+
+    // Only a different shape, resolution or sim type needs a new body. Anything else that changed
+    // is a physics constant, and is applied to the running one so the simulation carries on.
+    bool rebuild = !m_shape || settings.shapeType != m_shapeType ||
+                   settings.shapeParameter1 != m_shapeParameter1 || settings.simType != m_simType;
+    bool remesh = updateRenderGeometry();
+    if (!rebuild) {
+        m_shape->setMaterial(settings.kElastic, settings.dElastic, settings.kCollision, settings.dCollision,
+                             settings.mass);
+        if (remesh) m_shape->setRenderMesh(m_renderGeometry);
+        m_shape->setSurfaceSmoothing(settings.surfaceSmoothing);
+        return;
+    }
+
+    // A new shape or resolution carries on from the current motion; a new sim type starts over.
+    bool restart = settings.simType != m_simType;
+    std::unique_ptr<OpenGLShape> previous = std::move(m_shape);
 
     // Type
     if (settings.simType != m_simType) {
@@ -437,7 +566,6 @@ void ShapesScene::settingsChanged() {
         }
         m_simType = settings.simType;
     }
-    // TODO: check if params are the same
 
         m_shapeParameter1 = settings.shapeParameter1;
 //        m_shapeParameter2 = settings.shapeParameter2;
@@ -475,11 +603,167 @@ void ShapesScene::settingsChanged() {
             break;
         }
         m_shapeType = settings.shapeType;
+        if (m_renderGeometry) m_shape->setRenderMesh(m_renderGeometry);
+        m_shape->setSurfaceSmoothing(settings.surfaceSmoothing);
+
+        if (previous && !restart && !m_player) {
+            transferState(*previous);
+        }
+
+        if (m_player && !m_shape->setPositions(m_playbackPoints.data(), m_playbackPoints.size(),
+                                               static_cast<LatticeLayout::Order>(m_player->header().latticeOrder))) {
+            std::cout << "The recording doesn't fit the new shape; stopping playback" << std::endl;
+            stopPlayback();
+        }
+}
+
+bool ShapesScene::transferState(OpenGLShape &previous) {
+    SimulationState from, to;
+    if (!previous.getState(from) || !m_shape->getState(to)) return false;
+
+    // The new shape already has the current settings' constants; only the motion is carried over.
+    LatticeLayout fromLattice(from.param1 + 1, static_cast<LatticeLayout::Order>(from.latticeOrder));
+    LatticeLayout toLattice(to.param1 + 1, static_cast<LatticeLayout::Order>(to.latticeOrder));
+    std::vector<glm::vec3> points(toLattice.size()), velocity(toLattice.size());
+    JelloUtil::resample(fromLattice, from.points, toLattice, points.data());
+    JelloUtil::resample(fromLattice, from.velocity, toLattice, velocity.data());
+    to.points = points.data();
+    to.velocity = velocity.data();
+    return m_shape->setState(to);
+}
+
+bool ShapesScene::updateRenderGeometry() {
+    if (settings.renderDetail == m_renderDetail && settings.renderMesh == m_renderMeshPath) return false;
+    m_renderDetail = settings.renderDetail;
+    m_renderMeshPath = settings.renderMesh;
+
+    // A mesh given on the command line wins; if it can't be read, it is dropped and the detail
+    // setting applies.
+    m_renderGeometry.reset();
+    if (!m_renderMeshPath.empty()) {
+        m_renderGeometry = MeshGeometry::loadOBJ(m_renderMeshPath);
+        if (!m_renderGeometry) {
+            std::cerr << "Not drawing render mesh " << m_renderMeshPath << "; drawing "
+                      << (m_renderDetail > 0 ? "the render detail grid" : "the lattice") << " instead" << std::endl;
+            settings.renderMesh.clear();
+            m_renderMeshPath.clear();
+        }
+    }
+    if (!m_renderGeometry && m_renderDetail > 0) {
+        m_renderGeometry = MeshGeometry::subdividedCube(m_renderDetail);
+    }
+    if (m_renderGeometry) {
+        std::cout << "Rendering " << m_renderGeometry->indices.size() / 3 << " triangles over the lattice" << std::endl;
+    }
+    return true;
+}
+
+bool ShapesScene::setRenderMesh(const std::string &path) {
+    settings.renderMesh = path;
+    if (updateRenderGeometry() && m_shape) m_shape->setRenderMesh(m_renderGeometry);
+    return settings.renderMesh == path;
+}
+
+bool ShapesScene::startRecording(const std::string &path, int every) {
+    stopRecording();
+    SimulationState state;
+    if (!m_shape || !m_shape->getState(state)) {
+        std::cerr << "The current shape has no simulation to record" << std::endl;
+        return false;
+    }
+
+    // A fixed box a little larger than the walls keeps quantization at ~0.07 mm per step, and lets
+    // recordings of different runs share the same bounds.
+    m_recorder = std::make_unique<TrajectoryWriter>(path, m_shapeType, state.param1, state.count,
+                                                    state.latticeOrder, glm::vec3(-2.25f), glm::vec3(2.25f));
+    if (!m_recorder->isValid()) {
+        m_recorder.reset();
+        return false;
+    }
+    m_recordEvery = std::max(every, 1);
+    m_recordSteps = 0;
+    std::cout << "Recording every " << m_recordEvery << " steps to " << path << std::endl;
+    return true;
+}
+
+void ShapesScene::stopRecording() {
+    if (!m_recorder) return;
+    bool written = m_recorder->finish();
+    std::cout << "Recorded " << m_recorder->framesWritten() << " frames"
+              << (written ? "" : " (the file is incomplete)") << std::endl;
+    m_recorder.reset();
+}
+
+bool ShapesScene::startPlayback(const std::string &path) {
+    auto player = std::make_unique<TrajectoryReader>(path);
+    if (!player->isValid()) return false;
+
+    const TrajectoryHeader &header = player->header();
+    if (header.shapeType < 0 || header.shapeType >= NUM_SHAPE_TYPES) {
+        std::cerr << "Trajectory " << path << " has an unknown shape type " << header.shapeType << std::endl;
+        return false;
+    }
+    stopRecording();
+    stopPlayback();
+
+    settings.shapeType = header.shapeType;
+    settings.shapeParameter1 = header.param1;
+    if (!m_shape || m_shapeType != header.shapeType || m_shapeParameter1 != header.param1) {
+        settingsChanged();
+    }
+
+    m_player = std::move(player);
+    m_playbackFrame = -1;
+    seekPlayback(0);
+    if (!m_player) {
+        std::cerr << "Trajectory " << path << " doesn't fit the current shape" << std::endl;
+        return false;
+    }
+    std::cout << "Playing " << m_player->frameCount() << " frames from " << path << std::endl;
+    return true;
+}
+
+void ShapesScene::stopPlayback() {
+    m_player.reset();
+    m_playbackPoints.clear();
+}
+
+int ShapesScene::playbackFrameCount() const {
+    return m_player ? m_player->frameCount() : 0;
+}
+
+void ShapesScene::seekPlayback(int frame) {
+    if (!m_player || frame == m_playbackFrame) return;
+    if (!m_player->read(frame, m_playbackPoints) ||
+            !m_shape->setPositions(m_playbackPoints.data(), m_playbackPoints.size(),
+                                   static_cast<LatticeLayout::Order>(m_player->header().latticeOrder))) {
+        stopPlayback();
+        return;
+    }
+    m_playbackFrame = frame;
 }
 
 void ShapesScene::tick(float current) {
+    if (m_player) {
+        // Playback only moves the lattice; there is nothing to simulate.
+        seekPlayback((m_playbackFrame + 1) % m_player->frameCount());
+        return;
+    }
+
     if (m_simType != SIM_STATIC_CUBE){
+        ALLOCATION_PHASE("tick");
         m_shape->tick(current);
+        PerformanceMonitor::recordSimStep(m_shape->getTimestep());
+    }
+
+    if (m_recorder && m_recordSteps++ % m_recordEvery == 0) {
+        SimulationState state;
+        if (!m_shape->getState(state) || state.count != m_recorder->count()) {
+            std::cerr << "The cube changed size; stopping the recording" << std::endl;
+            stopRecording();
+            return;
+        }
+        m_recorder->push(state.points);
     }
 }
 
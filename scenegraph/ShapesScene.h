@@ -3,11 +3,15 @@
 
 #include "OpenGLScene.h"
 
+#include <chrono>
+#include <map>
 #include <memory>
 
 #include <GL/glew.h>
 
 #include "gl/datatype/FBO.h"
+#include "gl/shaders/Shader.h"
+#include "gl/util/GpuProfiler.h"
 #include "Settings.h"
 #include "shapes/Shape.h"
 //#include "uniforms/uniformvariable.h"
@@ -18,10 +22,15 @@ namespace CS123 { namespace GL {
     class Shader;
     class CS123Shader;
     class FullScreenQuad;
+    class FrameUniforms;
+    class CubeMapLoader;
+    template <typename ShaderType> class ShaderVariants;
 
 }}
 
 class OpenGLShape;
+class TrajectoryReader;
+class TrajectoryWriter;
 
 /**
  *
@@ -49,9 +58,41 @@ public:
     virtual void settingsChanged() override;
     virtual void tick(float current) override;
 
+    // Blocks until everything the current settings draw with has loaded, so an offscreen export
+    // doesn't start with the phong stand-in for the glass.
+    void finishLoading();
+
+    // Saves the simulated cube (lattice, velocities and constants) as a binary checkpoint.
+    bool saveCheckpoint(const std::string &path);
+
+    // Continues the simulation from a checkpoint, rebuilding the cube first if the checkpoint is a
+    // different shape or resolution. The checkpoint's shape and constants are copied into the
+    // settings too, so they stick until the next settings change.
+    bool loadCheckpoint(const std::string &path);
+
+    // Draws the OBJ at path over the lattice in place of the render detail setting. False, after
+    // printing why, if it can't be read.
+    bool setRenderMesh(const std::string &path);
+
+    // Streams every `every`th simulation step to a compressed trajectory file until stopped.
+    bool startRecording(const std::string &path, int every);
+    void stopRecording();
+    bool isRecording() const { return m_recorder != nullptr; }
+
+    // Replays a recorded trajectory in a loop instead of simulating, rebuilding the cube first if
+    // the recording is a different shape or resolution.
+    bool startPlayback(const std::string &path);
+    void stopPlayback();
+    bool isPlaying() const { return m_player != nullptr; }
+    int playbackFrameCount() const;
+    int playbackFrame() const { return m_playbackFrame; }
+    void seekPlayback(int frame);
+
+    // GPU and CPU time of each render pass, averaged over recent frames.
+    const CS123::GL::GpuProfiler &gpuProfiler() const { return *m_gpuProfiler; }
 
 protected:
-    // Set the light uniforms for the lights in the scene. (The view matrix is used so that the
+    // Set the lights in the shared Lights block. (The view matrix is used so that the
     // light can follows the camera.)
     virtual void setLights(const glm::mat4 viewMatrix);
 
@@ -65,32 +106,92 @@ private:
 
     // Added by Marc
     std::unique_ptr<CS123::GL::Shader> m_skyboxShader;
-    std::unique_ptr<OpenGLShape> m_skyboxCube;
+    CS123::GL::GeometryCache::Handle m_skyboxCube;
     void loadSkyboxShader();
     void renderSkybox(SupportCanvas3D *context);
-    unsigned int setSkyboxUniforms(CS123::GL::Shader *shader);
-    unsigned int m_cubeMapTexture;
+    unsigned int m_cubeMapTexture; // the set being drawn; one of m_cubeMapTextures
+
+    // The cubemap and glass shaders are only loaded once the glass look is first needed, and
+    // load in the background: glassResourcesReady() is false until they can be drawn.
+    void requestGlassResources();
+    bool glassResourcesReady();
+    bool m_glassReady;
+    std::chrono::steady_clock::time_point m_glassRequestTime;
+
+    // Every skybox set that has been shown stays on the GPU, and the others are loaded one at a
+    // time in the background, so switching sets doesn't have to wait for a decode.
+    // 0 while the set is still loading, unless wait is set, which blocks until it has loaded.
+    GLuint skyboxTexture(const std::string &name, bool wait = false);
+    void prefetchSkyboxes();
+    std::map<std::string, GLuint> m_cubeMapTextures;
+    std::map<std::string, std::unique_ptr<CS123::GL::CubeMapLoader>> m_cubeMapLoaders;
     void loadJelloShader();
-    std::unique_ptr<CS123::GL::CS123Shader> m_jelloShader;
+    std::unique_ptr<CS123::GL::ShaderVariants<CS123::GL::CS123Shader>> m_jelloVariants;
+    CS123::GL::CS123Shader *m_jelloShader; // variant for the current settings, owned by m_jelloVariants
     void renderJelloPass(SupportCanvas3D *context);
     bool m_usePhong;
 
-    std::unique_ptr<CS123::GL::CS123Shader> m_phongShader;
+    std::unique_ptr<CS123::GL::ShaderVariants<CS123::GL::CS123Shader>> m_phongVariants;
+    CS123::GL::CS123Shader *m_phongShader; // variant for the current settings, owned by m_phongVariants
     std::unique_ptr<CS123::GL::Shader> m_wireframeShader;
     std::unique_ptr<CS123::GL::Shader> m_normalsShader;
     std::unique_ptr<CS123::GL::Shader> m_normalsArrowShader;
     std::unique_ptr<CS123::GL::Shader> m_fsqShader;
     std::unique_ptr<CS123::GL::CS123Shader> m_testShader;
+
+    // Uniform handles resolved once after the shaders load, so the per-frame path never builds
+    // or looks up a uniform name.
+    void resolveUniformHandles();
+    CS123::GL::Shader::UniformHandle m_testColorUniform;
+
+    // Lighting, jello color and refraction quality are compiled into the shaders rather than
+    // branched on per vertex/fragment, so a settings change switches programs instead.
+    void selectShaderVariants();
+
+    // Carries the motion of previous over to m_shape, resampled if the resolution changed; false if
+    // either doesn't simulate.
+    bool transferState(OpenGLShape &previous);
+
+    // Loads or builds the mesh the render settings ask for, if they changed; true if they did.
+    bool updateRenderGeometry();
     CS123SceneLightData  m_light;
     CS123SceneMaterial   m_material;
 
     glm::vec4 m_lightDirection = glm::normalize(glm::vec4(1.f, -1.f, -1.f, 0.f));
 
+    std::unique_ptr<CS123::GL::GpuProfiler> m_gpuProfiler;
+    CS123::GL::GpuProfiler::Pass m_uniformsPass;
+    CS123::GL::GpuProfiler::Pass m_bboxPass;
+    CS123::GL::GpuProfiler::Pass m_phongPass;
+    CS123::GL::GpuProfiler::Pass m_wireframePass;
+    CS123::GL::GpuProfiler::Pass m_normalsPass;
+    CS123::GL::GpuProfiler::Pass m_skyboxPass;
+    CS123::GL::GpuProfiler::Pass m_glassPass;
+
+    // Camera and light blocks, written once per frame and read by every shader.
+    std::unique_ptr<CS123::GL::FrameUniforms> m_frameUniforms;
+    void updateFrameUniforms(SupportCanvas3D *context);
+
+    // Static meshes (bounding box, plane, skybox) live here so they are only uploaded once.
+    std::unique_ptr<CS123::GL::GeometryCache> m_geometryCache;
     std::unique_ptr<OpenGLShape> m_shape;
     std::unique_ptr<Bbox> m_bbox;
+
+    std::unique_ptr<TrajectoryWriter> m_recorder;
+    int m_recordEvery;
+    int m_recordSteps;   // steps since recording started
+    std::unique_ptr<TrajectoryReader> m_player;
+    int m_playbackFrame; // shown by the shape right now
+    std::vector<glm::vec3> m_playbackPoints;
     int m_shapeParameter1;
     int m_shapeParameter2;
 
+    // What the shape draws instead of its lattice's surface, if anything; kept so that rebuilding
+    // the shape doesn't load it again.
+    std::shared_ptr<const MeshGeometry> m_renderGeometry;
+    int m_renderDetail;
+    std::string m_renderMeshPath;
+
     int m_width;
     int m_height;
 
@@ -112,7 +213,6 @@ private:
     void initializeSceneMaterial();
     void initializeSceneLight();
     void setPhongSceneUniforms();
-    void setMatrixUniforms(CS123::GL::Shader *shader, SupportCanvas3D *context);
     void renderFilledPolygons();
     void renderNormals();
     void renderWireframe();
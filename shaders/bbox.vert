@@ -8,18 +8,27 @@ layout(location = 10) in float arrowOffset; // Sideways offset for billboarded n
 out vec3 color; // Computed color for this vertex
 out vec2 texc;
 
-// Transformation matrices
-uniform mat4 p;
-uniform mat4 v;
-uniform mat4 m;
+// View and projection, shared by every shader for the whole frame (see UniformBlockBindings.h)
+layout(std140) uniform Camera {
+    mat4 p;
+    mat4 v;
+    mat4 vInverse;      // inverse(v)
+};
 
-// Light data
+// Model transform of the object being drawn, rewritten between draws
+layout(std140) uniform Object {
+    mat4 m;
+    mat4 normalMatrix;  // transpose(inverse(v * m)); use mat3(normalMatrix)
+};
+
+// Light data, shared by every shader
 const int MAX_LIGHTS = 10;
-uniform int lightTypes[MAX_LIGHTS];         // 0 for point, 1 for directional
-uniform vec3 lightPositions[MAX_LIGHTS];    // For point lights
-uniform vec3 lightDirections[MAX_LIGHTS];   // For directional lights
-//uniform vec3 lightAttenuations[MAX_LIGHTS]; // Constant, linear, and quadratic term
-uniform vec3 lightColors[MAX_LIGHTS];
+layout(std140) uniform Lights {
+    int lightTypes[MAX_LIGHTS];         // 0 for point, 1 for directional
+    vec3 lightPositions[MAX_LIGHTS];    // For point lights
+    vec3 lightDirections[MAX_LIGHTS];   // For directional lights
+    vec3 lightColors[MAX_LIGHTS];
+};
 
 // Material data
 uniform vec3 ambient_color;
@@ -28,52 +37,53 @@ uniform vec3 specular_color;
 uniform float shininess;
 uniform vec2 repeatUV;
 
-uniform bool useLighting;     // Whether to calculate lighting using lighting equation
-uniform bool useArrowOffsets; // True if rendering the arrowhead of a normal for Shapes
+// Variant defines (see ShaderVariants.h):
+//   USE_LIGHTING       Calculate lighting using the lighting equation
+//   USE_ARROW_OFFSETS  Rendering the arrowhead of a normal for Shapes
 
 void main() {
     gl_PointSize = 10;
     texc = texCoord * repeatUV;
 
     vec4 position_cameraSpace = v * m * vec4(position, 1.0);
-    vec4 normal_cameraSpace = vec4(normalize(mat3(transpose(inverse(v * m))) * normal), 0);
+    vec4 normal_cameraSpace = vec4(normalize(mat3(normalMatrix) * normal), 0);
 
     vec4 position_worldSpace = m * vec4(position, 1.0);
     vec4 normal_worldSpace = vec4(normalize(mat3(transpose(inverse(m))) * normal), 0);
 
-    if (useArrowOffsets) {
-        // Figure out the axis to use in order for the triangle to be billboarded correctly
-        vec3 offsetAxis = normalize(cross(vec3(position_cameraSpace), vec3(normal_cameraSpace)));
-        position_cameraSpace += arrowOffset * vec4(offsetAxis, 0);
-    }
+#ifdef USE_ARROW_OFFSETS
+    // Figure out the axis to use in order for the triangle to be billboarded correctly
+    vec3 offsetAxis = normalize(cross(vec3(position_cameraSpace), vec3(normal_cameraSpace)));
+    position_cameraSpace += arrowOffset * vec4(offsetAxis, 0);
+#endif
 
     gl_Position = p * position_cameraSpace;
 
-    if (useLighting) {
-        color = ambient_color.xyz; // Add ambient component
-
-        for (int i = 0; i < MAX_LIGHTS; i++) {
-            vec4 vertexToLight = vec4(0);
-            // Point Light
-            if (lightTypes[i] == 0) {
-                vertexToLight = normalize(v * vec4(lightPositions[i], 1) - position_cameraSpace);
-            } else if (lightTypes[i] == 1) {
-                // Dir Light
-                vertexToLight = normalize(v * vec4(-lightDirections[i], 0));
-            }
-
-            // Add diffuse component
-            float diffuseIntensity = max(0.0, dot(vertexToLight, normal_cameraSpace));
-            color += max(vec3(0), lightColors[i] * diffuse_color * diffuseIntensity);
-
-            // Add specular component
-            vec4 lightReflection = normalize(-reflect(vertexToLight, normal_cameraSpace));
-            vec4 eyeDirection = normalize(vec4(0,0,0,1) - position_cameraSpace);
-            float specIntensity = pow(max(0.0, dot(eyeDirection, lightReflection)), shininess);
-            color += max (vec3(0), lightColors[i] * specular_color * specIntensity);
+#ifdef USE_LIGHTING
+    color = ambient_color.xyz; // Add ambient component
+
+    for (int i = 0; i < MAX_LIGHTS; i++) {
+        vec4 vertexToLight = vec4(0);
+        // Point Light
+        if (lightTypes[i] == 0) {
+            vertexToLight = normalize(v * vec4(lightPositions[i], 1) - position_cameraSpace);
+        } else if (lightTypes[i] == 1) {
+            // Dir Light
+            vertexToLight = normalize(v * vec4(-lightDirections[i], 0));
         }
-    } else {
-        color = ambient_color + diffuse_color;
+
+        // Add diffuse component
+        float diffuseIntensity = max(0.0, dot(vertexToLight, normal_cameraSpace));
+        color += max(vec3(0), lightColors[i] * diffuse_color * diffuseIntensity);
+
+        // Add specular component
+        vec4 lightReflection = normalize(-reflect(vertexToLight, normal_cameraSpace));
+        vec4 eyeDirection = normalize(vec4(0,0,0,1) - position_cameraSpace);
+        float specIntensity = pow(max(0.0, dot(eyeDirection, lightReflection)), shininess);
+        color += max (vec3(0), lightColors[i] * specular_color * specIntensity);
     }
+#else
+    color = ambient_color + diffuse_color;
+#endif
     color = clamp(color, 0.0, 1.0);
 }
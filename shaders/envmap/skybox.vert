@@ -6,10 +6,15 @@ layout (location = 0) in vec3 aPos;
 
 out vec3 pos_object;
 
-uniform mat4 view;
-uniform mat4 projection;
+// View and projection, shared by every shader for the whole frame (see UniformBlockBindings.h)
+layout(std140) uniform Camera {
+    mat4 p;
+    mat4 v;
+    mat4 vInverse;      // inverse(v)
+};
 
 void main() {
      pos_object = aPos;
-     gl_Position = projection * view * vec4(aPos * scale, 1);
+     // Drop the view translation so the skybox stays centered on the camera.
+     gl_Position = p * mat4(mat3(v)) * vec4(aPos * scale, 1);
 }
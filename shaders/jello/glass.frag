@@ -10,11 +10,21 @@ in float SpecularIntensity;
 float r0 = 0.3; // The R0 value to use in Schlick's approximation
 vec3  eta = vec3(0.79, 0.8, 0.81);  // Contains one eta for each channel (use eta.r, eta.g, eta.b in your code)
 
-uniform mat4 v;
-uniform mat4 m;
+// View and projection, shared by every shader for the whole frame (see UniformBlockBindings.h)
+layout(std140) uniform Camera {
+    mat4 p;
+    mat4 v;
+    mat4 vInverse;      // inverse(v)
+};
 
 uniform samplerCube skyBox;
-uniform int jelloColor;
+
+// Variant defines (see ShaderVariants.h):
+//   JELLO_COLOR           0 blue, 1 red, 2 green, 3 white
+//   CHROMATIC_REFRACTION  Refract each channel with its own eta (3 lookups instead of 1)
+#ifndef JELLO_COLOR
+#define JELLO_COLOR 3
+#endif
 
 out vec4 fragColor;
 
@@ -26,25 +36,31 @@ void main()
 
     // step 1
     vec4 reflectedDir = vec4(reflect(n, -1 * cameraToVertex), 0.0);
-    reflectedDir = inverse(v) * reflectedDir;
+    reflectedDir = vInverse * reflectedDir;
 
     vec4 reflectionColor = texture(skyBox , vec3(reflectedDir));
     reflectionColor.w = 1.0;
 
+#ifdef CHROMATIC_REFRACTION
     // step 2
     vec4 r_dir = vec4(refract(cameraToVertex, n, eta.r), 0.0);
     vec4 g_dir = vec4(refract(cameraToVertex, n, eta.g), 0.0);
     vec4 b_dir = vec4(refract(cameraToVertex, n, eta.b), 0.0);
 
-    r_dir = inverse(v) * r_dir;
-    g_dir = inverse(v) * g_dir;
-    b_dir = inverse(v) * b_dir;
+    r_dir = vInverse * r_dir;
+    g_dir = vInverse * g_dir;
+    b_dir = vInverse * b_dir;
 
     // step 3
     vec4 refractionColor = vec4(texture(skyBox, vec3(r_dir)).r,
                                 texture(skyBox, vec3(g_dir)).g,
                                 texture(skyBox, vec3(b_dir)).b,
                                 1.0);
+#else
+    // steps 2 and 3 with a single (green) eta for all channels
+    vec4 refractedDir = vInverse * vec4(refract(cameraToVertex, n, eta.g), 0.0);
+    vec4 refractionColor = vec4(texture(skyBox, vec3(refractedDir)).rgb, 1.0);
+#endif
 
     // step 4
     float cos_theta = dot(n, -1 * cameraToVertex);
@@ -62,35 +78,35 @@ void main()
     // Keep 1 Channel Color
 
 
-    if (jelloColor == 0) { // Blue
-        float prop = 0.5; // proportion of glass color to keep
-        fragColor.x *= 0.1;
-        fragColor.y *= 0.1;
-        fragColor.z = (1-prop) * 1.0 + prop * fragColor.z;
-        fragColor.w = 0.8;
-    } else if (jelloColor == 1) { // Red
-        float prop = 0.4; // proportion of glass color to keep
-        fragColor.z *= 0.1;
-        fragColor.y *= 0.1;
-        fragColor.x = (1-prop) * 1.0 + prop * fragColor.z;
-        fragColor.w = 0.8;
-    } else if (jelloColor == 2) { // Green
-        float prop = 0.5; // proportion of glass color to keep
-        fragColor.x *= 0.2;
-        fragColor.z *= 0.2;
-        fragColor.y = (1-prop) * 1.0 + prop * fragColor.z;
-        fragColor.w = 0.8;
-    } else { // white jello ish
-//        fragColor.x *= 1.0;
-//        fragColor.z *= 1.0;
-//        fragColor.y *= 1.0;
-//        fragColor.w = 0.1;
-        float prop = 0.4; // proportion of glass color to keep
-        fragColor.x = (1-prop) * 1.0 + prop * fragColor.x;
-        fragColor.z = (1-prop) * 1.0 + prop * fragColor.z;
-        fragColor.y = (1-prop) * 1.0 + prop * fragColor.y;
-        fragColor.w = 0.8;
-    }
+#if JELLO_COLOR == 0 // Blue
+    float prop = 0.5; // proportion of glass color to keep
+    fragColor.x *= 0.1;
+    fragColor.y *= 0.1;
+    fragColor.z = (1-prop) * 1.0 + prop * fragColor.z;
+    fragColor.w = 0.8;
+#elif JELLO_COLOR == 1 // Red
+    float prop = 0.4; // proportion of glass color to keep
+    fragColor.z *= 0.1;
+    fragColor.y *= 0.1;
+    fragColor.x = (1-prop) * 1.0 + prop * fragColor.z;
+    fragColor.w = 0.8;
+#elif JELLO_COLOR == 2 // Green
+    float prop = 0.5; // proportion of glass color to keep
+    fragColor.x *= 0.2;
+    fragColor.z *= 0.2;
+    fragColor.y = (1-prop) * 1.0 + prop * fragColor.z;
+    fragColor.w = 0.8;
+#else // white jello ish
+//    fragColor.x *= 1.0;
+//    fragColor.z *= 1.0;
+//    fragColor.y *= 1.0;
+//    fragColor.w = 0.1;
+    float prop = 0.4; // proportion of glass color to keep
+    fragColor.x = (1-prop) * 1.0 + prop * fragColor.x;
+    fragColor.z = (1-prop) * 1.0 + prop * fragColor.z;
+    fragColor.y = (1-prop) * 1.0 + prop * fragColor.y;
+    fragColor.w = 0.8;
+#endif
 
 
 //    fragColor = vec4(1.0, 0, 1.0, 1.0);
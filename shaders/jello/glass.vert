@@ -7,29 +7,43 @@ out vec3 vertex;	    // The position of the vertex, in camera space
 out vec3 vertexToCamera;    // Vector from the vertex to the eye, which is the camera
 out vec3 eyeNormal;	    // Normal of the vertex, in camera space
 
-uniform mat4 v;
-uniform mat4 p;
-uniform mat4 m;
+// View and projection, shared by every shader for the whole frame (see UniformBlockBindings.h)
+layout(std140) uniform Camera {
+    mat4 p;
+    mat4 v;
+    mat4 vInverse;      // inverse(v)
+};
+
+// Model transform of the object being drawn, rewritten between draws
+layout(std140) uniform Object {
+    mat4 m;
+    mat4 normalMatrix;  // transpose(inverse(v * m)); use mat3(normalMatrix)
+};
 
 // Added for SpecularIntensity and Light Information
 float shininess = 32.0;
 out float SpecularIntensity;
 
-// Light data
-const int MAX_LIGHTS = 4;
-uniform int lightTypes[MAX_LIGHTS];         // 0 for point, 1 for directional
-uniform vec3 lightPositions[MAX_LIGHTS];    // For point lights
-uniform vec3 lightDirections[MAX_LIGHTS];   // For directional lights
-uniform vec3 lightColors[MAX_LIGHTS];
+// Light data, shared by every shader. The block must be declared at full size so its layout
+// matches the other shaders; the jello only ever looked at the first few lights.
+const int MAX_LIGHTS = 10;
+const int NUM_JELLO_LIGHTS = 4;
+layout(std140) uniform Lights {
+    int lightTypes[MAX_LIGHTS];         // 0 for point, 1 for directional
+    vec3 lightPositions[MAX_LIGHTS];    // For point lights
+    vec3 lightDirections[MAX_LIGHTS];   // For directional lights
+    vec3 lightColors[MAX_LIGHTS];
+};
 
-uniform bool useLighting;     // Whether to calculate lighting using lighting equation
+// Variant defines (see ShaderVariants.h):
+//   USE_LIGHTING  Add the specular highlight from the scene lights
 
 void main()
 {
 //    vertex = vec3(v*m*vec4(position, 1.0).x, v*m*vec4(position, 1.0).y, v*m*vec4(position, 1.0).z);
 //    vertex = vec3(0.0, 0.0, 0.0);
     vertex = ((v*m)*(vec4(position, 1.0))).xyz;
-    eyeNormal = normalize(mat3(transpose(inverse(v*m))) * normal);
+    eyeNormal = normalize(mat3(normalMatrix) * normal);
 //    eyeNormal = normalize(transpose(inverse(v*m)) * vec4(normal, 0.0));
 //    eyeNormal = normal;
 //      eyeNormal = vec3(0.0, 0.0, 0.0);
@@ -38,25 +52,25 @@ void main()
 
     // Compute SpecularIntensity for use in our jello shader
     vec4 position_cameraSpace = v * m * vec4(position, 1.0);
-    vec4 normal_cameraSpace = vec4(normalize(mat3(transpose(inverse(v * m))) * normal), 0);
-
-    if (useLighting) {
-        for (int i = 0; i < MAX_LIGHTS; i++) {
-            vec4 vertexToLight = vec4(0);
-            // Point Light
-            if (lightTypes[i] == 0) {
-                vertexToLight = normalize(v * vec4(lightPositions[i], 1) - position_cameraSpace);
-            } else if (lightTypes[i] == 1) {
-                // Dir Light
-                vertexToLight = normalize(v * vec4(-lightDirections[i], 0));
-            }
-
-            // Add specular component
-            vec4 lightReflection = normalize(-reflect(vertexToLight, normal_cameraSpace));
-            vec4 eyeDirection = normalize(vec4(0,0,0,1) - position_cameraSpace);
-            SpecularIntensity = pow(max(0.0, dot(eyeDirection, lightReflection)), shininess);
+    vec4 normal_cameraSpace = vec4(eyeNormal, 0);
+
+#ifdef USE_LIGHTING
+    for (int i = 0; i < NUM_JELLO_LIGHTS; i++) {
+        vec4 vertexToLight = vec4(0);
+        // Point Light
+        if (lightTypes[i] == 0) {
+            vertexToLight = normalize(v * vec4(lightPositions[i], 1) - position_cameraSpace);
+        } else if (lightTypes[i] == 1) {
+            // Dir Light
+            vertexToLight = normalize(v * vec4(-lightDirections[i], 0));
         }
-    } else {
-        SpecularIntensity = 0;
+
+        // Add specular component
+        vec4 lightReflection = normalize(-reflect(vertexToLight, normal_cameraSpace));
+        vec4 eyeDirection = normalize(vec4(0,0,0,1) - position_cameraSpace);
+        SpecularIntensity = pow(max(0.0, dot(eyeDirection, lightReflection)), shininess);
     }
+#else
+    SpecularIntensity = 0;
+#endif
 }
@@ -3,10 +3,18 @@
 layout(location = 0) in vec3 in_position;
 layout(location = 5) in vec2 in_texCoord;
 
-// Transformation matrices
-uniform mat4 p;
-uniform mat4 v;
-uniform mat4 m;
+// View and projection, shared by every shader for the whole frame (see UniformBlockBindings.h)
+layout(std140) uniform Camera {
+    mat4 p;
+    mat4 v;
+    mat4 vInverse;      // inverse(v)
+};
+
+// Model transform of the object being drawn, rewritten between draws
+layout(std140) uniform Object {
+    mat4 m;
+    mat4 normalMatrix;  // transpose(inverse(v * m)); use mat3(normalMatrix)
+};
 
 out vec2 texCoord;
 
@@ -1,9 +1,15 @@
 #include "Bbox.h"
 #include "gl/shaders/ShaderAttribLocations.h"
 
-Bbox::Bbox():
-    Shape(0)
-{}
+Bbox::Bbox(GeometryCache &cache):
+    Shape(0),
+    m_cache(cache),
+    m_bboxHandle(GeometryCache::INVALID_HANDLE),
+    m_planeHandle(GeometryCache::INVALID_HANDLE),
+    m_floorHandle(GeometryCache::INVALID_HANDLE)
+{
+    generateVertexData();
+}
 
 Bbox::~Bbox(){}
 
@@ -16,39 +22,26 @@ void Bbox::setParam1(int inp) {
 void Bbox::setParam2(int inp) {
 }
 
-void Bbox::generateVertexData(){
-}
-
 void Bbox::setGravity(float scale, glm::vec3 new_direction) {
 }
 
-void Bbox::drawFloor() {
+void Bbox::generateVertexData(){
     std::vector<GLfloat> floorData = {
         -2.f, -2.f, -2.f,
         -2.f, -2.f, 2.f,
         2.f, -2.f, -2.f,
         2.f, -2.f, 2.f
     };
-    drawTriangleStrips(floorData);
-    glCullFace(GL_FRONT);
-    drawTriangleStrips(floorData);
-    glCullFace(GL_BACK);
-}
+    m_floorHandle = m_cache.upload("bbox/floor", floorData, VBO::GEOMETRY_LAYOUT::LAYOUT_TRIANGLE_STRIP);
 
-void Bbox::drawPlane() {
     std::vector<GLfloat> planeData = {
         -2.f, 2.f, -2.f, // b
         -2.f, -2.f, 2.f, // c
         2.f, -2.f, -2.f // a
 //        2.f, -2.f, 2.f
     };
-    drawTriangleStrips(planeData);
-    glCullFace(GL_FRONT);
-    drawTriangleStrips(planeData);
-    glCullFace(GL_BACK);
-}
+    m_planeHandle = m_cache.upload("bbox/plane", planeData, VBO::GEOMETRY_LAYOUT::LAYOUT_TRIANGLE_STRIP);
 
-void Bbox::drawBbox() {
     std::vector<GLfloat> lineData = {
         2.f, 2.f, 2.f, 2.f, 2.f, -2.f,
         2.f, 2.f, -2.f, -2.f, 2.f, -2.f,
@@ -98,5 +91,17 @@ void Bbox::drawBbox() {
         -1.f, -2.f, -2.f, -1.f, -2.f, 2.f,
         0.f, -2.f, -2.f, 0.f, -2.f, 2.f,
         1.f, -2.f, -2.f, 1.f, -2.f, 2.f};
-    drawLines(lineData);
+    m_bboxHandle = m_cache.upload("bbox/lines", lineData, VBO::GEOMETRY_LAYOUT::LAYOUT_LINES);
+}
+
+void Bbox::drawFloor() {
+    m_cache.drawDoubleSided(m_floorHandle);
+}
+
+void Bbox::drawPlane() {
+    m_cache.drawDoubleSided(m_planeHandle);
+}
+
+void Bbox::drawBbox() {
+    m_cache.draw(m_bboxHandle);
 }
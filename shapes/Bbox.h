@@ -2,11 +2,13 @@
 #define BBOX_H
 
 #include "Shape.h"
+#include "gl/util/GeometryCache.h"
 
 class Bbox : public Shape
 {
 public:
-    Bbox();
+    // The box, plane and floor are uploaded into the cache once, here, and drawn by handle.
+    Bbox(CS123::GL::GeometryCache &cache);
     ~Bbox();
     void drawBbox();
     void drawPlane();
@@ -19,6 +21,11 @@ public:
 
 private:
     virtual void generateVertexData() override;
+
+    CS123::GL::GeometryCache &m_cache;
+    CS123::GL::GeometryCache::Handle m_bboxHandle;
+    CS123::GL::GeometryCache::Handle m_planeHandle;
+    CS123::GL::GeometryCache::Handle m_floorHandle;
 };
 
 
@@ -0,0 +1,127 @@
+#include "Checkpoint.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include "MappedFile.h"
+
+namespace {
+
+const uint32_t CHECKPOINT_MAGIC = 0x504B434A; // "JCKP"
+const uint32_t CHECKPOINT_VERSION = 1;
+const uint64_t ARRAY_ALIGNMENT = 64;
+
+static_assert(sizeof(Checkpoint::Header) == 128, "the checkpoint header layout is part of the file format");
+static_assert(sizeof(glm::vec3) == 3 * sizeof(float), "points are stored as tightly packed float triples");
+
+uint64_t alignUp(uint64_t offset) {
+    return (offset + ARRAY_ALIGNMENT - 1) / ARRAY_ALIGNMENT * ARRAY_ALIGNMENT;
+}
+
+}
+
+bool Checkpoint::save(const std::string &path, const SimulationState &state) {
+    uint64_t arrayBytes = state.count * sizeof(glm::vec3);
+
+    Header header;
+    std::memset(&header, 0, sizeof(header));
+    header.magic = CHECKPOINT_MAGIC;
+    header.version = CHECKPOINT_VERSION;
+    header.headerSize = sizeof(Header);
+    header.shapeType = state.shapeType;
+    header.param1 = state.param1;
+    header.count = static_cast<uint32_t>(state.count);
+    header.kElastic = state.kElastic;
+    header.dElastic = state.dElastic;
+    header.kCollision = state.kCollision;
+    header.dCollision = state.dCollision;
+    header.mass = state.mass;
+    header.dt = state.dt;
+    header.gravity[0] = state.gravity.x;
+    header.gravity[1] = state.gravity.y;
+    header.gravity[2] = state.gravity.z;
+    header.latticeOrder = static_cast<uint32_t>(state.latticeOrder);
+    header.pointsOffset = alignUp(sizeof(Header));
+    header.velocityOffset = alignUp(header.pointsOffset + arrayBytes);
+
+    std::string tmpPath = path + ".tmp";
+    {
+        std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+        const char zeros[ARRAY_ALIGNMENT] = {};
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(zeros, header.pointsOffset - sizeof(header));
+        out.write(reinterpret_cast<const char*>(state.points), arrayBytes);
+        out.write(zeros, header.velocityOffset - header.pointsOffset - arrayBytes);
+        out.write(reinterpret_cast<const char*>(state.velocity), arrayBytes);
+        if (!out) {
+            std::cerr << "Could not write checkpoint: " << tmpPath << std::endl;
+            out.close();
+            std::remove(tmpPath.c_str());
+            return false;
+        }
+    }
+    // rename replaces an existing checkpoint atomically, so a crash leaves the old one or the new.
+    if (std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+        std::cerr << "Could not write checkpoint: " << path << std::endl;
+        std::remove(tmpPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+Checkpoint::Checkpoint(const std::string &path) :
+    m_file(std::make_unique<MappedFile>(path)),
+    m_state(),
+    m_valid(false)
+{
+    if (!m_file->isValid() || m_file->size() < sizeof(Header)) {
+        std::cerr << "Not a checkpoint: " << path << std::endl;
+        return;
+    }
+
+    Header header;
+    std::memcpy(&header, m_file->data(), sizeof(header));
+    if (header.magic != CHECKPOINT_MAGIC || header.headerSize != sizeof(Header)) {
+        std::cerr << "Not a checkpoint: " << path << std::endl;
+        return;
+    }
+    if (header.version != CHECKPOINT_VERSION) {
+        std::cerr << "Checkpoint " << path << " is version " << header.version << "; this build reads version "
+                  << CHECKPOINT_VERSION << std::endl;
+        return;
+    }
+
+    uint64_t dim = header.param1 + 1;
+    uint64_t arrayBytes = static_cast<uint64_t>(header.count) * sizeof(glm::vec3);
+    if (header.param1 < 1 || header.count != dim * dim * dim || header.latticeOrder > 1 ||
+            header.pointsOffset % ARRAY_ALIGNMENT != 0 || header.velocityOffset % ARRAY_ALIGNMENT != 0 ||
+            header.pointsOffset + arrayBytes > m_file->size() || header.velocityOffset + arrayBytes > m_file->size()) {
+        std::cerr << "Checkpoint " << path << " is truncated or corrupt" << std::endl;
+        return;
+    }
+
+    m_state.shapeType = header.shapeType;
+    m_state.param1 = header.param1;
+    m_state.kElastic = header.kElastic;
+    m_state.dElastic = header.dElastic;
+    m_state.kCollision = header.kCollision;
+    m_state.dCollision = header.dCollision;
+    m_state.mass = header.mass;
+    m_state.dt = header.dt;
+    m_state.gravity = glm::vec3(header.gravity[0], header.gravity[1], header.gravity[2]);
+    m_state.points = reinterpret_cast<const glm::vec3*>(m_file->data() + header.pointsOffset);
+    m_state.velocity = reinterpret_cast<const glm::vec3*>(m_file->data() + header.velocityOffset);
+    m_state.count = header.count;
+    m_state.latticeOrder = static_cast<int>(header.latticeOrder);
+    m_valid = true;
+}
+
+Checkpoint::~Checkpoint()
+{
+}
+
+bool Checkpoint::isValid() const {
+    return m_valid;
+}
@@ -0,0 +1,82 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include <glm/glm.hpp>
+
+class MappedFile;
+
+// Everything needed to carry on a simulation from where it was. The arrays are borrowed: from
+// the shape when saving, or from the mapped file when loading.
+struct SimulationState {
+    int shapeType;        // ShapeType
+    int param1;
+    float kElastic;
+    float dElastic;
+    float kCollision;
+    float dCollision;
+    float mass;
+    float dt;
+    glm::vec3 gravity;
+    const glm::vec3 *points;
+    const glm::vec3 *velocity;
+    size_t count;         // (param1 + 1)^3
+    int latticeOrder;     // LatticeLayout::Order of points and velocity
+};
+
+/**
+ * @class Checkpoint
+ *
+ * A saved simulation state. The file is a fixed 128-byte header followed by the positions and the
+ * velocities as raw, 64-byte aligned float triples in the machine's byte order, so loading one is
+ * just mapping the file and pointing into it; nothing is parsed or converted.
+ */
+class Checkpoint {
+public:
+    struct Header {
+        uint32_t magic;          // "JCKP"
+        uint32_t version;
+        uint32_t headerSize;     // sizeof(Header), checked so a layout change can't be misread
+        int32_t shapeType;
+        int32_t param1;
+        uint32_t count;
+        float kElastic;
+        float dElastic;
+        float kCollision;
+        float dCollision;
+        float mass;
+        float dt;
+        float gravity[3];
+        uint32_t latticeOrder;   // LatticeLayout::Order; 0 (row-major) in files from before it was stored
+        uint64_t pointsOffset;   // from the start of the file
+        uint64_t velocityOffset;
+        uint8_t padding[48];
+    };
+
+    // Writes to a temporary file and renames it over path, so a failed save never leaves a
+    // truncated checkpoint behind.
+    static bool save(const std::string &path, const SimulationState &state);
+
+    // Maps the file. isValid() is false (and the reason printed) if it isn't a checkpoint this
+    // version can read.
+    explicit Checkpoint(const std::string &path);
+    Checkpoint(const Checkpoint&) = delete;
+    Checkpoint& operator=(const Checkpoint&) = delete;
+    ~Checkpoint();
+
+    bool isValid() const;
+
+    // Points into the mapping, so it is only usable while this object lives.
+    const SimulationState &state() const { return m_state; }
+
+private:
+    std::unique_ptr<MappedFile> m_file;
+    SimulationState m_state;
+    bool m_valid;
+};
+
+#endif // CHECKPOINT_H
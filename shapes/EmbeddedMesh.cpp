@@ -0,0 +1,290 @@
+#include "EmbeddedMesh.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+namespace {
+
+// Vertices are deformed this many at a time, one per SIMD lane; the loops over a block's lanes
+// are written so that the compiler vectorizes them.
+const int LANES = 8;
+
+// Fewer vertices than this per thread aren't worth a thread.
+const size_t VERTICES_PER_THREAD = 16384;
+
+// The vertex index of an OBJ face corner ("v", "v/vt", "v//vn" or "v/vt/vn"), from 0; negative
+// indices count back from the last vertex read so far.
+bool parseCorner(const std::string &token, size_t vertexCount, GLuint &index) {
+    int value = std::atoi(token.c_str());
+    long resolved = value > 0 ? value - 1 : static_cast<long>(vertexCount) + value;
+    if (value == 0 || resolved < 0 || resolved >= static_cast<long>(vertexCount)) return false;
+    index = static_cast<GLuint>(resolved);
+    return true;
+}
+
+}
+
+const int MeshGeometry::MAX_DETAIL;
+const int EmbeddedMesh::FLOATS_PER_VERTEX;
+
+std::shared_ptr<const MeshGeometry> MeshGeometry::subdividedCube(int detail) {
+    detail = std::min(std::max(detail, 1), MAX_DETAIL);
+    auto mesh = std::make_shared<MeshGeometry>();
+
+    // Each face's corner, and the two edges along it with u x v pointing out of the cube.
+    const glm::vec3 X(1, 0, 0), Y(0, 1, 0), Z(0, 0, 1);
+    const struct { glm::vec3 origin, u, v; } faces[] = {
+        { glm::vec3( 0.5f, -0.5f, -0.5f), Y, Z }, { glm::vec3(-0.5f, -0.5f, -0.5f), Z, Y },
+        { glm::vec3(-0.5f,  0.5f, -0.5f), Z, X }, { glm::vec3(-0.5f, -0.5f, -0.5f), X, Z },
+        { glm::vec3(-0.5f, -0.5f,  0.5f), X, Y }, { glm::vec3(-0.5f, -0.5f, -0.5f), Y, X },
+    };
+
+    int side = detail + 1;
+    float step = 1.f / detail;
+    mesh->positions.reserve(6 * side * side);
+    mesh->indices.reserve(6 * detail * detail * 6);
+    for (const auto &face : faces) {
+        GLuint first = static_cast<GLuint>(mesh->positions.size());
+        for (int a = 0; a < side; a++) {
+            for (int b = 0; b < side; b++) {
+                mesh->positions.push_back(face.origin + (a * step) * face.u + (b * step) * face.v);
+            }
+        }
+        for (int a = 0; a < detail; a++) {
+            for (int b = 0; b < detail; b++) {
+                GLuint corner = first + a * side + b;
+                GLuint quad[] = { corner, corner + side, corner + side + 1, corner + 1 };
+                mesh->indices.insert(mesh->indices.end(), { quad[0], quad[1], quad[2], quad[0], quad[2], quad[3] });
+            }
+        }
+    }
+    return mesh;
+}
+
+std::shared_ptr<const MeshGeometry> MeshGeometry::loadOBJ(const std::string &path) {
+    std::ifstream in(path);
+    if (!in) {
+        std::cerr << "Could not open render mesh: " << path << std::endl;
+        return nullptr;
+    }
+
+    auto mesh = std::make_shared<MeshGeometry>();
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(in, line)) {
+        lineNumber++;
+        std::istringstream words(line);
+        std::string type;
+        words >> type;
+        if (type == "v") {
+            glm::vec3 position;
+            words >> position.x >> position.y >> position.z;
+            mesh->positions.push_back(position);
+        } else if (type == "f") {
+            std::vector<GLuint> polygon;
+            for (std::string token; words >> token;) {
+                GLuint index;
+                if (!parseCorner(token, mesh->positions.size(), index)) {
+                    std::cerr << "Bad face in render mesh " << path << " at line " << lineNumber << std::endl;
+                    return nullptr;
+                }
+                polygon.push_back(index);
+            }
+            for (size_t i = 2; i < polygon.size(); i++) {
+                mesh->indices.insert(mesh->indices.end(), { polygon[0], polygon[i - 1], polygon[i] });
+            }
+        }
+    }
+    if (mesh->indices.empty()) {
+        std::cerr << "Render mesh " << path << " has no faces" << std::endl;
+        return nullptr;
+    }
+
+    // Centre the mesh and scale its longest side to the cube's.
+    glm::vec3 low(INFINITY), high(-INFINITY);
+    for (const glm::vec3 &position : mesh->positions) {
+        low = glm::min(low, position);
+        high = glm::max(high, position);
+    }
+    glm::vec3 centre = 0.5f * (low + high);
+    float extent = std::max(high.x - low.x, std::max(high.y - low.y, high.z - low.z));
+    float scale = extent > 0 ? 1.f / extent : 1.f;
+    for (glm::vec3 &position : mesh->positions) {
+        position = (position - centre) * scale;
+    }
+    return mesh;
+}
+
+EmbeddedMesh::EmbeddedMesh(std::shared_ptr<const MeshGeometry> geometry, const LatticeLayout &lattice) :
+    m_geometry(std::move(geometry)),
+    m_count(m_geometry->positions.size()),
+    m_piece(m_count),
+    m_points(nullptr),
+    m_pass(Pass::Deform),
+    m_generation(0),
+    m_pending(0),
+    m_stopping(false)
+{
+    // Padded to whole blocks of lanes; the padding reads point 0 with no weight.
+    size_t stride = (m_count + LANES - 1) / LANES * LANES;
+    m_corners.assign(CORNERS * stride, 0);
+    m_weights.assign(CORNERS * stride, 0.f);
+    m_positions.resize(stride);
+    m_vertexData.resize(m_count * FLOATS_PER_VERTEX);
+
+    // At rest, lattice point (i, j, k) is at (-0.5 + j, 0.5 - i, 0.5 - k) / param1 (see
+    // JelloCube::generateVertexData), so a vertex's cell and weights follow from its position.
+    int cells = lattice.dim() - 1;
+    for (size_t v = 0; v < m_count; v++) {
+        const glm::vec3 &rest = m_geometry->positions[v];
+        float coordinate[3] = { (0.5f - rest.y) * cells, (rest.x + 0.5f) * cells, (0.5f - rest.z) * cells };
+        int cell[3];
+        float t[3];
+        for (int axis = 0; axis < 3; axis++) {
+            cell[axis] = std::min(std::max(static_cast<int>(std::floor(coordinate[axis])), 0), cells - 1);
+            t[axis] = std::min(std::max(coordinate[axis] - cell[axis], 0.f), 1.f);
+        }
+        for (int c = 0; c < CORNERS; c++) {
+            int di = c & 1, dj = (c >> 1) & 1, dk = (c >> 2) & 1;
+            m_corners[c * stride + v] = lattice.index(cell[0] + di, cell[1] + dj, cell[2] + dk);
+            m_weights[c * stride + v] = (di ? t[0] : 1.f - t[0]) * (dj ? t[1] : 1.f - t[1]) *
+                                        (dk ? t[2] : 1.f - t[2]);
+        }
+    }
+
+    const std::vector<GLuint> &indices = m_geometry->indices;
+    m_firstTriangle.assign(m_count + 1, 0);
+    for (GLuint index : indices) {
+        m_firstTriangle[index + 1]++;
+    }
+    for (size_t v = 0; v < m_count; v++) {
+        m_firstTriangle[v + 1] += m_firstTriangle[v];
+    }
+    m_triangles.resize(indices.size());
+    std::vector<int> filled(m_firstTriangle.begin(), m_firstTriangle.end() - 1);
+    for (size_t i = 0; i < indices.size(); i++) {
+        m_triangles[filled[indices[i]]++] = static_cast<int>(i / 3);
+    }
+
+    // Lane-aligned pieces, so no two threads write the same block of positions.
+    size_t threads = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()),
+                                      std::max<size_t>(1, m_count / VERTICES_PER_THREAD));
+    if (threads > 1) {
+        m_piece = (m_count + threads - 1) / threads;
+        m_piece = (m_piece + LANES - 1) / LANES * LANES;
+        for (size_t begin = m_piece; begin < m_count; begin += m_piece) {
+            m_workers.emplace_back(&EmbeddedMesh::work, this, begin, std::min(begin + m_piece, m_count));
+        }
+    }
+}
+
+EmbeddedMesh::~EmbeddedMesh() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_start.notify_all();
+    for (std::thread &worker : m_workers) {
+        worker.join();
+    }
+}
+
+void EmbeddedMesh::deform(const glm::vec3 *points) {
+    // The normals read neighbouring pieces' positions, so every piece is deformed first.
+    m_points = points;
+    dispatch(Pass::Deform);
+    dispatch(Pass::Normals);
+    m_points = nullptr;
+}
+
+void EmbeddedMesh::dispatch(Pass pass) {
+    if (!m_workers.empty()) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pass = pass;
+        m_generation++;
+        m_pending = m_workers.size();
+    }
+    m_start.notify_all();
+    runPass(pass, 0, std::min(m_piece, m_count));
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this] { return m_pending == 0; });
+}
+
+void EmbeddedMesh::runPass(Pass pass, size_t begin, size_t end) {
+    if (pass == Pass::Deform) {
+        deformVertices(m_points, begin, end);
+    } else {
+        computeNormals(begin, end);
+    }
+}
+
+void EmbeddedMesh::work(size_t begin, size_t end) {
+    uint64_t done = 0;
+    while (true) {
+        Pass pass;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_start.wait(lock, [&] { return m_stopping || m_generation != done; });
+            if (m_stopping) return;
+            done = m_generation;
+            pass = m_pass;
+        }
+        runPass(pass, begin, end);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (--m_pending == 0) m_done.notify_one();
+    }
+}
+
+void EmbeddedMesh::deformVertices(const glm::vec3 *points, size_t begin, size_t end) {
+    size_t stride = m_positions.size();
+    const int *corners = m_corners.data();
+    const float *weights = m_weights.data();
+    for (size_t block = begin; block < end; block += LANES) {
+        float x[LANES] = {}, y[LANES] = {}, z[LANES] = {};
+        for (int c = 0; c < CORNERS; c++) {
+            const int *corner = corners + c * stride + block;
+            const float *weight = weights + c * stride + block;
+            for (int lane = 0; lane < LANES; lane++) {
+                const glm::vec3 &point = points[corner[lane]];
+                x[lane] += weight[lane] * point.x;
+                y[lane] += weight[lane] * point.y;
+                z[lane] += weight[lane] * point.z;
+            }
+        }
+        for (int lane = 0; lane < LANES; lane++) {
+            m_positions[block + lane] = glm::vec3(x[lane], y[lane], z[lane]);
+        }
+    }
+}
+
+void EmbeddedMesh::computeNormals(size_t begin, size_t end) {
+    const GLuint *indices = m_geometry->indices.data();
+    end = std::min(end, m_count);
+    for (size_t v = begin; v < end; v++) {
+        // Area-weighted: the cross product's length is twice the triangle's area.
+        glm::vec3 normal(0.f);
+        for (int t = m_firstTriangle[v]; t < m_firstTriangle[v + 1]; t++) {
+            const GLuint *triangle = indices + 3 * m_triangles[t];
+            const glm::vec3 &a = m_positions[triangle[0]];
+            normal += glm::cross(m_positions[triangle[1]] - a, m_positions[triangle[2]] - a);
+        }
+        float length = glm::length(normal);
+        if (length > 0) normal /= length;
+
+        GLfloat *vertex = &m_vertexData[v * FLOATS_PER_VERTEX];
+        const glm::vec3 &position = m_positions[v];
+        vertex[0] = position.x;
+        vertex[1] = position.y;
+        vertex[2] = position.z;
+        vertex[3] = normal.x;
+        vertex[4] = normal.y;
+        vertex[5] = normal.z;
+    }
+}
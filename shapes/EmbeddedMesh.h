@@ -0,0 +1,105 @@
+#ifndef EMBEDDEDMESH_H
+#define EMBEDDEDMESH_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include "GL/glew.h"
+
+#include "LatticeLayout.h"
+
+/** An indexed triangle mesh at rest, inside the cube from (-0.5, -0.5, -0.5) to (0.5, 0.5, 0.5). */
+struct MeshGeometry {
+    std::vector<glm::vec3> positions;
+    std::vector<GLuint> indices; // three per triangle, counter-clockwise seen from outside
+
+    // Each face of the cube as its own detail x detail grid of quads, so the edges stay sharp like
+    // the lattice surface's. Detail is capped at MAX_DETAIL (about three million triangles).
+    static const int MAX_DETAIL = 512;
+    static std::shared_ptr<const MeshGeometry> subdividedCube(int detail);
+
+    // Vertices and faces of a Wavefront OBJ, with polygons split into fans and the whole mesh
+    // scaled to fit the cube. Null (after printing why) if the file can't be read or has no faces.
+    static std::shared_ptr<const MeshGeometry> loadOBJ(const std::string &path);
+};
+
+/**
+ * @class EmbeddedMesh
+ *
+ * Free-form deformation of a render mesh by a simulated lattice: each vertex is tied to the lattice
+ * cell it sits in at rest, with trilinear weights for the cell's eight corners, so deforming it
+ * is just a weighted sum of eight lattice points. That lets a coarse lattice drive a mesh of any
+ * resolution, at a cost linear in the mesh's size.
+ *
+ * Large meshes are split into one contiguous piece per worker. The workers are started with the
+ * mesh and wait between deforms, so deform() itself neither starts threads nor allocates.
+ */
+class EmbeddedMesh {
+public:
+    static const int FLOATS_PER_VERTEX = 6; // position, normal
+
+    // Embeds geometry in the rest pose of a lattice laid out as given (as the cubes build it).
+    EmbeddedMesh(std::shared_ptr<const MeshGeometry> geometry, const LatticeLayout &lattice);
+    EmbeddedMesh(const EmbeddedMesh&) = delete;
+    EmbeddedMesh& operator=(const EmbeddedMesh&) = delete;
+    ~EmbeddedMesh();
+
+    // Moves every vertex along with the lattice points (stored as the lattice was laid out) and
+    // recomputes the normals.
+    void deform(const glm::vec3 *points);
+
+    const std::shared_ptr<const MeshGeometry> &geometry() const { return m_geometry; }
+
+    // Interleaved positions and normals from the last deform().
+    const std::vector<GLfloat> &vertexData() const { return m_vertexData; }
+
+private:
+    static const int CORNERS = 8;
+
+    enum class Pass { Deform, Normals };
+
+    // Runs pass over every piece, the first on the calling thread, and waits for all of them.
+    void dispatch(Pass pass);
+    void runPass(Pass pass, size_t begin, size_t end);
+    void work(size_t begin, size_t end);
+
+    void deformVertices(const glm::vec3 *points, size_t begin, size_t end);
+    void computeNormals(size_t begin, size_t end);
+
+    std::shared_ptr<const MeshGeometry> m_geometry;
+    size_t m_count; // vertices
+
+    // Corner c of vertex v is at [c * m_count + v], so each corner's loop over the vertices reads
+    // contiguous memory.
+    std::vector<int> m_corners;
+    std::vector<float> m_weights;
+
+    // The triangles around each vertex: m_triangles[m_firstTriangle[v]] up to
+    // m_triangles[m_firstTriangle[v + 1]]. Summing them per vertex lets the normals be computed in
+    // parallel without threads writing to the same vertex.
+    std::vector<int> m_firstTriangle;
+    std::vector<int> m_triangles;
+
+    std::vector<glm::vec3> m_positions;
+    std::vector<GLfloat> m_vertexData;
+
+    // Worker w runs the pieces from w * m_piece; the calling thread runs the first.
+    size_t m_piece;
+    const glm::vec3 *m_points; // of the deform in progress
+    std::mutex m_mutex;
+    std::condition_variable m_start;
+    std::condition_variable m_done;
+    Pass m_pass;
+    uint64_t m_generation; // bumped for every pass handed to the workers
+    size_t m_pending;      // workers still running the current pass
+    bool m_stopping;
+    std::vector<std::thread> m_workers;
+};
+
+#endif // EMBEDDEDMESH_H
@@ -0,0 +1,104 @@
+#include "EnergyMonitor.h"
+
+#include <cmath>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+
+namespace {
+
+struct State {
+    std::mutex mutex;
+    std::deque<EnergyMonitor::Sample> history;
+    uint64_t step = 0;
+    double startEnergy = 0;
+    bool rebaseline = false;
+    bool blownUp = false;
+    EnergyMonitor::Sample blowUp;
+    std::unique_ptr<std::ofstream> csv;
+};
+
+State &state() {
+    static State s_state;
+    return s_state;
+}
+
+bool isFinite(const JelloUtil::Diagnostics &diagnostics) {
+    return std::isfinite(diagnostics.total()) && std::isfinite(diagnostics.momentum.x) &&
+           std::isfinite(diagnostics.momentum.y) && std::isfinite(diagnostics.momentum.z);
+}
+
+}
+
+void EnergyMonitor::record(const JelloUtil::Diagnostics &diagnostics, double scale) {
+    State &s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+
+    Sample sample = { s.step++, diagnostics };
+    if (sample.step == 0 || s.rebaseline) s.startEnergy = diagnostics.total();
+    s.rebaseline = false;
+
+    s.history.push_back(sample);
+    if (s.history.size() > HISTORY) s.history.pop_front();
+
+    if (s.csv) {
+        *s.csv << sample.step << "," << diagnostics.kinetic << "," << diagnostics.spring << ","
+               << diagnostics.gravity << "," << diagnostics.collision << "," << diagnostics.total() << ","
+               << diagnostics.momentum.x << "," << diagnostics.momentum.y << "," << diagnostics.momentum.z << "\n";
+    }
+
+    if (!s.blownUp && (!isFinite(diagnostics) || diagnostics.total() > s.startEnergy + scale)) {
+        s.blownUp = true;
+        s.blowUp = sample;
+        std::cerr << "Simulation is blowing up at step " << sample.step << ": total energy "
+                  << diagnostics.total() << " (started at " << s.startEnergy << ", kinetic "
+                  << diagnostics.kinetic << ", spring " << diagnostics.spring << ")" << std::endl;
+    }
+}
+
+void EnergyMonitor::reset() {
+    State &s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    s.history.clear();
+    s.step = 0;
+    s.startEnergy = 0;
+    s.rebaseline = false;
+    s.blownUp = false;
+}
+
+void EnergyMonitor::rebaseline() {
+    State &s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    s.rebaseline = true;
+}
+
+std::vector<EnergyMonitor::Sample> EnergyMonitor::history() {
+    State &s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    return std::vector<Sample>(s.history.begin(), s.history.end());
+}
+
+bool EnergyMonitor::blownUp(Sample *at) {
+    State &s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    if (s.blownUp && at) *at = s.blowUp;
+    return s.blownUp;
+}
+
+bool EnergyMonitor::setCSV(const std::string &path) {
+    State &s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    s.csv.reset();
+    if (path.empty()) return true;
+
+    s.csv = std::make_unique<std::ofstream>(path);
+    if (!*s.csv) {
+        std::cerr << "Could not write energy log: " << path << std::endl;
+        s.csv.reset();
+        return false;
+    }
+    *s.csv << "step,kinetic,spring,gravity,collision,total,momentum_x,momentum_y,momentum_z\n";
+    return true;
+}
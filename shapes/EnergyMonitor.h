@@ -0,0 +1,51 @@
+#ifndef ENERGYMONITOR_H
+#define ENERGYMONITOR_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "JelloUtil.h"
+
+/**
+ * @class EnergyMonitor
+ *
+ * Keeps the recent energy and momentum of the simulated cube, one sample per step, and watches it
+ * for a blow-up. The lattice is damped, so its total energy should only ever go down; when it
+ * instead climbs more than one energy scale above where it started, the integrator has gone
+ * unstable, and that is reported long before the positions turn into NaN.
+ */
+class EnergyMonitor {
+public:
+    struct Sample {
+        uint64_t step;
+        JelloUtil::Diagnostics diagnostics;
+    };
+
+    // Samples kept for history(); about 20 seconds at the display rate.
+    static const size_t HISTORY = 1024;
+
+    // Called by the simulation once per step, with the state at the start of that step. scale is
+    // the amount of energy the cube can plausibly exchange (see JelloUtil::energyScale).
+    static void record(const JelloUtil::Diagnostics &diagnostics, double scale);
+
+    // Forgets the history and the starting energy, e.g. when the cube is rebuilt.
+    static void reset();
+
+    // Takes the next sample as the new starting energy, keeping the history. Changing gravity's
+    // direction or strength moves every point's potential energy, so the old start no longer
+    // compares.
+    static void rebaseline();
+
+    // The latest samples, oldest first.
+    static std::vector<Sample> history();
+
+    // True once a blow-up has been detected since the last reset(); at is set to the first bad
+    // sample.
+    static bool blownUp(Sample *at = nullptr);
+
+    // Also appends every sample to this CSV file, for headless runs. An empty path stops it.
+    static bool setCSV(const std::string &path);
+};
+
+#endif // ENERGYMONITOR_H
@@ -1,6 +1,10 @@
 #include "JelloCube.h"
 #include "JelloUtil.h"
 #include "Settings.h"
+#include "Checkpoint.h"
+#include "EnergyMonitor.h"
+#include "Profiler.h"
+#include "gl/shaders/ShaderAttribLocations.h"
 #include <iostream>
 
 JelloCube::JelloCube():
@@ -11,7 +15,8 @@ JelloCube::JelloCube():
     m_dCollision(0.25),
     m_mass(0.001953),
     m_dt(0.001),
-    m_gravity(glm::vec3(0.f, -1.f, 0.f))
+    m_gravity(glm::vec3(0.f, -1.f, 0.f)),
+    m_smoothing(0)
 {
     generateVertexData();
 }
@@ -24,7 +29,8 @@ JelloCube::JelloCube(int param1, float kElastic, float dElastic, float kCollisio
     m_dCollision(dCollision),
     m_mass(mass),
     m_dt(0.001),
-    m_gravity(glm::vec3(0.f, -gravity, 0.f))
+    m_gravity(glm::vec3(0.f, -gravity, 0.f)),
+    m_smoothing(0)
 {
     generateVertexData();
 }
@@ -55,8 +61,8 @@ float JelloCube::getdElastic() {
     return m_dElastic;
 }
 
-void JelloCube::setdElastic(float dCollision) {
-    m_dCollision = dCollision;
+void JelloCube::setdElastic(float dElastic) {
+    m_dElastic = dElastic;
 }
 
 float JelloCube::getkCollision() {
@@ -88,20 +94,108 @@ float JelloCube::getGravity() {
 }
 
 void JelloCube::setGravity(float scale, glm::vec3 new_direction) {
-    if (settings.fallCameraY) {
-        m_gravity = scale * new_direction;
-    } else {
-        m_gravity = scale * glm::vec3(0, -1, 0);
+    glm::vec3 gravity = scale * (settings.fallCameraY ? new_direction : glm::vec3(0, -1, 0));
+    if (gravity != m_gravity) {
+        m_gravity = gravity;
+        EnergyMonitor::rebaseline();
+    }
+}
+
+bool JelloCube::setMaterial(float kElastic, float dElastic, float kCollision, float dCollision, float mass) {
+    if (kElastic == m_kElastic && dElastic == m_dElastic && kCollision == m_kCollision &&
+            dCollision == m_dCollision && mass == m_mass) {
+        return true;
+    }
+    setkElastic(kElastic);
+    setdElastic(dElastic);
+    setkCollision(kCollision);
+    setdCollision(dCollision);
+    setMass(mass);
+    // The same lattice holds a different energy under the new constants.
+    EnergyMonitor::reset();
+    return true;
+}
+
+bool JelloCube::getState(SimulationState &state) {
+    state.param1 = m_param1;
+    state.kElastic = m_kElastic;
+    state.dElastic = m_dElastic;
+    state.kCollision = m_kCollision;
+    state.dCollision = m_dCollision;
+    state.mass = m_mass;
+    state.dt = m_dt;
+    state.gravity = m_gravity;
+    state.points = m_points.data();
+    state.velocity = m_velocity.data();
+    state.count = m_points.size();
+    state.latticeOrder = m_lattice.order();
+    return true;
+}
+
+bool JelloCube::setState(const SimulationState &state) {
+    if (state.param1 != m_param1 || state.count != m_points.size() || state.count != m_velocity.size()) {
+        return false;
+    }
+    m_kElastic = state.kElastic;
+    m_dElastic = state.dElastic;
+    m_kCollision = state.kCollision;
+    m_dCollision = state.dCollision;
+    m_mass = state.mass;
+    m_dt = state.dt;
+    m_gravity = state.gravity;
+    LatticeLayout::Order order = static_cast<LatticeLayout::Order>(state.latticeOrder);
+    m_lattice.reorder(state.velocity, LatticeLayout(m_lattice.dim(), order), m_velocity.data());
+    EnergyMonitor::reset();
+    return setPositions(state.points, state.count, order);
+}
+
+bool JelloCube::setPositions(const glm::vec3 *points, size_t count, LatticeLayout::Order order) {
+    if (count != m_points.size()) return false;
+    m_lattice.reorder(points, LatticeLayout(m_lattice.dim(), order), m_points.data());
+    updateSurface();
+    return true;
+}
+
+bool JelloCube::setSurfaceSmoothing(int levels) {
+    levels = std::min(std::max(levels, 0), static_cast<int>(SurfaceSubdivision::MAX_LEVELS));
+    if (levels == m_smoothing) return true;
+    m_smoothing = levels;
+    buildSurface();
+    updateSurface();
+    return true;
+}
+
+bool JelloCube::setRenderMesh(std::shared_ptr<const MeshGeometry> geometry) {
+    m_renderMesh.reset();
+    m_renderMeshVBO.reset();
+    m_renderMeshIBO.reset();
+    if (!geometry) {
+        updateSurface();
+        return true;
     }
+
+    m_renderMesh = std::make_unique<EmbeddedMesh>(geometry, m_lattice);
+    m_renderMesh->deform(m_points.data());
+    const std::vector<GLfloat> &data = m_renderMesh->vertexData();
+    std::vector<VBOAttribMarker> markers;
+    markers.push_back(VBOAttribMarker(ShaderAttrib::POSITION, 3, 0));
+    markers.push_back(VBOAttribMarker(ShaderAttrib::NORMAL, 3, 3*sizeof(float)));
+    m_renderMeshVBO = std::make_unique<VBO>(data.data(), data.size(), markers,
+                                            VBO::GEOMETRY_LAYOUT::LAYOUT_TRIANGLES,
+                                            VBO::BUFFER_USAGE::USAGE_DYNAMIC_DRAW);
+    m_renderMeshIBO = std::make_unique<IBO>(geometry->indices.data(), geometry->indices.size());
+    m_VAO = std::make_unique<VAO>(*m_renderMeshVBO, *m_renderMeshIBO);
+    m_vertexData.clear();
+    return true;
 }
 
 void JelloCube::generateVertexData(){
     int dim = m_param1 + 1;
     int num_control_points = pow(dim,3);
-    m_points.reserve(num_control_points);
-    m_velocity.reserve(num_control_points);
-    m_velocity.insert(m_velocity.begin(), num_control_points, glm::vec3(0.f, 0.f, 0.f));
-    m_normals.reserve(dim * dim * 6);
+    EnergyMonitor::reset();
+    m_lattice = LatticeLayout(dim);
+    m_points.assign(num_control_points, glm::vec3(0.f, 0.f, 0.f));
+    m_velocity.assign(num_control_points, glm::vec3(0.f, 0.f, 0.f));
 
     //Initialize points
     float incr = 1.f / m_param1;
@@ -116,17 +210,60 @@ void JelloCube::generateVertexData(){
         for (int i = 0; i < dim; i++) {
             //j is the column (x)
             for (int j = 0; j < dim; j++) {
-                m_points.push_back(start + glm::vec3(j * incr, i * -incr, k * -incr));
+                m_points[m_lattice.index(i, j, k)] = start + glm::vec3(j * incr, i * -incr, k * -incr);
             }
         }
     }
 
+    buildSurface();
+
+    // A render mesh has to be embedded in the new lattice.
+    if (m_renderMesh) {
+        setRenderMesh(m_renderMesh->geometry());
+        return;
+    }
+
     //Load VAO for each of the 6 faces with points and normals
-    calculateNormals();
-    loadVAO();
+    updateSurface();
+}
 
-    initializeOpenGLShapeProperties();
+//Sizes the face grids that are drawn: the lattice's own, or refined by m_subdivision
+void JelloCube::buildSurface() {
+    int dim = m_param1 + 1;
+    if (m_smoothing > 0) {
+        m_subdivision = std::make_unique<SurfaceSubdivision>(dim, m_smoothing);
+        m_faceColumns.resize(dim * dim);
+        m_surfaceDim = m_subdivision->refinedDim();
+    } else {
+        m_subdivision.reset();
+        m_surfaceDim = dim;
+    }
+    m_surface.resize(6 * m_surfaceDim * m_surfaceDim);
+    m_normals.resize(6 * m_surfaceDim * m_surfaceDim);
+}
+
+//Copies each face of the lattice into m_surface, smoothing it on the way if asked to
+void JelloCube::gatherSurface() {
+    PROFILE_SCOPE("gatherSurface");
+    int dim = m_param1 + 1;
+    for (int face = 0; face < 6; face++) {
+        FACE side = (FACE)face;
+        if (!m_subdivision) {
+            for (int i = 0; i < dim; i++) {
+                for (int j = 0; j < dim; j++) {
+                    m_surface[to1D(i, j, face, dim, dim)] = m_points[indexFromFace(i, j, m_lattice, side)];
+                }
+            }
+            continue;
+        }
 
+        for (int j = 0; j < dim; j++) {
+            for (int i = 0; i < dim; i++) {
+                m_faceColumns[j * dim + i] = m_points[indexFromFace(i, j, m_lattice, side)];
+            }
+        }
+        m_subdivision->refine(m_faceColumns.data(), &m_surface[to1D(0, 0, face, m_surfaceDim, m_surfaceDim)]);
+    }
 }
 
 // Convention for indexing into normals
@@ -135,7 +272,8 @@ void JelloCube::generateVertexData(){
 
 //Computes normals for points at arbitrary points
 void JelloCube::calculateNormals() {
-    int dim = m_param1 + 1;
+    PROFILE_SCOPE("calculateNormals");
+    int dim = m_surfaceDim;
     int total = 6 * dim * dim;
     for (int i = 0; i < total; i++) {
         m_normals[i] = glm::vec3(0.f);
@@ -144,11 +282,10 @@ void JelloCube::calculateNormals() {
     for (int face = 0; face < 6; face++) {
         for (int i = 0; i < dim - 1; i++) {
             for (int j = 0; j < dim - 1; j++) {
-                FACE side = (FACE)face;
-                glm::vec3 point1 = m_points[indexFromFace(i, j, dim, side)];
-                glm::vec3 point2 = m_points[indexFromFace(i, j + 1, dim, side)];
-                glm::vec3 point3 = m_points[indexFromFace(i + 1, j + 1, dim, side)];
-                glm::vec3 point4 = m_points[indexFromFace(i + 1, j, dim, side)];
+                glm::vec3 point1 = m_surface[to1D(i, j, face, dim, dim)];
+                glm::vec3 point2 = m_surface[to1D(i, j + 1, face, dim, dim)];
+                glm::vec3 point3 = m_surface[to1D(i + 1, j + 1, face, dim, dim)];
+                glm::vec3 point4 = m_surface[to1D(i + 1, j, face, dim, dim)];
 
                 //Top triangle
                 glm::vec3 v1 = point1 - point2;
@@ -176,19 +313,19 @@ void JelloCube::calculateNormals() {
 
 //Should load the VAO given arbitrary positions of each cube point
 void JelloCube::loadVAO() {
+    PROFILE_SCOPE("loadVAO");
     //Calculate for each face
-    int dim = m_param1 + 1;
+    int dim = m_surfaceDim;
     for (int face = 0; face < 6; face++) {
         for (int i = 0; i < dim - 1; i++) {
             for (int j = 0; j < dim - 1; j++) {
-                FACE side = (FACE)face;
-                glm::vec3 point1 = m_points[indexFromFace(i, j, dim, side)];
+                glm::vec3 point1 = m_surface[to1D(i, j, face, dim, dim)];
                 glm::vec3 normal1 = m_normals[to1D(i, j, face, dim, dim)];
-                glm::vec3 point2 = m_points[indexFromFace(i, j+1, dim, side)];
+                glm::vec3 point2 = m_surface[to1D(i, j+1, face, dim, dim)];
                 glm::vec3 normal2 = m_normals[to1D(i, j+1, face, dim, dim)];
-                glm::vec3 point3 = m_points[indexFromFace(i+1, j+1, dim, side)];
+                glm::vec3 point3 = m_surface[to1D(i+1, j+1, face, dim, dim)];
                 glm::vec3 normal3 = m_normals[to1D(i+1, j+1, face, dim, dim)];
-                glm::vec3 point4 = m_points[indexFromFace(i+1, j, dim, side)];
+                glm::vec3 point4 = m_surface[to1D(i+1, j, face, dim, dim)];
                 glm::vec3 normal4 = m_normals[to1D(i+1, j, face, dim, dim)];
                 pushRectangleAsFloats(
                             point1, normal1,
@@ -208,7 +345,7 @@ void JelloCube::euler() {
     acceleration.reserve(num_control_points);
 
     computeAcceleration(
-                m_param1, m_kElastic, m_dElastic,
+                m_lattice, m_kElastic, m_dElastic,
                 m_kCollision, m_dCollision, m_mass, m_gravity,
                 m_points, m_velocity, acceleration);
 
@@ -221,8 +358,24 @@ void JelloCube::euler() {
 
 //Should update positions and call on loadVAO and initializeOpenGLShapeProperties() to prep for drawing again
 void JelloCube::tick(float current) {
-    rk4(m_dt, m_param1, m_kElastic, m_dElastic, m_kCollision, m_dCollision,
-        m_mass, m_gravity, m_points, m_velocity);
+    PROFILE_SCOPE("JelloCube::tick");
+    Diagnostics diagnostics;
+    rk4(m_dt, m_lattice, m_kElastic, m_dElastic, m_kCollision, m_dCollision,
+        m_mass, m_gravity, m_points, m_velocity, &diagnostics);
+    EnergyMonitor::record(diagnostics, energyScale(m_param1, m_kElastic, m_gravity));
+    updateSurface();
+}
+
+//Rebuilds whatever is drawn from the current positions: the render mesh if there is one, else the lattice's surface
+void JelloCube::updateSurface() {
+    if (m_renderMesh) {
+        PROFILE_SCOPE("EmbeddedMesh::deform");
+        m_renderMesh->deform(m_points.data());
+        m_renderMeshVBO->update(m_renderMesh->vertexData().data(), m_renderMesh->vertexData().size());
+        return;
+    }
+
+    gatherSurface();
     calculateNormals();
     m_vertexData.clear();
     loadVAO();
@@ -3,6 +3,11 @@
 
 #include "Shape.h"
 #include "JelloUtil.h"
+#include "EmbeddedMesh.h"
+#include "SurfaceSubdivision.h"
+
+#include "gl/datatype/IBO.h"
+#include "gl/datatype/VAO.h"
 
 using namespace JelloUtil;
 
@@ -13,6 +18,12 @@ public:
     JelloCube(int param1, float kElastic, float dElastic, float kCollision, float dCollision, float mass, float gravity);
     ~JelloCube();
     void tick(float current) override;
+    float getTimestep() override { return m_dt; }
+    bool getState(SimulationState &state) override;
+    bool setState(const SimulationState &state) override;
+    bool setPositions(const glm::vec3 *points, size_t count, LatticeLayout::Order order) override;
+    bool setRenderMesh(std::shared_ptr<const MeshGeometry> geometry) override;
+    bool setSurfaceSmoothing(int levels) override;
 
     virtual void setParam1(int inp) override;
     virtual void setParam2(int inp) override;
@@ -21,7 +32,7 @@ public:
     float getkElastic();
     void setkElastic(float kElastic);
     float getdElastic();
-    void setdElastic(float dCollision);
+    void setdElastic(float dElastic);
 
     float getkCollision();
     void setkCollision(float kCollision);
@@ -33,11 +44,15 @@ public:
 
     float getGravity();
     void setGravity(float scale, glm::vec3 new_direction) override;
+    bool setMaterial(float kElastic, float dElastic, float kCollision, float dCollision, float mass) override;
 private:
     virtual void generateVertexData() override;
 
+    void buildSurface();
+    void gatherSurface();
     void calculateNormals();
     void loadVAO();
+    void updateSurface();
 
     void euler();
 
@@ -52,8 +67,22 @@ private:
 
     //Standardizations for how to index in comments
     std::vector<glm::vec3> m_points; //points
+    std::vector<glm::vec3> m_surface; //points drawn for each of the 6 faces, m_surfaceDim x m_surfaceDim each
     std::vector<glm::vec3> m_normals; //normals for each of the 6 faces
     std::vector<glm::vec3> m_velocity; //velocities for each point
+    LatticeLayout m_lattice; //where each (row, column, depth) lives in m_points and m_velocity
+
+    // Catmull-Clark levels applied to each face before drawing it (0 draws the lattice's own grid).
+    int m_smoothing;
+    int m_surfaceDim;
+    std::unique_ptr<SurfaceSubdivision> m_subdivision;
+    std::vector<glm::vec3> m_faceColumns; //one face of the lattice, column by column, for m_subdivision
+
+    // Drawn instead of the lattice's surface when set. Its vertices are re-uploaded each tick into
+    // the same buffer; the triangles never change.
+    std::unique_ptr<EmbeddedMesh> m_renderMesh;
+    std::unique_ptr<CS123::GL::VBO> m_renderMeshVBO;
+    std::unique_ptr<CS123::GL::IBO> m_renderMeshIBO;
 };
 
 #endif // JELLOCUBE_H
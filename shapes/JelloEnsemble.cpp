@@ -0,0 +1,237 @@
+#include "JelloEnsemble.h"
+
+#include <cmath>
+
+#include "Profiler.h"
+#include "Settings.h"
+#include "SpringStencil.h"
+
+using namespace JelloUtil;
+
+namespace {
+
+// The Point arrays viewed as plain floats, for the updates that treat every component alike.
+float *floats(std::vector<JelloEnsemble::Point> &points) {
+    return &points[0].x.v[0];
+}
+
+const float *floats(const std::vector<JelloEnsemble::Point> &points) {
+    return &points[0].x.v[0];
+}
+
+size_t floatCount(const std::vector<JelloEnsemble::Point> &points) {
+    return points.size() * 3 * JelloEnsemble::LANES;
+}
+
+void setAll(JelloEnsemble::Lanes &lanes, float value) {
+    for (int l = 0; l < JelloEnsemble::LANES; l++) {
+        lanes.v[l] = value;
+    }
+}
+
+}
+
+JelloEnsemble::JelloEnsemble(int param1, float gravity) :
+    m_param1(param1),
+    m_gravity(gravity)
+{
+    for (int lane = 0; lane < LANES; lane++) {
+        setMaterial(lane, 200, 0.15, 400, 0.25, 0.001953);
+    }
+
+    int dim = m_param1 + 1;
+    float rest_length = 1.f / (dim-1);
+    float rests[NUM_SPRING_KINDS];
+    restLengths(dim, rests);
+
+    int count = dim * dim * dim;
+    m_points.resize(count);
+    m_velocity.resize(count);
+    m_firstSpring.resize(count + 1);
+    glm::vec3 start = glm::vec3(-0.5f, 0.5f, 0.5f);
+    for (int k = 0; k < dim; k++) {
+        for (int i = 0; i < dim; i++) {
+            for (int j = 0; j < dim; j++) {
+                int index = to1D(i, j, k, dim, dim);
+                glm::vec3 p = start + glm::vec3(j * rest_length, i * -rest_length, k * -rest_length);
+                setAll(m_points[index].x, p.x);
+                setAll(m_points[index].y, p.y);
+                setAll(m_points[index].z, p.z);
+                setAll(m_velocity[index].x, 0);
+                setAll(m_velocity[index].y, 0);
+                setAll(m_velocity[index].z, 0);
+
+                m_firstSpring[index] = m_springs.size();
+                // Same springs, in the same order, as JelloUtil::computeAcceleration visits them.
+                for (const SpringOffset &spring : SPRING_STENCIL) {
+                    int ni = i + spring.di, nj = j + spring.dj, nk = k + spring.dk;
+                    if (isInRange(ni, 0, dim-1) && isInRange(nj, 0, dim-1) && isInRange(nk, 0, dim-1)) {
+                        m_springs.push_back({ to1D(ni, nj, nk, dim, dim), rests[spring.kind] });
+                    }
+                }
+            }
+        }
+    }
+    m_firstSpring[count] = m_springs.size();
+
+    for (std::vector<Point> *buffer : { &m_acceleration, &m_bufferPoints, &m_bufferVelocity,
+                                        &m_points1, &m_velocity1, &m_points2, &m_velocity2,
+                                        &m_points3, &m_velocity3, &m_points4, &m_velocity4 }) {
+        buffer->resize(count);
+    }
+}
+
+void JelloEnsemble::setMaterial(int lane, float kElastic, float dElastic, float kCollision, float dCollision, float mass) {
+    m_kElastic.v[lane] = kElastic;
+    m_dElastic.v[lane] = dElastic;
+    m_kCollision.v[lane] = kCollision;
+    m_dCollision.v[lane] = dCollision;
+    m_mass.v[lane] = mass;
+}
+
+glm::vec3 JelloEnsemble::point(int lane, int index) const {
+    const Point &p = m_points[index];
+    return glm::vec3(p.x.v[lane], p.y.v[lane], p.z.v[lane]);
+}
+
+void JelloEnsemble::computeAcceleration(const std::vector<Point> &points, const std::vector<Point> &velocity,
+                                        std::vector<Point> &acceleration, Diagnostics *diagnostics) {
+    PROFILE_SCOPE("JelloEnsemble::computeAcceleration");
+    double kinetic[LANES] = {}, spring[LANES] = {}, gravity[LANES] = {}, collision[LANES] = {};
+    double momentumX[LANES] = {}, momentumY[LANES] = {}, momentumZ[LANES] = {};
+
+    glm::vec3 planeA(2, -2, -2);
+    glm::vec3 planeNormal = glm::normalize(glm::cross(glm::vec3(-2, -2, 2) - glm::vec3(-2, 2, -2),
+                                                      planeA - glm::vec3(-2, 2, -2)));
+    bool usePlane = settings.usePlane;
+
+    for (size_t index = 0; index < points.size(); index++) {
+        const Point &a = points[index];
+        const Point &va = velocity[index];
+        Lanes fx, fy, fz, springEnergy, collisionEnergy;
+        setAll(fx, 0);
+        setAll(fy, 0);
+        setAll(fz, 0);
+        setAll(springEnergy, 0);
+        setAll(collisionEnergy, 0);
+
+        for (int s = m_firstSpring[index]; s < m_firstSpring[index + 1]; s++) {
+            const Point &b = points[m_springs[s].other];
+            const Point &vb = velocity[m_springs[s].other];
+            float rest = m_springs[s].rest;
+            for (int l = 0; l < LANES; l++) {
+                float dx = a.x.v[l] - b.x.v[l], dy = a.y.v[l] - b.y.v[l], dz = a.z.v[l] - b.z.v[l];
+                float length = std::sqrt(dx * dx + dy * dy + dz * dz);
+                float inverse = 1.f / length;
+                dx *= inverse;
+                dy *= inverse;
+                dz *= inverse;
+
+                // Damping along the spring plus Hooke's law, as applyDampen and applyHooke.
+                float stretch = length - rest;
+                float closing = (va.x.v[l] - vb.x.v[l]) * dx + (va.y.v[l] - vb.y.v[l]) * dy + (va.z.v[l] - vb.z.v[l]) * dz;
+                float f = -m_dElastic.v[l] * closing - m_kElastic.v[l] * stretch;
+                fx.v[l] += f * dx;
+                fy.v[l] += f * dy;
+                fz.v[l] += f * dz;
+                springEnergy.v[l] += 0.25f * m_kElastic.v[l] * stretch * stretch;
+            }
+        }
+
+        // Walls and plane, written as selects rather than branches so that they vectorize.
+        auto walls = [&](const Lanes &p, const Lanes &v, Lanes &f) {
+            for (int l = 0; l < LANES; l++) {
+                float over = p.v[l] > 2 ? p.v[l] - 2 : (p.v[l] < -2 ? p.v[l] + 2 : 0.f);
+                f.v[l] += over != 0 ? -m_dCollision.v[l] * v.v[l] - m_kCollision.v[l] * over : 0.f;
+                collisionEnergy.v[l] += 0.5f * m_kCollision.v[l] * over * over;
+            }
+        };
+        walls(a.x, va.x, fx);
+        walls(a.y, va.y, fy);
+        walls(a.z, va.z, fz);
+        if (usePlane) {
+            for (int l = 0; l < LANES; l++) {
+                float depth = planeNormal.x * (a.x.v[l] - planeA.x) + planeNormal.y * (a.y.v[l] - planeA.y) +
+                              planeNormal.z * (a.z.v[l] - planeA.z);
+                float inside = depth < 0 ? 1.f : 0.f;
+                float kc = m_kCollision.v[l], dc = m_dCollision.v[l];
+                fx.v[l] += inside * (-dc * va.x.v[l] - kc * depth * planeNormal.x);
+                fy.v[l] += inside * (-dc * va.y.v[l] - kc * depth * planeNormal.y);
+                fz.v[l] += inside * (-dc * va.z.v[l] - kc * depth * planeNormal.z);
+                collisionEnergy.v[l] += inside * 0.5f * kc * depth * depth;
+            }
+        }
+
+        for (int l = 0; l < LANES; l++) {
+            float inverseMass = 1.f / m_mass.v[l];
+            acceleration[index].x.v[l] = fx.v[l] * inverseMass;
+            acceleration[index].y.v[l] = (fy.v[l] - m_gravity) * inverseMass;
+            acceleration[index].z.v[l] = fz.v[l] * inverseMass;
+        }
+
+        if (diagnostics) {
+            for (int l = 0; l < LANES; l++) {
+                float m = m_mass.v[l];
+                kinetic[l] += 0.5 * m * (va.x.v[l] * va.x.v[l] + va.y.v[l] * va.y.v[l] + va.z.v[l] * va.z.v[l]);
+                spring[l] += springEnergy.v[l];
+                gravity[l] += m_gravity * a.y.v[l];
+                collision[l] += collisionEnergy.v[l];
+                momentumX[l] += m * va.x.v[l];
+                momentumY[l] += m * va.y.v[l];
+                momentumZ[l] += m * va.z.v[l];
+            }
+        }
+    }
+
+    if (diagnostics) {
+        for (int l = 0; l < LANES; l++) {
+            diagnostics[l] = Diagnostics{ kinetic[l], spring[l], gravity[l], collision[l],
+                                          glm::dvec3(momentumX[l], momentumY[l], momentumZ[l]) };
+        }
+    }
+}
+
+void JelloEnsemble::step(float dt, Diagnostics *diagnostics) {
+    PROFILE_SCOPE("JelloEnsemble::step");
+    size_t n = floatCount(m_points);
+    float *points = floats(m_points), *velocity = floats(m_velocity);
+    const float *acceleration = floats(m_acceleration);
+    float *bufferPoints = floats(m_bufferPoints), *bufferVelocity = floats(m_bufferVelocity);
+    float *points1 = floats(m_points1), *velocity1 = floats(m_velocity1);
+    float *points2 = floats(m_points2), *velocity2 = floats(m_velocity2);
+    float *points3 = floats(m_points3), *velocity3 = floats(m_velocity3);
+    float *points4 = floats(m_points4), *velocity4 = floats(m_velocity4);
+
+    // The same stages as JelloUtil::rk4, over every component of every cube at once.
+    computeAcceleration(m_points, m_velocity, m_acceleration, diagnostics);
+    for (size_t i = 0; i < n; i++) {
+        points1[i] = dt * velocity[i];
+        velocity1[i] = dt * acceleration[i];
+        bufferPoints[i] = 0.5f * points1[i] + points[i];
+        bufferVelocity[i] = 0.5f * velocity1[i] + velocity[i];
+    }
+
+    computeAcceleration(m_bufferPoints, m_bufferVelocity, m_acceleration, nullptr);
+    for (size_t i = 0; i < n; i++) {
+        points2[i] = dt * bufferVelocity[i];
+        velocity2[i] = dt * acceleration[i];
+        bufferPoints[i] = 0.5f * points2[i] + points[i];
+        bufferVelocity[i] = 0.5f * velocity2[i] + velocity[i];
+    }
+
+    computeAcceleration(m_bufferPoints, m_bufferVelocity, m_acceleration, nullptr);
+    for (size_t i = 0; i < n; i++) {
+        points3[i] = dt * bufferVelocity[i];
+        velocity3[i] = dt * acceleration[i];
+        bufferPoints[i] = 0.5f * points3[i] + points[i];
+        bufferVelocity[i] = 0.5f * velocity3[i] + velocity[i];
+    }
+
+    computeAcceleration(m_bufferPoints, m_bufferVelocity, m_acceleration, nullptr);
+    for (size_t i = 0; i < n; i++) {
+        points4[i] = dt * bufferVelocity[i];
+        velocity4[i] = dt * acceleration[i];
+        points[i] += (2.f * points2[i] + 2.f * points3[i] + points1[i] + points4[i]) / 6.f;
+        velocity[i] += (2.f * velocity2[i] + 2.f * velocity3[i] + velocity1[i] + velocity4[i]) / 6.f;
+    }
+}
@@ -0,0 +1,78 @@
+#ifndef JELLOENSEMBLE_H
+#define JELLOENSEMBLE_H
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "JelloUtil.h"
+
+/**
+ * @class JelloEnsemble
+ *
+ * Eight independent jello cubes of the same resolution, stepped together. Small lattices leave
+ * most SIMD lanes idle when one cube is vectorized on its own, so here each lane is a different
+ * cube instead: every lattice point stores its x, y and z as eight floats, one per cube
+ * (array-of-structures-of-arrays), and every force is computed for all eight cubes in the same
+ * instructions. Each cube has its own material constants.
+ *
+ * The physics matches JelloUtil::rk4 step for step. The lane loops are written so that the
+ * compiler vectorizes them; build with CONFIG+=avx2 to get 8-wide AVX2 instead of 4-wide SSE.
+ */
+class JelloEnsemble {
+public:
+    static const int LANES = 8;
+
+    // One value per cube. Not over-aligned: before C++17, std::vector ignores alignas, and
+    // unaligned vector loads cost next to nothing on current CPUs.
+    struct Lanes {
+        float v[LANES];
+    };
+
+    // One lattice point of every cube.
+    struct Point {
+        Lanes x, y, z;
+    };
+
+    // Every cube starts as the undeformed lattice at the origin, at rest, as in the app.
+    JelloEnsemble(int param1, float gravity);
+
+    // Constants of one cube. Until they are set, every lane uses JelloCube's defaults.
+    void setMaterial(int lane, float kElastic, float dElastic, float kCollision, float dCollision, float mass);
+
+    // Advances every cube by dt. If diagnostics is given, it is filled in for each cube's state at
+    // the start of the step, as JelloUtil::rk4 does.
+    void step(float dt, JelloUtil::Diagnostics *diagnostics = nullptr);
+
+    int pointCount() const { return static_cast<int>(m_points.size()); }
+    glm::vec3 point(int lane, int index) const;
+
+private:
+    struct Spring {
+        int other;
+        float rest;
+    };
+
+    // Spring forces, collisions and gravity, for all lanes at once.
+    void computeAcceleration(const std::vector<Point> &points, const std::vector<Point> &velocity,
+                             std::vector<Point> &acceleration, JelloUtil::Diagnostics *diagnostics);
+
+    int m_param1;
+    float m_gravity;
+    Lanes m_kElastic, m_dElastic, m_kCollision, m_dCollision, m_mass;
+
+    // The springs of point i are m_springs[m_firstSpring[i]] up to m_springs[m_firstSpring[i + 1]].
+    std::vector<int> m_firstSpring;
+    std::vector<Spring> m_springs;
+
+    std::vector<Point> m_points;
+    std::vector<Point> m_velocity;
+
+    // Scratch space for step(), kept so that stepping never allocates.
+    std::vector<Point> m_acceleration;
+    std::vector<Point> m_bufferPoints, m_bufferVelocity;
+    std::vector<Point> m_points1, m_velocity1, m_points2, m_velocity2;
+    std::vector<Point> m_points3, m_velocity3, m_points4, m_velocity4;
+};
+
+#endif // JELLOENSEMBLE_H
@@ -1,7 +1,12 @@
 #include "JelloUtil.h"
 #include "math.h"
+#include <algorithm>
+#include <type_traits>
+#include <utility>
 #include "Settings.h"
 #include "gl/shaders/ShaderAttribLocations.h"
+#include "Profiler.h"
+#include "SpringStencil.h"
 
 const float epsilon {0.0005f};
 
@@ -11,25 +16,26 @@ int to1D(int r, int c, int d, int width, int height) {
     return d * (width * height) + r * (width) + c;
 }
 
-int indexFromFace(int i, int j, int dim, FACE face) {
+int indexFromFace(int i, int j, const LatticeLayout &lattice, FACE face) {
+    int dim = lattice.dim();
     switch(face) {
         case BOTTOM: {
-            return to1D(dim-1, i, dim-1-j, dim, dim);
+            return lattice.index(dim-1, i, dim-1-j);
         }
         case TOP: {
-            return to1D(0, i, j, dim, dim);
+            return lattice.index(0, i, j);
         }
         case FRONT: {
-            return to1D(i, j, 0, dim, dim);
+            return lattice.index(i, j, 0);
         }
         case BACK: {
-            return to1D(i, dim-1-j, dim-1, dim, dim);
+            return lattice.index(i, dim-1-j, dim-1);
         }
         case LEFT: {
-            return to1D(i, 0, dim-1-j, dim, dim);
+            return lattice.index(i, 0, dim-1-j);
         }
         case RIGHT: {
-            return to1D(i, dim-1, j, dim, dim);
+            return lattice.index(i, dim-1, j);
         }
     }
 }
@@ -42,6 +48,54 @@ bool isInRange(int x, int low, int high) {
     return low <= x && x <= high;
 }
 
+double energyScale(int param_1, float m_kElastic, const glm::vec3 &m_gravity) {
+    int dim = param_1 + 1;
+    double rest_length = 1.0 / (dim-1);
+    return pow(dim, 3) * (glm::length(m_gravity) + 0.5 * m_kElastic * rest_length * rest_length);
+}
+
+void resample(const LatticeLayout &from, const glm::vec3 *source, const LatticeLayout &to, glm::vec3 *destination) {
+    // Where a point of the new lattice falls in the old one: the cell it's in and how far along.
+    int cells = from.dim() - 1;
+    auto locate = [&](int x, int &cell, float &t) {
+        float position = to.dim() > 1 ? static_cast<float>(x) * cells / (to.dim() - 1) : 0.f;
+        cell = std::min(static_cast<int>(position), std::max(cells - 1, 0));
+        t = cells > 0 ? position - cell : 0.f;
+    };
+
+    to.forEach([&](int i, int j, int k, int index) {
+        int i0, j0, k0;
+        float ti, tj, tk;
+        locate(i, i0, ti);
+        locate(j, j0, tj);
+        locate(k, k0, tk);
+        int i1 = std::min(i0 + 1, cells), j1 = std::min(j0 + 1, cells), k1 = std::min(k0 + 1, cells);
+
+        auto at = [&](int r, int c, int d) { return source[from.index(r, c, d)]; };
+        glm::vec3 front = glm::mix(glm::mix(at(i0, j0, k0), at(i0, j1, k0), tj),
+                                  glm::mix(at(i1, j0, k0), at(i1, j1, k0), tj), ti);
+        glm::vec3 back = glm::mix(glm::mix(at(i0, j0, k1), at(i0, j1, k1), tj),
+                                 glm::mix(at(i1, j0, k1), at(i1, j1, k1), tj), ti);
+        destination[index] = glm::mix(front, back, tk);
+    });
+}
+
+float penetration(const glm::vec3 &point) {
+    // Same walls and plane as the collision forces in computeAcceleration.
+    float depth = 0;
+    for (int axis = 0; axis < 3; axis++) {
+        depth = std::max(depth, std::fabs(point[axis]) - 2.f);
+    }
+    if (settings.usePlane) {
+        glm::vec3 a(2, -2, -2);
+        glm::vec3 b(-2, 2, -2);
+        glm::vec3 c(-2,-2, 2);
+        glm::vec3 planeNormal = glm::normalize(glm::cross(c-b, a-b));
+        depth = std::max(depth, -glm::dot(planeNormal, point - a));
+    }
+    return depth;
+}
+
 glm::vec3 applyDampen(float m_dElastic, glm::vec3 a, glm::vec3 b, glm::vec3 t1_vec, glm::vec3 t2_vec) {
     glm::vec3 l = glm::normalize(a - b);
     return -m_dElastic * glm::dot(t1_vec-t2_vec, l) * l;
@@ -52,7 +106,184 @@ glm::vec3 applyHooke(float m_kElastic, float rest_len, glm::vec3 a, glm::vec3 b)
     return -m_kElastic * (glm::length(l) - rest_len) * glm::normalize(l);
 }
 
-void computeAcceleration(int param_1,
+namespace {
+
+// Everything one evaluation of the forces reads, shared by the generic and the specialized sweeps.
+struct Forces {
+    float kElastic;
+    float dElastic;
+    float kCollision;
+    float dCollision;
+    float mass;
+    glm::vec3 gravity;
+    float rest[NUM_SPRING_KINDS];
+    const glm::vec3 *points;
+    const glm::vec3 *velocity;
+    glm::vec3 *acceleration;
+    Diagnostics *diagnostics; // the current slab's partial sums
+};
+
+// Each k slab (dim * dim points in storage order) sums into its own partial, which is folded into
+// the total once the slab is done; slabs are independent, so the reduction holds if they're ever
+// split across threads.
+void foldSlab(Diagnostics &total, Diagnostics &slab) {
+    total.kinetic += slab.kinetic;
+    total.spring += slab.spring;
+    total.gravity += slab.gravity;
+    total.collision += slab.collision;
+    total.momentum += slab.momentum;
+    slab = Diagnostics{ 0, 0, 0, 0, glm::dvec3(0) };
+}
+
+inline void addSpring(const Forces &forces, int index, int other, float rest, glm::vec3 &F, double &springEnergy) {
+    const glm::vec3 *points = forces.points, *velocity = forces.velocity;
+    F += applyDampen(forces.dElastic, points[index], points[other], velocity[index], velocity[other]);
+    F += applyHooke(forces.kElastic, rest, points[index], points[other]);
+    if (forces.diagnostics) {
+        // Every spring is visited once from each end, so each visit gets half.
+        float stretch = glm::length(points[index] - points[other]) - rest;
+        springEnergy += 0.25 * forces.kElastic * stretch * stretch;
+    }
+}
+
+// Adds the walls, the plane and gravity to a point's spring forces, and stores its acceleration.
+void finishPoint(const Forces &forces, int index, glm::vec3 F, double springEnergy) {
+    const glm::vec3 *points = forces.points, *velocity = forces.velocity;
+    float m_kCollision = forces.kCollision, m_dCollision = forces.dCollision;
+    glm::vec3 fCollide = glm::vec3(0.f);
+    double collisionEnergy = 0;
+
+    //Bounding box
+    if (points[index].x > 2) {
+        fCollide.x += -m_dCollision * velocity[index].x + m_kCollision*std::fabs(points[index].x - 2) * -1;
+        collisionEnergy += 0.5 * m_kCollision * (points[index].x - 2) * (points[index].x - 2);
+    }
+
+    if (points[index].x < -2) {
+        fCollide.x += -m_dCollision * velocity[index].x + m_kCollision*std::fabs(points[index].x + 2);
+        collisionEnergy += 0.5 * m_kCollision * (points[index].x + 2) * (points[index].x + 2);
+    }
+
+    if (points[index].y > 2) {
+        fCollide.y += -m_dCollision * velocity[index].y + m_kCollision*std::fabs(points[index].y - 2) * -1;
+        collisionEnergy += 0.5 * m_kCollision * (points[index].y - 2) * (points[index].y - 2);
+    }
+
+    if (points[index].y < -2) {
+        fCollide.y += -m_dCollision * velocity[index].y + m_kCollision*std::fabs(points[index].y + 2);
+        collisionEnergy += 0.5 * m_kCollision * (points[index].y + 2) * (points[index].y + 2);
+    }
+
+    if (points[index].z > 2) {
+        fCollide.z += -m_dCollision * velocity[index].z + m_kCollision*std::fabs(points[index].z - 2) * -1;
+        collisionEnergy += 0.5 * m_kCollision * (points[index].z - 2) * (points[index].z - 2);
+    }
+
+    if (points[index].z < -2) {
+        fCollide.z += -m_dCollision * velocity[index].z + m_kCollision*std::fabs(points[index].z + 2);
+        collisionEnergy += 0.5 * m_kCollision * (points[index].z + 2) * (points[index].z + 2);
+    }
+    // TODO: We're using one plane, so I can factor out the math, but keeping it for demo purposes laterrrr
+
+    if (settings.usePlane) {
+        // 3 Points to Define a Plane
+        glm::vec3 a(2, -2, -2);
+        glm::vec3 b(-2, 2, -2);
+        glm::vec3 c(-2,-2, 2);
+
+        glm::vec3 planeCross = glm::cross(c-b, a-b);
+        glm::vec3 planeNormal = glm::normalize(planeCross);
+
+        glm::vec3 currentPoint = points[index];
+        float D;
+
+        if (  // Intersects Plane
+                (D = planeNormal.x * (currentPoint.x - a.x) +
+                  planeNormal.y * (currentPoint.y - a.y) +
+                  planeNormal.z * (currentPoint.z - a.z)) < 0) {
+
+            // Dampen Velocity
+//                        fCollide += -1.f * 0.5f * velocity[index];
+            fCollide += -1.f * m_dCollision * velocity[index];
+
+            // m_kCollision * Distance from point to plane * Normal
+            float distToPlane = fabs(glm::dot(planeNormal, currentPoint - a));
+//                                            fCollide += 50 * distToPlane * planeNormal;
+            fCollide += m_kCollision * distToPlane * planeNormal;
+            collisionEnergy += 0.5 * m_kCollision * distToPlane * distToPlane;
+        }
+    }
+
+
+    F += fCollide;
+    //Force Field Calculation - by default exerts gravity everywhere
+    //In the future this should taken from as an input
+    F += forces.gravity;
+
+    forces.acceleration[index] = F * 1.0f/forces.mass;
+
+    if (Diagnostics *diagnostics = forces.diagnostics) {
+        diagnostics->kinetic += 0.5 * forces.mass * glm::dot(velocity[index], velocity[index]);
+        diagnostics->spring += springEnergy;
+        diagnostics->gravity -= glm::dot(forces.gravity, points[index]);
+        diagnostics->collision += collisionEnergy;
+        diagnostics->momentum += glm::dvec3(forces.mass * velocity[index]);
+    }
+}
+
+// Any point of any lattice: springs that would leave the lattice are skipped.
+void genericPoint(const Forces &forces, const LatticeLayout &lattice, int i, int j, int k, int index) {
+    int last = lattice.dim() - 1;
+    glm::vec3 F = glm::vec3(0.f);
+    double springEnergy = 0;
+    for (const SpringOffset &spring : SPRING_STENCIL) {
+        if (isInRange(i + spring.di, 0, last) && isInRange(j + spring.dj, 0, last) &&
+                isInRange(k + spring.dk, 0, last)) {
+            addSpring(forces, index, lattice.index(i + spring.di, j + spring.dj, k + spring.dk),
+                      forces.rest[spring.kind], F, springEnergy);
+        }
+    }
+    finishPoint(forces, index, F, springEnergy);
+}
+
+// A point at least STENCIL_REACH away from every face of a row-major Dim lattice, so it has all
+// of its springs. The springs are unrolled, with each neighbor's offset a compile-time constant.
+template <int Dim, int... S>
+void interiorPoint(const Forces &forces, int index, std::integer_sequence<int, S...>) {
+    glm::vec3 F = glm::vec3(0.f);
+    double springEnergy = 0;
+    // Braced initializers are evaluated in order, so the forces add up as in genericPoint.
+    int unrolled[] = { (addSpring(forces, index,
+                                  index + std::integral_constant<int, RowMajorStencil<Dim>().offset[S]>::value,
+                                  forces.rest[SPRING_STENCIL[S].kind], F, springEnergy), 0)... };
+    (void) unrolled;
+    finishPoint(forces, index, F, springEnergy);
+}
+
+// Sweeps a row-major Dim lattice: the interior through interiorPoint, the shell of points near the
+// faces through genericPoint.
+template <int Dim>
+void rowMajorSweep(const Forces &forces, const LatticeLayout &lattice, Diagnostics *diagnostics) {
+    const int low = STENCIL_REACH, high = Dim - 1 - STENCIL_REACH;
+    int index = 0;
+    for (int k = 0; k < Dim; k++) {
+        for (int i = 0; i < Dim; i++) {
+            bool interiorRow = low <= k && k <= high && low <= i && i <= high;
+            for (int j = 0; j < Dim; j++, index++) {
+                if (interiorRow && low <= j && j <= high) {
+                    interiorPoint<Dim>(forces, index, std::make_integer_sequence<int, STENCIL_SIZE>());
+                } else {
+                    genericPoint(forces, lattice, i, j, k, index);
+                }
+            }
+        }
+        if (diagnostics) foldSlab(*diagnostics, *forces.diagnostics);
+    }
+}
+
+}
+
+void computeAcceleration(const LatticeLayout &lattice,
                          float m_kElastic,
                          float m_dElastic,
                          float m_kCollision,
@@ -61,224 +292,35 @@ void computeAcceleration(int param_1,
                          const glm::vec3 &m_gravity,
                          std::vector<glm::vec3> &points,
                          std::vector<glm::vec3> &velocity,
-                         std::vector<glm::vec3> &acceleration) {
-    int dim = param_1 + 1;
-    float rest_length = 1.f / (dim-1), rest_shear, rest_bend, rest_diag;
-    rest_shear = rest_length * sqrt(2);
-    rest_diag = rest_length * sqrt(3);
-    rest_bend = rest_length * 2;
-    for (int k = 0; k < dim; k++) {
-            for (int i = 0; i < dim; i++) {
-                for (int j = 0; j < dim; j++) {
-                    glm::vec3 F = glm::vec3(0.f);
-                    glm::vec3 fCollide = glm::vec3(0.f);
-                    int index = to1D(i, j, k, dim, dim);
-
-                    //Structural
-                    if (isInRange(i + 1, 0, dim - 1)) {
-                        F += applyDampen(m_dElastic, points[index], points[to1D(i+1, j, k, dim, dim)], velocity[index], velocity[to1D(i+1, j, k, dim, dim)]);
-                        F += applyHooke(m_kElastic, rest_length, points[index], points[to1D(i+1, j, k, dim, dim)]);
-                    }
-                    if (isInRange(i - 1, 0, dim - 1)) {
-                        F += applyDampen(m_dElastic, points[index], points[to1D(i-1, j, k, dim, dim)], velocity[index], velocity[to1D(i-1, j, k, dim, dim)]);
-                        F += applyHooke(m_kElastic, rest_length, points[index], points[to1D(i-1, j, k, dim, dim)]);
-                    }
-                    if (isInRange(j + 1, 0, dim - 1)) {
-                        F += applyDampen(m_dElastic, points[index], points[to1D(i, j+1, k, dim, dim)], velocity[index], velocity[to1D(i, j+1, k, dim, dim)]);
-                        F += applyHooke(m_kElastic, rest_length, points[index], points[to1D(i, j+1, k, dim, dim)]);
-                    }
-                    if (isInRange(j - 1, 0, dim - 1)) {
-                        F += applyDampen(m_dElastic, points[index], points[to1D(i, j-1, k, dim, dim)], velocity[index], velocity[to1D(i, j-1, k, dim, dim)]);
-                        F += applyHooke(m_kElastic, rest_length, points[index], points[to1D(i, j-1, k, dim, dim)]);
-                    }
-                    if (isInRange(k + 1, 0, dim - 1)) {
-                        F += applyDampen(m_dElastic, points[index], points[to1D(i, j, k+1, dim, dim)], velocity[index], velocity[to1D(i, j, k+1, dim, dim)]);
-                        F += applyHooke(m_kElastic, rest_length, points[index], points[to1D(i, j, k+1, dim, dim)]);
-                    }
-                    if (isInRange(k - 1, 0, dim - 1)) {
-                        F += applyDampen(m_dElastic, points[index], points[to1D(i, j, k-1, dim, dim)], velocity[index], velocity[to1D(i, j, k-1, dim, dim)]);
-                        F += applyHooke(m_kElastic, rest_length, points[index], points[to1D(i, j, k-1, dim, dim)]);
-                    }
-
-                    //Shear
-                    if (isInRange(i + 1, 0, dim-1) && isInRange(j + 1, 0, dim-1)) {
-                        F += applyDampen(m_dElastic, points[index], points[to1D(i+1, j+1, k, dim, dim)], velocity[index], velocity[to1D(i+1, j+1, k, dim, dim)]);
-                        F += applyHooke(m_kElastic, rest_shear, points[index], points[to1D(i+1, j+1, k, dim, dim)]);
-                    }
-                    if (isInRange(i + 1, 0, dim-1) && isInRange(j - 1, 0, dim-1)) {
-                        F += applyDampen(m_dElastic, points[index], points[to1D(i+1, j-1, k, dim, dim)], velocity[index], velocity[to1D(i+1, j-1, k, dim, dim)]);
-                        F += applyHooke(m_kElastic, rest_shear, points[index], points[to1D(i+1, j-1, k, dim, dim)]);
-                    }
-                    if (isInRange(i - 1, 0, dim-1) && isInRange(j + 1, 0, dim-1)) {
-                        F += applyDampen(m_dElastic, points[index], points[to1D(i-1, j+1, k, dim, dim)], velocity[index], velocity[to1D(i-1, j+1, k, dim, dim)]);
-                        F += applyHooke(m_kElastic, rest_shear, points[index], points[to1D(i-1, j+1, k, dim, dim)]);
-                    }
-                    if (isInRange(i - 1, 0, dim-1) && isInRange(j - 1, 0, dim-1)) {
-                        F += applyDampen(m_dElastic, points[index], points[to1D(i-1, j-1, k, dim, dim)], velocity[index], velocity[to1D(i-1, j-1, k, dim, dim)]);
-                        F += applyHooke(m_kElastic, rest_shear, points[index], points[to1D(i-1, j-1, k, dim, dim)]);
-                    }
-                    if (isInRange(j + 1, 0, dim-1) && isInRange(k + 1, 0, dim-1)) {
-                        F += applyDampen(m_dElastic, points[index], points[to1D(i, j+1, k+1, dim, dim)], velocity[index], velocity[to1D(i, j+1, k+1, dim, dim)]);
-                        F += applyHooke(m_kElastic, rest_shear, points[index], points[to1D(i, j+1, k+1, dim, dim)]);
-                    }
-                    if (isInRange(j - 1, 0, dim-1) && isInRange(k + 1, 0, dim-1)) {
-                        F += applyDampen(m_dElastic, points[index], points[to1D(i, j-1, k+1, dim, dim)], velocity[index], velocity[to1D(i, j-1, k+1, dim, dim)]);
-                        F += applyHooke(m_kElastic, rest_shear, points[index], points[to1D(i, j-1, k+1, dim, dim)]);
-                    }
-                    if (isInRange(j + 1, 0, dim-1) && isInRange(k - 1, 0, dim-1)) {
-                        F += applyDampen(m_dElastic, points[index], points[to1D(i, j+1, k-1, dim, dim)], velocity[index], velocity[to1D(i, j+1, k-1, dim, dim)]);
-                        F += applyHooke(m_kElastic, rest_shear, points[index], points[to1D(i, j+1, k-1, dim, dim)]);
-                    }
-                    if (isInRange(j - 1, 0, dim-1) && isInRange(k - 1, 0, dim-1)) {
-                        F += applyDampen(m_dElastic, points[index], points[to1D(i, j-1, k-1, dim, dim)], velocity[index], velocity[to1D(i, j-1, k-1, dim, dim)]);
-                        F += applyHooke(m_kElastic, rest_shear, points[index], points[to1D(i, j-1, k-1, dim, dim)]);
-                    }
-                    if (isInRange(i + 1, 0, dim-1) && isInRange(k + 1, 0, dim-1)) {
-                        F += applyDampen(m_dElastic, points[index], points[to1D(i+1, j, k+1, dim, dim)], velocity[index], velocity[to1D(i+1, j, k+1, dim, dim)]);
-                        F += applyHooke(m_kElastic, rest_shear, points[index], points[to1D(i+1, j, k+1, dim, dim)]);
-                    }
-                    if (isInRange(i - 1, 0, dim-1) && isInRange(k + 1, 0, dim-1)) {
-                        F += applyDampen(m_dElastic, points[index], points[to1D(i-1, j, k+1, dim, dim)], velocity[index], velocity[to1D(i-1, j, k+1, dim, dim)]);
-                        F += applyHooke(m_kElastic, rest_shear, points[index], points[to1D(i-1, j, k+1, dim, dim)]);
-                    }
-                    if (isInRange(i + 1, 0, dim-1) && isInRange(k - 1, 0, dim-1)) {
-                        F += applyDampen(m_dElastic, points[index], points[to1D(i+1, j, k-1, dim, dim)], velocity[index], velocity[to1D(i+1, j, k-1, dim, dim)]);
-                        F += applyHooke(m_kElastic, rest_shear, points[index], points[to1D(i+1, j, k-1, dim, dim)]);
-                    }
-                    if (isInRange(i - 1, 0, dim-1) && isInRange(k - 1, 0, dim-1)) {
-                        F += applyDampen(m_dElastic, points[index], points[to1D(i-1, j, k-1, dim, dim)], velocity[index], velocity[to1D(i-1, j, k-1, dim, dim)]);
-                        F += applyHooke(m_kElastic, rest_shear, points[index], points[to1D(i-1, j, k-1, dim, dim)]);
-                    }
-
-                    //Bend
-                    if (isInRange(i + 2, 0, dim-1)) {
-                        F += applyDampen(m_dElastic, points[index], points[to1D(i+2, j, k, dim, dim)], velocity[index], velocity[to1D(i+2, j, k, dim, dim)]);
-                        F += applyHooke(m_kElastic, rest_bend, points[index], points[to1D(i+2, j, k, dim, dim)]);
-                    }
-                    if (isInRange(i - 2, 0, dim-1)) {
-                        F += applyDampen(m_dElastic, points[index], points[to1D(i-2, j, k, dim, dim)], velocity[index], velocity[to1D(i-2, j, k, dim, dim)]);
-                        F += applyHooke(m_kElastic, rest_bend, points[index], points[to1D(i-2, j, k, dim, dim)]);
-                    }
-                    if (isInRange(j + 2, 0, dim-1)) {
-                        F += applyDampen(m_dElastic, points[index], points[to1D(i, j+2, k, dim, dim)], velocity[index], velocity[to1D(i, j+2, k, dim, dim)]);
-                        F += applyHooke(m_kElastic, rest_bend, points[index], points[to1D(i, j+2, k, dim, dim)]);
-                    }
-                    if (isInRange(j - 2, 0, dim-1)) {
-                        F += applyDampen(m_dElastic, points[index], points[to1D(i, j-2, k, dim, dim)], velocity[index], velocity[to1D(i, j-2, k, dim, dim)]);
-                        F += applyHooke(m_kElastic, rest_bend, points[index], points[to1D(i, j-2, k, dim, dim)]);
-                    }
-                    if (isInRange(k + 2, 0, dim-1)) {
-                        F += applyDampen(m_dElastic, points[index], points[to1D(i, j, k+2, dim, dim)], velocity[index], velocity[to1D(i, j, k+2, dim, dim)]);
-                        F += applyHooke(m_kElastic, rest_bend, points[index], points[to1D(i, j, k+2, dim, dim)]);
-                    }
-                    if (isInRange(k - 2, 0, dim-1)) {
-                        F += applyDampen(m_dElastic, points[index], points[to1D(i, j, k-2, dim, dim)], velocity[index], velocity[to1D(i, j, k-2, dim, dim)]);
-                        F += applyHooke(m_kElastic, rest_bend, points[index], points[to1D(i, j, k-2, dim, dim)]);
-                    }
-
-                    //Diagonals
-                    if (isInRange(i + 1, 0, dim-1) && isInRange(j + 1, 0, dim-1) && isInRange(k + 1, 0, dim-1)) {
-                        F += applyDampen(m_dElastic, points[index], points[to1D(i+1, j+1, k+1, dim, dim)], velocity[index], velocity[to1D(i+1, j+1, k+1, dim, dim)]);
-                        F += applyHooke(m_kElastic, rest_diag, points[index], points[to1D(i+1, j+1, k+1, dim, dim)]);
-                    }
-                    if (isInRange(i - 1, 0, dim-1) && isInRange(j + 1, 0, dim-1) && isInRange(k + 1, 0, dim-1)) {
-                        F += applyDampen(m_dElastic, points[index], points[to1D(i-1, j+1, k+1, dim, dim)], velocity[index], velocity[to1D(i-1, j+1, k+1, dim, dim)]);
-                        F += applyHooke(m_kElastic, rest_diag, points[index], points[to1D(i-1, j+1, k+1, dim, dim)]);
-                    }
-                    if (isInRange(i - 1, 0, dim-1) && isInRange(j - 1, 0, dim-1) && isInRange(k + 1, 0, dim-1)) {
-                        F += applyDampen(m_dElastic, points[index], points[to1D(i-1, j-1, k+1, dim, dim)], velocity[index], velocity[to1D(i-1, j-1, k+1, dim, dim)]);
-                        F += applyHooke(m_kElastic, rest_diag, points[index], points[to1D(i-1, j-1, k+1, dim, dim)]);
-                    }
-                    if (isInRange(i + 1, 0, dim-1) && isInRange(j - 1, 0, dim-1) && isInRange(k + 1, 0, dim-1)) {
-                        F += applyDampen(m_dElastic, points[index], points[to1D(i+1, j-1, k+1, dim, dim)], velocity[index], velocity[to1D(i+1, j-1, k+1, dim, dim)]);
-                        F += applyHooke(m_kElastic, rest_diag, points[index], points[to1D(i+1, j-1, k+1, dim, dim)]);
-                    }
-                    if (isInRange(i + 1, 0, dim-1) && isInRange(j - 1, 0, dim-1) && isInRange(k - 1, 0, dim-1)) {
-                        F += applyDampen(m_dElastic, points[index], points[to1D(i+1, j-1, k-1, dim, dim)], velocity[index], velocity[to1D(i+1, j-1, k-1, dim, dim)]);
-                        F += applyHooke(m_kElastic, rest_diag, points[index], points[to1D(i+1, j-1, k-1, dim, dim)]);
-                    }
-                    if (isInRange(i + 1, 0, dim-1) && isInRange(j + 1, 0, dim-1) && isInRange(k - 1, 0, dim-1)) {
-                        F += applyDampen(m_dElastic, points[index], points[to1D(i+1, j+1, k-1, dim, dim)], velocity[index], velocity[to1D(i+1, j+1, k-1, dim, dim)]);
-                        F += applyHooke(m_kElastic, rest_diag, points[index], points[to1D(i+1, j+1, k-1, dim, dim)]);
-                    }
-                    if (isInRange(i - 1, 0, dim-1) && isInRange(j + 1, 0, dim-1) && isInRange(k - 1, 0, dim-1)) {
-                        F += applyDampen(m_dElastic, points[index], points[to1D(i-1, j+1, k-1, dim, dim)], velocity[index], velocity[to1D(i-1, j+1, k-1, dim, dim)]);
-                        F += applyHooke(m_kElastic, rest_diag, points[index], points[to1D(i-1, j+1, k-1, dim, dim)]);
-                    }
-                    if (isInRange(i - 1, 0, dim-1) && isInRange(j - 1, 0, dim-1) && isInRange(k - 1, 0, dim-1)) {
-                        F += applyDampen(m_dElastic, points[index], points[to1D(i-1, j-1, k-1, dim, dim)], velocity[index], velocity[to1D(i-1, j-1, k-1, dim, dim)]);
-                        F += applyHooke(m_kElastic, rest_diag, points[index], points[to1D(i-1, j-1, k-1, dim, dim)]);
-                    }
-
-                    //Bounding box
-                    if (points[index].x > 2) {
-                        fCollide.x += -m_dCollision * velocity[index].x + m_kCollision*std::fabs(points[index].x - 2) * -1;
-                    }
-
-                    if (points[index].x < -2) {
-                        fCollide.x += -m_dCollision * velocity[index].x + m_kCollision*std::fabs(points[index].x + 2);
-                    }
-
-                    if (points[index].y > 2) {
-                        fCollide.y += -m_dCollision * velocity[index].y + m_kCollision*std::fabs(points[index].y - 2) * -1;
-                    }
-
-                    if (points[index].y < -2) {
-                        fCollide.y += -m_dCollision * velocity[index].y + m_kCollision*std::fabs(points[index].y + 2);
-                    }
-
-                    if (points[index].z > 2) {
-                        fCollide.z += -m_dCollision * velocity[index].z + m_kCollision*std::fabs(points[index].z - 2) * -1;
-                    }
-
-                    if (points[index].z < -2) {
-                        fCollide.z += -m_dCollision * velocity[index].z + m_kCollision*std::fabs(points[index].z + 2);
-                    }
-                    // TODO: We're using one plane, so I can factor out the math, but keeping it for demo purposes laterrrr
-
-                    if (settings.usePlane) {
-                        // 3 Points to Define a Plane
-                        glm::vec3 a(2, -2, -2);
-                        glm::vec3 b(-2, 2, -2);
-                        glm::vec3 c(-2,-2, 2);
-
-                        glm::vec3 planeCross = glm::cross(c-b, a-b);
-                        glm::vec3 planeNormal = glm::normalize(planeCross);
-
-                        glm::vec3 currentPoint = points[index];
-                        float D;
-
-                        if (  // Intersects Plane
-                                (D = planeNormal.x * (currentPoint.x - a.x) +
-                                  planeNormal.y * (currentPoint.y - a.y) +
-                                  planeNormal.z * (currentPoint.z - a.z)) < 0) {
-
-                            // Dampen Velocity
-    //                        fCollide += -1.f * 0.5f * velocity[index];
-                            fCollide += -1.f * m_dCollision * velocity[index];
-
-                            // m_kCollision * Distance from point to plane * Normal
-                            float distToPlane = fabs(glm::dot(planeNormal, currentPoint - a));
-    //                                            fCollide += 50 * distToPlane * planeNormal;
-                            fCollide += m_kCollision * distToPlane * planeNormal;
-                        }
-                    }
-
-
-                    F += fCollide;
-                    //Force Field Calculation - by default exerts gravity everywhere
-                    //In the future this should taken from as an input
-                    F += m_gravity;
-
-                    acceleration[index] = F * 1.0f/m_mass;
-
-                }
-          }
+                         std::vector<glm::vec3> &acceleration,
+                         Diagnostics *diagnostics) {
+    PROFILE_SCOPE("computeAcceleration");
+    Diagnostics slab = { 0, 0, 0, 0, glm::dvec3(0) };
+    Forces forces = { m_kElastic, m_dElastic, m_kCollision, m_dCollision, m_mass, m_gravity, {},
+                      points.data(), velocity.data(), acceleration.data(), diagnostics ? &slab : nullptr };
+    restLengths(lattice.dim(), forces.rest);
+    if (diagnostics) *diagnostics = Diagnostics{ 0, 0, 0, 0, glm::dvec3(0) };
+
+    // The resolutions most runs use get a sweep specialized on their size.
+    if (lattice.order() == LatticeLayout::ROW_MAJOR) {
+        switch (lattice.dim()) {
+            case 9: rowMajorSweep<9>(forces, lattice, diagnostics); return;
+            case 17: rowMajorSweep<17>(forces, lattice, diagnostics); return;
+            case 33: rowMajorSweep<33>(forces, lattice, diagnostics); return;
+        }
     }
+
+    // Points are visited in storage order, so that the sweep walks memory front to back. In tiled
+    // order a slab's dim * dim points span tile columns rather than one k, but are still contiguous.
+    int slabSize = lattice.dim() * lattice.dim();
+    lattice.forEach([&](int i, int j, int k, int index) {
+        genericPoint(forces, lattice, i, j, k, index);
+        if (diagnostics && (index + 1) % slabSize == 0) foldSlab(*diagnostics, slab);
+    });
 }
 
 void rk4(float dt,
-         int m_param1,
+         const LatticeLayout &lattice,
          float m_kElastic,
          float m_dElastic,
          float m_kCollision,
@@ -286,9 +328,10 @@ void rk4(float dt,
          float m_mass,
          const glm::vec3 &m_gravity,
          std::vector<glm::vec3> &points,
-         std::vector<glm::vec3> &velocity) {
-    int dim = m_param1 + 1;
-    int num_control_points = pow(dim,3);
+         std::vector<glm::vec3> &velocity,
+         Diagnostics *diagnostics) {
+    PROFILE_SCOPE("rk4");
+    int num_control_points = lattice.size();
 
     std::vector<glm::vec3> buffer_points;
     std::vector<glm::vec3> buffer_velocity;
@@ -319,9 +362,9 @@ void rk4(float dt,
     velocity4.reserve(num_control_points);
 
     computeAcceleration(
-                m_param1, m_kElastic, m_dElastic,
+                lattice, m_kElastic, m_dElastic,
                 m_kCollision, m_dCollision, m_mass, m_gravity,
-                points, velocity, acceleration);
+                points, velocity, acceleration, diagnostics);
     for (int i = 0; i < num_control_points; i++) {
         points1[i] = dt * velocity[i];
         velocity1[i] = dt * acceleration[i];
@@ -332,7 +375,7 @@ void rk4(float dt,
     }
 
     computeAcceleration(
-                m_param1, m_kElastic, m_dElastic,
+                lattice, m_kElastic, m_dElastic,
                 m_kCollision, m_dCollision, m_mass, m_gravity,
                 buffer_points, buffer_velocity, acceleration);
     for (int i = 0; i < num_control_points; i++) {
@@ -345,7 +388,7 @@ void rk4(float dt,
     }
 
     computeAcceleration(
-                m_param1, m_kElastic, m_dElastic,
+                lattice, m_kElastic, m_dElastic,
                 m_kCollision, m_dCollision, m_mass, m_gravity,
                 buffer_points, buffer_velocity, acceleration);
     for (int i = 0; i < num_control_points; i++) {
@@ -358,7 +401,7 @@ void rk4(float dt,
     }
 
     computeAcceleration(
-                m_param1, m_kElastic, m_dElastic,
+                lattice, m_kElastic, m_dElastic,
                 m_kCollision, m_dCollision, m_mass, m_gravity,
                 buffer_points, buffer_velocity, acceleration);
     for (int i = 0; i < num_control_points; i++) {
@@ -7,6 +7,8 @@
 
 #include<memory>
 
+#include "LatticeLayout.h"
+
 enum FACE {
     BOTTOM,
     TOP,
@@ -18,6 +20,7 @@ enum FACE {
 
 namespace JelloUtil {
 
+// Row-major index into a width x height x depth grid. Lattice points go through LatticeLayout instead.
 int to1D(int r, int c, int d, int width, int height);
 
 //Convention for indexing points
@@ -28,18 +31,44 @@ int to1D(int r, int c, int d, int width, int height);
 //Left - [i][0][j]
 //Right - [i][dim-1][j]
 //*Note that some go the opposite way - I'm not sure why but this makes it work so dont' touch it lol
-int indexFromFace(int i, int j, int dim, FACE face);
+int indexFromFace(int i, int j, const LatticeLayout &lattice, FACE face);
 
 int pEquals(float a, float b);
 
 //Returns whether or not is in range, inclusive
 bool isInRange(int x, int low, int high);
 
+// Energy and momentum of the whole lattice at one instant. Gravity's potential is measured from
+// the origin, so only its changes mean anything.
+struct Diagnostics {
+    double kinetic;
+    double spring;    // stored in the elastic springs
+    double gravity;
+    double collision; // stored in the penalty springs of the walls and the plane
+    glm::dvec3 momentum;
+
+    double total() const { return kinetic + spring + gravity + collision; }
+};
+
+// Energy the cube can plausibly gain or lose: every point falling one cube width, plus every
+// point's springs stretched by a full rest length. Used as the tolerance for blow-up detection.
+double energyScale(int param_1, float m_kElastic, const glm::vec3 &m_gravity);
+
+// Trilinearly interpolates a value stored per point of from's lattice at every point of to's, both
+// spanning the same cube; e.g. to carry a deformed cube over to another resolution.
+void resample(const LatticeLayout &from, const glm::vec3 *source, const LatticeLayout &to, glm::vec3 *destination);
+
+// How far a point has gone into the bounding box walls or, if it's enabled, the plane; 0 if it
+// touches neither.
+float penetration(const glm::vec3 &point);
+
 glm::vec3 applyDampen(float m_dElastic, glm::vec3 a, glm::vec3 b, glm::vec3 t1_vec, glm::vec3 t2_vec);
 
 glm::vec3 applyHooke(float m_kElastic, float rest_len, glm::vec3 a, glm::vec3 b);
 
-void computeAcceleration(int param_1,
+// If diagnostics is given, it is filled in for the state passed in, summed during the same sweep
+// that computes the forces.
+void computeAcceleration(const LatticeLayout &lattice,
                          float m_kElastic,
                          float m_dElastic,
                          float m_kCollision,
@@ -48,10 +77,12 @@ void computeAcceleration(int param_1,
                          const glm::vec3 &m_gravity,
                          std::vector<glm::vec3> &points,
                          std::vector<glm::vec3> &velocity,
-                         std::vector<glm::vec3> &acceleration);
+                         std::vector<glm::vec3> &acceleration,
+                         Diagnostics *diagnostics = nullptr);
 
+// If diagnostics is given, it is filled in for the state at the start of the step.
 void rk4(float dt,
-         int m_param1,
+         const LatticeLayout &lattice,
          float m_kElastic,
          float m_dElastic,
          float m_kCollision,
@@ -59,7 +90,8 @@ void rk4(float dt,
          float m_mass,
          const glm::vec3 &m_gravity,
          std::vector<glm::vec3> &points,
-         std::vector<glm::vec3> &velocity);
+         std::vector<glm::vec3> &velocity,
+         Diagnostics *diagnostics = nullptr);
 
 }
 
@@ -0,0 +1,160 @@
+#include "LatticeBenchmark.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "JelloUtil.h"
+
+using namespace JelloUtil;
+
+namespace {
+
+const float DT = 0.001f; // as in the cubes
+
+// One hardware counter for the calling thread, in user space only. Reads -1 if the kernel or
+// the machine doesn't offer it (e.g. in a VM, or with perf_event_paranoid set too high).
+class Counter {
+public:
+    Counter(uint32_t type, uint64_t config) : m_fd(-1) {
+#ifdef __linux__
+        perf_event_attr attr = {};
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        m_fd = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+#else
+        (void) type;
+        (void) config;
+#endif
+    }
+    Counter(const Counter&) = delete;
+    Counter& operator=(const Counter&) = delete;
+    ~Counter() {
+#ifdef __linux__
+        if (m_fd >= 0) close(m_fd);
+#endif
+    }
+
+    void start() {
+#ifdef __linux__
+        if (m_fd < 0) return;
+        ioctl(m_fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(m_fd, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+    }
+
+    void stop() {
+#ifdef __linux__
+        if (m_fd >= 0) ioctl(m_fd, PERF_EVENT_IOC_DISABLE, 0);
+#endif
+    }
+
+    double read() const {
+#ifdef __linux__
+        uint64_t value = 0;
+        if (m_fd >= 0 && ::read(m_fd, &value, sizeof(value)) == sizeof(value)) return static_cast<double>(value);
+#endif
+        return -1;
+    }
+
+private:
+    int m_fd;
+};
+
+#ifdef __linux__
+const uint32_t L1_TYPE = PERF_TYPE_HW_CACHE;
+const uint64_t L1_CONFIG = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                           (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+const uint32_t LLC_TYPE = PERF_TYPE_HARDWARE;
+const uint64_t LLC_CONFIG = PERF_COUNT_HW_CACHE_MISSES;
+#else
+const uint32_t L1_TYPE = 0, LLC_TYPE = 0;
+const uint64_t L1_CONFIG = 0, LLC_CONFIG = 0;
+#endif
+
+LatticeBenchmark::Result benchmark(int param1, LatticeLayout::Order order,
+                                   const LatticeBenchmark::Material &material, double seconds) {
+    // The same starting lattice as the cubes build in generateVertexData().
+    LatticeLayout lattice(param1 + 1, order);
+    float incr = 1.f / param1;
+    std::vector<glm::vec3> points(lattice.size());
+    std::vector<glm::vec3> velocity(lattice.size(), glm::vec3(0.f));
+    glm::vec3 start = glm::vec3(-0.5f, 0.5f, 0.5f);
+    lattice.forEach([&](int i, int j, int k, int index) {
+        points[index] = start + glm::vec3(j * incr, i * -incr, k * -incr);
+    });
+    glm::vec3 gravity = glm::vec3(0.f, -material.gravity, 0.f);
+    auto step = [&] {
+        rk4(DT, lattice, material.kElastic, material.dElastic, material.kCollision, material.dCollision,
+            material.mass, gravity, points, velocity);
+    };
+
+    // The first step pays for rk4's buffers and faulting the arrays in.
+    step();
+
+    Counter l1Misses(L1_TYPE, L1_CONFIG), cacheMisses(LLC_TYPE, LLC_CONFIG);
+    l1Misses.start();
+    cacheMisses.start();
+    auto begin = std::chrono::steady_clock::now();
+    double elapsed = 0;
+    int steps = 0;
+    while (steps < 2 || elapsed < seconds) {
+        step();
+        steps++;
+        elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    }
+    l1Misses.stop();
+    cacheMisses.stop();
+
+    double l1 = l1Misses.read(), llc = cacheMisses.read();
+    return { param1, order, steps, steps / elapsed, l1 < 0 ? -1 : l1 / steps, llc < 0 ? -1 : llc / steps };
+}
+
+}
+
+std::vector<LatticeBenchmark::Result> LatticeBenchmark::run(const std::vector<int> &param1s,
+                                                            const Material &material, double seconds) {
+    std::vector<Result> results;
+    for (int param1 : param1s) {
+        for (LatticeLayout::Order order : { LatticeLayout::ROW_MAJOR, LatticeLayout::TILED }) {
+            results.push_back(benchmark(param1, order, material, seconds));
+        }
+    }
+    return results;
+}
+
+void LatticeBenchmark::print(std::ostream &out, const std::vector<Result> &results) {
+    char line[160];
+    std::snprintf(line, sizeof(line), "%7s  %-9s  %6s  %9s  %14s  %14s  %7s",
+                  "param1", "order", "steps", "steps/s", "L1 misses/step", "LLC misses/step", "speedup");
+    out << line << std::endl;
+
+    for (const Result &result : results) {
+        const Result *rowMajor = nullptr;
+        for (const Result &other : results) {
+            if (other.param1 == result.param1 && other.order == LatticeLayout::ROW_MAJOR) rowMajor = &other;
+        }
+
+        char l1[32] = "n/a", llc[32] = "n/a", speedup[32] = "";
+        if (result.l1MissesPerStep >= 0) std::snprintf(l1, sizeof(l1), "%.0f", result.l1MissesPerStep);
+        if (result.cacheMissesPerStep >= 0) std::snprintf(llc, sizeof(llc), "%.0f", result.cacheMissesPerStep);
+        if (rowMajor && rowMajor != &result) {
+            std::snprintf(speedup, sizeof(speedup), "%.2fx", result.stepsPerSecond / rowMajor->stepsPerSecond);
+        }
+        std::snprintf(line, sizeof(line), "%7d  %-9s  %6d  %9.2f  %14s  %14s  %7s",
+                      result.param1, LatticeLayout::orderName(result.order), result.steps, result.stepsPerSecond,
+                      l1, llc, speedup);
+        out << line << std::endl;
+    }
+}
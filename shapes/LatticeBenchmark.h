@@ -0,0 +1,45 @@
+#ifndef LATTICEBENCHMARK_H
+#define LATTICEBENCHMARK_H
+
+#include <ostream>
+#include <vector>
+
+#include "LatticeLayout.h"
+
+/**
+ * @class LatticeBenchmark
+ *
+ * Times rk4 steps of a falling cube in each LatticeLayout order at several resolutions, and counts
+ * the cache misses they cause, so the orders can be compared on the machine at hand. Miss counts
+ * come from the kernel's hardware counters (perf_event_open) and are left out where those aren't
+ * available.
+ */
+class LatticeBenchmark {
+public:
+    struct Material {
+        float kElastic;
+        float dElastic;
+        float kCollision;
+        float dCollision;
+        float mass;
+        float gravity;
+    };
+
+    struct Result {
+        int param1;
+        LatticeLayout::Order order;
+        int steps;
+        double stepsPerSecond;
+        double l1MissesPerStep;    // L1 data cache read misses; -1 if they couldn't be counted
+        double cacheMissesPerStep; // last level cache misses; -1 if they couldn't be counted
+    };
+
+    // Steps each order at each resolution for at least seconds of wall time (and at least two
+    // steps), from the same starting lattice.
+    static std::vector<Result> run(const std::vector<int> &param1s, const Material &material, double seconds);
+
+    // One row per run, with the tiled order's speedup over row-major at the same resolution.
+    static void print(std::ostream &out, const std::vector<Result> &results);
+};
+
+#endif // LATTICEBENCHMARK_H
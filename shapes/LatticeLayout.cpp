@@ -0,0 +1,37 @@
+#include "LatticeLayout.h"
+
+#include <algorithm>
+#include <cctype>
+
+namespace {
+
+LatticeLayout::Order s_defaultOrder = LatticeLayout::ROW_MAJOR;
+
+}
+
+const int LatticeLayout::TILE;
+
+LatticeLayout::Order LatticeLayout::defaultOrder() {
+    return s_defaultOrder;
+}
+
+void LatticeLayout::setDefaultOrder(Order order) {
+    s_defaultOrder = order;
+}
+
+bool LatticeLayout::parseOrder(const std::string &name, Order &order) {
+    std::string lower = name;
+    std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return std::tolower(c); });
+    if (lower == "row-major") {
+        order = ROW_MAJOR;
+    } else if (lower == "tiled") {
+        order = TILED;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char *LatticeLayout::orderName(Order order) {
+    return order == TILED ? "tiled" : "row-major";
+}
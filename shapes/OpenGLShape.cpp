@@ -1,6 +1,7 @@
 #include "OpenGLShape.h"
 #include "gl/datatype/VAO.h"
 #include "gl/shaders/ShaderAttribLocations.h"
+#include "Profiler.h"
 
 #include <iostream>
 
@@ -20,6 +21,7 @@ OpenGLShape::~OpenGLShape()
 }
 
 void OpenGLShape::draw() {
+    PROFILE_SCOPE("OpenGLShape::draw");
     if (m_VAO) {
         m_VAO->bind();
         m_VAO->draw();
@@ -36,6 +38,7 @@ void OpenGLShape::drawPandL() {
 }
 
 void OpenGLShape::initializeOpenGLShapeProperties() {
+    PROFILE_SCOPE("initializeOpenGLShapeProperties");
     const int numFloatsPerVertex = 6;
     const int numVertices = m_vertexData.size() / numFloatsPerVertex;
 
@@ -10,6 +10,7 @@
 
 #include "gl/datatype/VBO.h"
 #include "gl/datatype/VBOAttribMarker.h"
+#include "LatticeLayout.h"
 
 /**
  *
@@ -27,6 +28,9 @@ namespace CS123 { namespace GL {
 class VAO;
 }}
 
+struct SimulationState;
+struct MeshGeometry;
+
 using namespace CS123::GL;
 
 class OpenGLShape
@@ -35,10 +39,31 @@ public:
     OpenGLShape();
     virtual ~OpenGLShape();
     void draw();
-    void drawPandL();
+    virtual void drawPandL();
     virtual void tick(float current) = 0;
     virtual void setGravity(float scale, glm::vec3 gravity) = 0;
 
+    /** Simulated seconds advanced by each tick(); 0 for shapes that don't simulate. */
+    virtual float getTimestep() { return 0.0f; }
+
+    /** Fills in everything but the shape type for a checkpoint; false for shapes that don't simulate. */
+    virtual bool getState(SimulationState &) { return false; }
+
+    /** Carries on from a checkpoint's lattice and constants; false if its lattice is a different size. */
+    virtual bool setState(const SimulationState &) { return false; }
+
+    /** Changes the material constants in place, keeping the lattice's state; false for shapes that don't simulate. */
+    virtual bool setMaterial(float, float, float, float, float) { return false; }
+
+    /** Moves the lattice to recorded positions (stored in order) without simulating; false if count doesn't match it. */
+    virtual bool setPositions(const glm::vec3 *, size_t, LatticeLayout::Order) { return false; }
+
+    /** Draws this mesh deformed by the lattice instead of the lattice's surface (null goes back to it); false if the shape can't. */
+    virtual bool setRenderMesh(std::shared_ptr<const MeshGeometry>) { return false; }
+
+    /** Smooths the drawn surface with this many subdivision levels (0 for none); false if the shape can't. */
+    virtual bool setSurfaceSmoothing(int) { return false; }
+
     /** Initialize the VBO with the given vertex data. */
     void setVertexData(GLfloat *data, int size, VBO::GEOMETRY_LAYOUT drawMode, int num_vertices);
 
@@ -0,0 +1,204 @@
+#include "ParameterSweep.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <thread>
+
+#include "JelloEnsemble.h"
+#include "JelloUtil.h"
+
+using namespace JelloUtil;
+
+namespace {
+
+// The cube counts as at rest once its kinetic energy is below this fraction of the energy scale.
+const double SETTLED_KINETIC = 1e-6;
+
+std::vector<float> samplePoints(const ParameterSweep::Range &range) {
+    std::vector<float> values;
+    int count = std::max(range.count, 1);
+    for (int i = 0; i < count; i++) {
+        values.push_back(count == 1 ? range.low : range.low + (range.high - range.low) * i / (count - 1));
+    }
+    return values;
+}
+
+// Scores one run as it goes, from the diagnostics and positions after each step.
+class Scorer {
+public:
+    Scorer(const ParameterSweep::Parameters &parameters, const ParameterSweep::Scenario &scenario) :
+        m_result{ parameters, 0, 0, 0, 0, false },
+        m_scale(energyScale(scenario.param1, parameters.kElastic, glm::vec3(0.f, -scenario.gravity, 0.f))),
+        m_dt(scenario.dt),
+        m_startEnergy(0),
+        m_lastMoving(-1)
+    {
+    }
+
+    // False once the run has blown up; it is stopped there.
+    bool step(const Diagnostics &diagnostics) {
+        if (m_result.blownUp) return false;
+        int step = m_result.steps++;
+
+        // Same test as EnergyMonitor: the lattice is damped, so its energy can't rise on its own.
+        double total = diagnostics.total();
+        if (step == 0) m_startEnergy = total;
+        m_result.energyDrift = std::max(m_result.energyDrift, (total - m_startEnergy) / m_scale);
+        if (!std::isfinite(total) || total > m_startEnergy + m_scale) {
+            m_result.blownUp = true;
+            return false;
+        }
+        if (diagnostics.kinetic >= SETTLED_KINETIC * m_scale) m_lastMoving = step;
+        return true;
+    }
+
+    void point(const glm::vec3 &point) {
+        m_result.maxPenetration = std::max<double>(m_result.maxPenetration, penetration(point));
+    }
+
+    ParameterSweep::Result finish() {
+        // Diagnostics describe the start of each step, so the cube was at rest from the step
+        // after the last one that was moving.
+        bool settled = !m_result.blownUp && m_lastMoving < m_result.steps - 1;
+        m_result.settleTime = settled ? (m_lastMoving + 1) * static_cast<double>(m_dt) : -1;
+        return m_result;
+    }
+
+private:
+    ParameterSweep::Result m_result;
+    double m_scale;
+    float m_dt;
+    double m_startEnergy;
+    int m_lastMoving;
+};
+
+}
+
+std::vector<ParameterSweep::Parameters> ParameterSweep::grid(const Range &kElastic, const Range &dElastic,
+                                                             const Range &kCollision, const Range &dCollision,
+                                                             const Range &mass) {
+    std::vector<Parameters> parameters;
+    for (float ke : samplePoints(kElastic)) {
+        for (float de : samplePoints(dElastic)) {
+            for (float kc : samplePoints(kCollision)) {
+                for (float dc : samplePoints(dCollision)) {
+                    for (float m : samplePoints(mass)) {
+                        parameters.push_back({ ke, de, kc, dc, m });
+                    }
+                }
+            }
+        }
+    }
+    return parameters;
+}
+
+std::vector<ParameterSweep::Parameters> ParameterSweep::sample(const Range &kElastic, const Range &dElastic,
+                                                               const Range &kCollision, const Range &dCollision,
+                                                               const Range &mass, int count, unsigned seed) {
+    std::mt19937 random(seed);
+    auto draw = [&random](const Range &range) {
+        return std::uniform_real_distribution<float>(range.low, range.high)(random);
+    };
+
+    std::vector<Parameters> parameters;
+    for (int i = 0; i < count; i++) {
+        Parameters p;
+        p.kElastic = draw(kElastic);
+        p.dElastic = draw(dElastic);
+        p.kCollision = draw(kCollision);
+        p.dCollision = draw(dCollision);
+        p.mass = draw(mass);
+        parameters.push_back(p);
+    }
+    return parameters;
+}
+
+void ParameterSweep::simulateEnsemble(const Parameters *parameters, int count, const Scenario &scenario,
+                                      Result *results) {
+    // Lanes past count repeat the last parameter set and are ignored.
+    JelloEnsemble ensemble(scenario.param1, scenario.gravity);
+    std::vector<Scorer> scorers;
+    for (int lane = 0; lane < JelloEnsemble::LANES; lane++) {
+        const Parameters &p = parameters[std::min(lane, count - 1)];
+        ensemble.setMaterial(lane, p.kElastic, p.dElastic, p.kCollision, p.dCollision, p.mass);
+        if (lane < count) scorers.emplace_back(p, scenario);
+    }
+
+    int steps = static_cast<int>(std::ceil(scenario.seconds / scenario.dt));
+    Diagnostics diagnostics[JelloEnsemble::LANES];
+    for (int step = 0; step < steps; step++) {
+        ensemble.step(scenario.dt, diagnostics);
+
+        // A cube that blew up stops being scored but keeps its lane; the others carry on.
+        bool running = false;
+        for (int lane = 0; lane < count; lane++) {
+            if (!scorers[lane].step(diagnostics[lane])) continue;
+            running = true;
+            for (int i = 0; i < ensemble.pointCount(); i++) {
+                scorers[lane].point(ensemble.point(lane, i));
+            }
+        }
+        if (!running) break;
+    }
+
+    for (int lane = 0; lane < count; lane++) {
+        results[lane] = scorers[lane].finish();
+    }
+}
+
+std::vector<ParameterSweep::Result> ParameterSweep::run(const std::vector<Parameters> &parameters,
+                                                        const Scenario &scenario, int threads) {
+    std::vector<Result> results(parameters.size());
+    if (threads <= 0) threads = std::max(1u, std::thread::hardware_concurrency());
+
+    // Runs are handed out eight at a time, one per lane of an ensemble. Workers take the next
+    // unclaimed batch until none are left, so slow (stiff) batches don't hold up a whole share of
+    // the sweep.
+    size_t batches = (parameters.size() + JelloEnsemble::LANES - 1) / JelloEnsemble::LANES;
+    threads = std::min<int>(threads, batches);
+    std::atomic<size_t> next(0);
+    std::atomic<size_t> finished(0);
+    std::mutex printMutex;
+    auto work = [&]() {
+        for (size_t batch = next++; batch < batches; batch = next++) {
+            size_t first = batch * JelloEnsemble::LANES;
+            int count = std::min<size_t>(JelloEnsemble::LANES, parameters.size() - first);
+            simulateEnsemble(&parameters[first], count, scenario, &results[first]);
+
+            std::lock_guard<std::mutex> lock(printMutex);
+            finished += count;
+            std::cout << "Runs " << finished << "/" << parameters.size() << " done" << std::endl;
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (int i = 0; i < threads; i++) {
+        workers.emplace_back(work);
+    }
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+    return results;
+}
+
+bool ParameterSweep::writeCSV(const std::string &path, const std::vector<Result> &results) {
+    std::ofstream out(path, std::ios::trunc);
+    if (!out) {
+        std::cerr << "Could not write sweep results: " << path << std::endl;
+        return false;
+    }
+
+    out << "kElastic,dElastic,kCollision,dCollision,mass,steps,settle_s,max_penetration,energy_drift,blown_up\n";
+    for (const Result &result : results) {
+        const Parameters &p = result.parameters;
+        out << p.kElastic << "," << p.dElastic << "," << p.kCollision << "," << p.dCollision << "," << p.mass << ","
+            << result.steps << "," << result.settleTime << "," << result.maxPenetration << ","
+            << result.energyDrift << "," << (result.blownUp ? 1 : 0) << "\n";
+    }
+    return static_cast<bool>(out);
+}
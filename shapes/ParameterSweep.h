@@ -0,0 +1,73 @@
+#ifndef PARAMETERSWEEP_H
+#define PARAMETERSWEEP_H
+
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+/**
+ * @class ParameterSweep
+ *
+ * Runs the jello simulation headlessly for many material parameter sets at once and scores each
+ * run, to tune the constants without dragging sliders one run at a time. Runs are simulated eight
+ * at a time in a JelloEnsemble, one per SIMD lane. Every batch is simulated start to finish by a
+ * single worker, in memory that worker allocated itself, so the workers share nothing but the
+ * read-only parameter list and their own result slots.
+ */
+class ParameterSweep {
+public:
+    // The material constants being tuned, named as in the settings.
+    struct Parameters {
+        float kElastic;
+        float dElastic;
+        float kCollision;
+        float dCollision;
+        float mass;
+    };
+
+    // What every run simulates: the cube is dropped from the origin at rest, as in the app.
+    struct Scenario {
+        int param1;        // lattice resolution
+        float gravity;
+        float dt;
+        float seconds;     // simulated time per run
+    };
+
+    struct Result {
+        Parameters parameters;
+        int steps;            // simulated before the run ended
+        double settleTime;    // seconds until the cube stayed at rest; -1 if it never did
+        double maxPenetration; // deepest any point went into a wall or the plane
+        double energyDrift;   // largest rise of the total energy above the start, in energy scales
+        bool blownUp;         // the run was stopped because it went unstable
+    };
+
+    // Inclusive range of one parameter, sampled at count points (1 means just low).
+    struct Range {
+        float low;
+        float high;
+        int count;
+    };
+
+    // Every combination of the ranges' sample points.
+    static std::vector<Parameters> grid(const Range &kElastic, const Range &dElastic, const Range &kCollision,
+                                        const Range &dCollision, const Range &mass);
+
+    // count parameter sets drawn uniformly from the ranges (their counts are ignored).
+    static std::vector<Parameters> sample(const Range &kElastic, const Range &dElastic, const Range &kCollision,
+                                          const Range &dCollision, const Range &mass, int count, unsigned seed);
+
+    // Simulates up to JelloEnsemble::LANES parameter sets together on the calling thread.
+    static void simulateEnsemble(const Parameters *parameters, int count, const Scenario &scenario,
+                                 Result *results);
+
+    // Simulates every parameter set on up to threads workers (0 means one per core). Results are
+    // in the same order as the parameters.
+    static std::vector<Result> run(const std::vector<Parameters> &parameters, const Scenario &scenario,
+                                   int threads = 0);
+
+    static bool writeCSV(const std::string &path, const std::vector<Result> &results);
+};
+
+#endif // PARAMETERSWEEP_H
@@ -2,6 +2,9 @@
 #include "gl/shaders/ShaderAttribLocations.h"
 #include <iostream>
 #include "Settings.h"
+#include "Checkpoint.h"
+#include "EnergyMonitor.h"
+#include "Profiler.h"
 #include <vector>
 #include <glm/glm.hpp>
 #include "GL/glew.h"
@@ -34,19 +37,76 @@ void SpringMassCube::setParam2(int inp) {
 }
 
 void SpringMassCube::setGravity(float scale, glm::vec3 new_direction) {
-    if (settings.fallCameraY) {
-        m_gravity = scale * new_direction;
-    } else {
-        m_gravity = scale * glm::vec3(0, -1, 0);
+    glm::vec3 gravity = scale * (settings.fallCameraY ? new_direction : glm::vec3(0, -1, 0));
+    if (gravity != m_gravity) {
+        m_gravity = gravity;
+        EnergyMonitor::rebaseline();
     }
 }
 
+bool SpringMassCube::setMaterial(float kElastic, float dElastic, float kCollision, float dCollision, float mass) {
+    if (kElastic == m_kElastic && dElastic == m_dElastic && kCollision == m_kCollision &&
+            dCollision == m_dCollision && mass == m_mass) {
+        return true;
+    }
+    m_kElastic = kElastic;
+    m_dElastic = dElastic;
+    m_kCollision = kCollision;
+    m_dCollision = dCollision;
+    m_mass = mass;
+    // The same lattice holds a different energy under the new constants.
+    EnergyMonitor::reset();
+    return true;
+}
+
+bool SpringMassCube::getState(SimulationState &state) {
+    state.param1 = m_param1;
+    state.kElastic = m_kElastic;
+    state.dElastic = m_dElastic;
+    state.kCollision = m_kCollision;
+    state.dCollision = m_dCollision;
+    state.mass = m_mass;
+    state.dt = m_dt;
+    state.gravity = m_gravity;
+    state.points = m_points.data();
+    state.velocity = m_velocity.data();
+    state.count = m_points.size();
+    state.latticeOrder = m_lattice.order();
+    return true;
+}
+
+bool SpringMassCube::setState(const SimulationState &state) {
+    if (state.param1 != m_param1 || state.count != m_points.size() || state.count != m_velocity.size()) {
+        return false;
+    }
+    m_kElastic = state.kElastic;
+    m_dElastic = state.dElastic;
+    m_kCollision = state.kCollision;
+    m_dCollision = state.dCollision;
+    m_mass = state.mass;
+    m_dt = state.dt;
+    m_gravity = state.gravity;
+    LatticeLayout::Order order = static_cast<LatticeLayout::Order>(state.latticeOrder);
+    m_lattice.reorder(state.velocity, LatticeLayout(m_lattice.dim(), order), m_velocity.data());
+    EnergyMonitor::reset();
+    return setPositions(state.points, state.count, order);
+}
+
+bool SpringMassCube::setPositions(const glm::vec3 *points, size_t count, LatticeLayout::Order order) {
+    if (count != m_points.size()) return false;
+    m_lattice.reorder(points, LatticeLayout(m_lattice.dim(), order), m_points.data());
+
+    m_pointsVBO->update(&m_points[0].x, m_points.size() * 3);
+    return true;
+}
+
 void SpringMassCube::generateVertexData(){
     int dim = m_param1 + 1;
     int num_control_points = pow(dim,3);
-    m_points.reserve(num_control_points);
-    m_velocity.reserve(num_control_points);
-    m_velocity.insert(m_velocity.begin(), num_control_points, glm::vec3(0.f, 0.f, 0.f));
+    EnergyMonitor::reset();
+    m_lattice = LatticeLayout(dim);
+    m_points.assign(num_control_points, glm::vec3(0.f, 0.f, 0.f));
+    m_velocity.assign(num_control_points, glm::vec3(0.f, 0.f, 0.f));
 
     //Initialize points
     float incr = 1.f / m_param1;
@@ -61,51 +121,65 @@ void SpringMassCube::generateVertexData(){
         for (int i = 0; i < dim; i++) {
             //j is the column (x)
             for (int j = 0; j < dim; j++) {
-                m_points.push_back(start + glm::vec3(j * incr, i * -incr, k * -incr));
+                m_points[m_lattice.index(i, j, k)] = start + glm::vec3(j * incr, i * -incr, k * -incr);
             }
         }
     }
+
+    buildConnectionBuffers();
 }
 
-std::vector<GLfloat> SpringMassCube::vecToFloats(const std::vector<glm::vec3> &points) {
-    std::vector<GLfloat> floats;
-    floats.resize(points.size() * 3);
-    for (int i = 0; i < points.size(); i++) {
-        floats[3*i] = points[i].x;
-        floats[3*i+1] = points[i].y;
-        floats[3*i+2] = points[i].z;
+void SpringMassCube::buildConnectionBuffers() {
+    m_structural_cnnctns.clear();
+    m_shear_cnnctns.clear();
+    m_bend_cnnctns.clear();
+    make_structural_connections();
+    make_shear_connections();
+    make_bend_connections();
+
+    std::vector<VBOAttribMarker> markers;
+    markers.push_back(VBOAttribMarker(ShaderAttrib::POSITION, 3, 0));
+    m_pointsVBO = std::make_unique<VBO>(&m_points[0].x, m_points.size() * 3, markers,
+                                        VBO::GEOMETRY_LAYOUT::LAYOUT_LINES,
+                                        VBO::BUFFER_USAGE::USAGE_DYNAMIC_DRAW);
+    m_cutoff = m_points.size();
+
+    const std::vector<GLuint> *connections[NUM_C_TYPES] = {
+        &m_structural_cnnctns, &m_shear_cnnctns, &m_bend_cnnctns
+    };
+    for (int type = 0; type < NUM_C_TYPES; type++) {
+        m_cnnctnIBOs[type] = std::make_unique<IBO>(connections[type]->data(), connections[type]->size());
+        m_cnnctnVAOs[type] = std::make_unique<VAO>(*m_pointsVBO, *m_cnnctnIBOs[type]);
     }
-    return floats;
 }
 
 void SpringMassCube::tick(float current) {
-    rk4(m_dt, m_param1, m_kElastic, m_dElastic, m_kCollision, m_dCollision,
-        m_mass, m_gravity, m_points, m_velocity);
-
-    switch (settings.cnnctnType) {
-        case C_STRUCT:
-            m_structural_cnnctns.clear();
-            make_structural_connections();
-            drawPointsAndLines(vecToFloats(m_points), m_structural_cnnctns);
-        break;
-        case C_SHEAR:
-            m_shear_cnnctns.clear();
-            make_shear_connections();
-            drawPointsAndLines(vecToFloats(m_points), m_shear_cnnctns);
-        break;
-        case C_BEND:
-            m_bend_cnnctns.clear();
-            make_bend_connections();
-            drawPointsAndLines(vecToFloats(m_points), m_bend_cnnctns);
-        break;
-        default:
-            std::cout << "you should never see this message" << std::endl;
-        break;
+    PROFILE_SCOPE("SpringMassCube::tick");
+    Diagnostics diagnostics;
+    rk4(m_dt, m_lattice, m_kElastic, m_dElastic, m_kCollision, m_dCollision,
+        m_mass, m_gravity, m_points, m_velocity, &diagnostics);
+    EnergyMonitor::record(diagnostics, energyScale(m_param1, m_kElastic, m_gravity));
+
+    // Only the positions move; the connection IBOs stay as they are.
+    m_pointsVBO->update(&m_points[0].x, m_points.size() * 3);
+}
+
+void SpringMassCube::drawPandL() {
+    if (settings.cnnctnType < 0 || settings.cnnctnType >= NUM_C_TYPES) {
+        std::cout << "you should never see this message" << std::endl;
+        return;
+    }
+    VAO *vao = m_cnnctnVAOs[settings.cnnctnType].get();
+    if (vao) {
+        vao->bind();
+        vao->drawPL(VBO::GEOMETRY_LAYOUT::LAYOUT_POINTS, VBO::GEOMETRY_LAYOUT::LAYOUT_LINES, m_cutoff);
+        vao->unbind();
     }
 }
 
-std::vector<int> SpringMassCube::get_neighbor(int j, int i, int k,
-                                              int offset_j, int offset_i, int offset_k) {
+void SpringMassCube::add_connection(std::vector<GLuint> &connections,
+                                    int j, int i, int k,
+                                    int offset_j, int offset_i, int offset_k) {
     int new_j = j + offset_j;
     int new_i = i + offset_i;
     int new_k = k + offset_k;
@@ -114,59 +188,21 @@ std::vector<int> SpringMassCube::get_neighbor(int j, int i, int k,
 //            && ((i==0) || (i==m_param1) || (j==0) || (j==m_param1) || (k==0) || (k==m_param1))
 //            && ((new_i==0) || (new_i==m_param1) || (new_j==0) || (new_j==m_param1) || (new_k==0) || (new_k==m_param1))
             ) {
-        std::vector<int> ret = {j, i, k, new_j, new_i, new_k};
-        return ret;
-    } else {
-        std::vector<int> ret = {-1};
-        return ret;
-    }
-}
-
-void SpringMassCube::add_to_connections(std::vector<GLfloat> &connections,
-                                        const std::vector<int> &indices) {
-    if (indices[0] != -1) {
-        int dim = m_param1 + 1;
-        // first push the original point
-        connections.push_back(
-                    m_points[to1D(
-                        indices[1], indices[0], indices[2],
-                        dim, dim)].x);
-        connections.push_back(
-                    m_points[to1D(
-                        indices[1], indices[0], indices[2],
-                        dim, dim)].y);
-        connections.push_back(
-                    m_points[to1D(
-                        indices[1], indices[0], indices[2],
-                        dim, dim)].z);
-        // then push the neighboring point
-        connections.push_back(
-                    m_points[to1D(
-                        indices[4], indices[3], indices[5],
-                        dim, dim)].x);
-        connections.push_back(
-                    m_points[to1D(
-                        indices[4], indices[3], indices[5],
-                        dim, dim)].y);
-        connections.push_back(
-                    m_points[to1D(
-                        indices[4], indices[3], indices[5],
-                        dim, dim)].z);
+        connections.push_back(m_lattice.index(i, j, k));
+        connections.push_back(m_lattice.index(new_i, new_j, new_k));
     }
 }
 
+// Each spring is symmetric, so only one of every +/- offset pair is added.
 void SpringMassCube::make_structural_connections() {
     // edge case: abs(pos(i)) == abs(pos(j)) == abs(pos(k)) == 0.5
     int dim = m_param1 + 1;
     for (int k = 0; k < dim; k++) {
         for (int i = 0; i < dim; i++) {
             for (int j = 0; j < dim; j++) {
-                add_to_connections(m_structural_cnnctns, get_neighbor(j, i, k, 1, 0, 0));
-                add_to_connections(m_structural_cnnctns, get_neighbor(j, i, k, 0, 1, 0));
-                add_to_connections(m_structural_cnnctns, get_neighbor(j, i, k, 0, 0, 1));
-                add_to_connections(m_structural_cnnctns, get_neighbor(j, i, k, -1, 0, 0));
-                add_to_connections(m_structural_cnnctns, get_neighbor(j, i, k, 0, -1, 0));
-                add_to_connections(m_structural_cnnctns, get_neighbor(j, i, k, 0, 0, -1));
+                add_connection(m_structural_cnnctns, j, i, k, 1, 0, 0);
+                add_connection(m_structural_cnnctns, j, i, k, 0, 1, 0);
+                add_connection(m_structural_cnnctns, j, i, k, 0, 0, 1);
             }
         }
     }
@@ -178,28 +214,17 @@ void SpringMassCube::make_shear_connections() {
     for (int k = 0; k < dim; k++) {
         for (int i = 0; i < dim; i++) {
             for (int j = 0; j < dim; j++) {
-                add_to_connections(m_shear_cnnctns, get_neighbor(j, i, k, 1, 1, 0));
-                add_to_connections(m_shear_cnnctns, get_neighbor(j, i, k, -1, 1, 0));
-                add_to_connections(m_shear_cnnctns, get_neighbor(j, i, k, -1, -1, 0));
-                add_to_connections(m_shear_cnnctns, get_neighbor(j, i, k, 1, -1, 0));
-                add_to_connections(m_shear_cnnctns, get_neighbor(j, i, k, 0, 1, 1));
-                add_to_connections(m_shear_cnnctns, get_neighbor(j, i, k, 0, -1, 1));
-
-                add_to_connections(m_shear_cnnctns, get_neighbor(j, i, k, 0, -1, -1));
-                add_to_connections(m_shear_cnnctns, get_neighbor(j, i, k, 0, 1, -1));
-                add_to_connections(m_shear_cnnctns, get_neighbor(j, i, k, 1, 0, 1));
-                add_to_connections(m_shear_cnnctns, get_neighbor(j, i, k, -1, 0, 1));
-                add_to_connections(m_shear_cnnctns, get_neighbor(j, i, k, -1, 0, -1));
-                add_to_connections(m_shear_cnnctns, get_neighbor(j, i, k, 1, 0, -1));
-
-                add_to_connections(m_shear_cnnctns, get_neighbor(j, i, k, 1, 1, 1));
-                add_to_connections(m_shear_cnnctns, get_neighbor(j, i, k, -1, 1, 1));
-                add_to_connections(m_shear_cnnctns, get_neighbor(j, i, k, -1, -1, 1));
-                add_to_connections(m_shear_cnnctns, get_neighbor(j, i, k, 1, -1, 1));
-                add_to_connections(m_shear_cnnctns, get_neighbor(j, i, k, 1, 1, -1));
-                add_to_connections(m_shear_cnnctns, get_neighbor(j, i, k, -1, 1, -1));
-                add_to_connections(m_shear_cnnctns, get_neighbor(j, i, k, -1, -1, -1));
-                add_to_connections(m_shear_cnnctns, get_neighbor(j, i, k, 1, -1, -1));
+                add_connection(m_shear_cnnctns, j, i, k, 1, 1, 0);
+                add_connection(m_shear_cnnctns, j, i, k, -1, 1, 0);
+                add_connection(m_shear_cnnctns, j, i, k, 0, 1, 1);
+                add_connection(m_shear_cnnctns, j, i, k, 0, -1, 1);
+                add_connection(m_shear_cnnctns, j, i, k, 1, 0, 1);
+                add_connection(m_shear_cnnctns, j, i, k, -1, 0, 1);
+
+                add_connection(m_shear_cnnctns, j, i, k, 1, 1, 1);
+                add_connection(m_shear_cnnctns, j, i, k, -1, 1, 1);
+                add_connection(m_shear_cnnctns, j, i, k, -1, -1, 1);
+                add_connection(m_shear_cnnctns, j, i, k, 1, -1, 1);
             }
         }
     }
@@ -211,12 +236,9 @@ void SpringMassCube::make_bend_connections() {
     for (int k = 0; k < dim; k++) {
         for (int i = 0; i < dim; i++) {
             for (int j = 0; j < dim; j++) {
-                add_to_connections(m_bend_cnnctns, get_neighbor(j, i, k, 2, 0, 0));
-                add_to_connections(m_bend_cnnctns, get_neighbor(j, i, k, 0, 2, 0));
-                add_to_connections(m_bend_cnnctns, get_neighbor(j, i, k, 0, 0, 2));
-                add_to_connections(m_bend_cnnctns, get_neighbor(j, i, k, -2, 0, 0));
-                add_to_connections(m_bend_cnnctns, get_neighbor(j, i, k, 0, -2, 0));
-                add_to_connections(m_bend_cnnctns, get_neighbor(j, i, k, 0, 0, -2));
+                add_connection(m_bend_cnnctns, j, i, k, 2, 0, 0);
+                add_connection(m_bend_cnnctns, j, i, k, 0, 2, 0);
+                add_connection(m_bend_cnnctns, j, i, k, 0, 0, 2);
             }
         }
     }
@@ -3,6 +3,10 @@
 
 #include "Shape.h"
 #include "JelloUtil.h"
+#include "Settings.h"
+
+#include "gl/datatype/IBO.h"
+#include "gl/datatype/VAO.h"
 
 using namespace JelloUtil;
 
@@ -12,30 +16,43 @@ public:
     SpringMassCube(int param1, float kElastic, float dElastic, float kCollision, float dCollision, float mass, float gravity);
     ~SpringMassCube();
     void tick(float current) override;
+    float getTimestep() override { return m_dt; }
+    bool getState(SimulationState &state) override;
+    bool setState(const SimulationState &state) override;
+    bool setPositions(const glm::vec3 *points, size_t count, LatticeLayout::Order order) override;
     void setGravity(float scale, glm::vec3 new_direction) override;
+    bool setMaterial(float kElastic, float dElastic, float kCollision, float dCollision, float mass) override;
+    void drawPandL() override;
 
     virtual void setParam1(int inp) override;
     virtual void setParam2(int inp) override;
 
 private:
     virtual void generateVertexData() override;
-    std::vector<int> get_neighbor(int j, int i, int k,
-                                  int offset_j, int offset_i, int offset_k);
-    void add_to_connections(std::vector<GLfloat> &connections,
-                            const std::vector<int> &indices);
-    std::vector<GLfloat> vecToFloats(const std::vector<glm::vec3> &points);
+    void add_connection(std::vector<GLuint> &connections,
+                        int j, int i, int k,
+                        int offset_j, int offset_i, int offset_k);
+    void buildConnectionBuffers();
 
     // format: x, y, z, x, y, z, ...
     std::vector<glm::vec3> m_points;
     std::vector<glm::vec3> m_velocity; //velocities for each point
-    // format: point 1 -- point 2, point 2 -- point 3, ...
-    std::vector<GLfloat> m_structural_cnnctns;
-    std::vector<GLfloat> m_shear_cnnctns;
-    std::vector<GLfloat> m_bend_cnnctns;
+    LatticeLayout m_lattice; //where each (row, column, depth) lives in m_points and m_velocity
+    // format: index of point 1, index of point 2, ... (GL_LINES pairs into m_points)
+    // The lattice topology never changes, so these are only built when param1 does.
+    std::vector<GLuint> m_structural_cnnctns;
+    std::vector<GLuint> m_shear_cnnctns;
+    std::vector<GLuint> m_bend_cnnctns;
     void make_structural_connections();
     void make_shear_connections();
     void make_bend_connections();
 
+    // Point positions are the only thing re-uploaded each tick; each connection type gets its own
+    // IBO + VAO over the same positions, so switching cnnctnType is just picking a different VAO.
+    std::unique_ptr<CS123::GL::VBO> m_pointsVBO;
+    std::unique_ptr<CS123::GL::IBO> m_cnnctnIBOs[NUM_C_TYPES];
+    std::unique_ptr<CS123::GL::VAO> m_cnnctnVAOs[NUM_C_TYPES];
+
     //All the related member variables to keep track of
     float m_kElastic; // Hook's elasticity coefficient for all springs except collision springs
     float m_dElastic; // Damping coefficient for all springs except collision springs
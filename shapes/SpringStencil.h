@@ -0,0 +1,67 @@
+#ifndef SPRINGSTENCIL_H
+#define SPRINGSTENCIL_H
+
+#include <cmath>
+
+namespace JelloUtil {
+
+enum SpringKind {
+    STRUCTURAL,
+    SHEAR,
+    BEND,
+    DIAGONAL,
+    NUM_SPRING_KINDS
+};
+
+// A spring from point (i, j, k) to (i + di, j + dj, k + dk); i is the row (y), j the column (x)
+// and k the depth (z).
+struct SpringOffset {
+    int di, dj, dk;
+    SpringKind kind;
+};
+
+// Every spring of a point, in the order computeAcceleration adds up their forces.
+constexpr SpringOffset SPRING_STENCIL[] = {
+    { 1, 0, 0, STRUCTURAL }, { -1, 0, 0, STRUCTURAL }, { 0, 1, 0, STRUCTURAL },
+    { 0, -1, 0, STRUCTURAL }, { 0, 0, 1, STRUCTURAL }, { 0, 0, -1, STRUCTURAL },
+
+    { 1, 1, 0, SHEAR }, { 1, -1, 0, SHEAR }, { -1, 1, 0, SHEAR }, { -1, -1, 0, SHEAR },
+    { 0, 1, 1, SHEAR }, { 0, -1, 1, SHEAR }, { 0, 1, -1, SHEAR }, { 0, -1, -1, SHEAR },
+    { 1, 0, 1, SHEAR }, { -1, 0, 1, SHEAR }, { 1, 0, -1, SHEAR }, { -1, 0, -1, SHEAR },
+
+    { 2, 0, 0, BEND }, { -2, 0, 0, BEND }, { 0, 2, 0, BEND },
+    { 0, -2, 0, BEND }, { 0, 0, 2, BEND }, { 0, 0, -2, BEND },
+
+    { 1, 1, 1, DIAGONAL }, { -1, 1, 1, DIAGONAL }, { -1, -1, 1, DIAGONAL }, { 1, -1, 1, DIAGONAL },
+    { 1, -1, -1, DIAGONAL }, { 1, 1, -1, DIAGONAL }, { -1, 1, -1, DIAGONAL }, { -1, -1, -1, DIAGONAL },
+};
+
+constexpr int STENCIL_SIZE = sizeof(SPRING_STENCIL) / sizeof(SPRING_STENCIL[0]);
+
+// No spring reaches further than this along any axis.
+constexpr int STENCIL_REACH = 2;
+
+// Rest length of each kind of spring in a dim x dim x dim lattice of a unit cube.
+inline void restLengths(int dim, float rest[NUM_SPRING_KINDS]) {
+    float rest_length = 1.f / (dim-1);
+    rest[STRUCTURAL] = rest_length;
+    rest[SHEAR] = rest_length * sqrt(2);
+    rest[BEND] = rest_length * 2;
+    rest[DIAGONAL] = rest_length * sqrt(3);
+}
+
+// Each spring's distance in the points array of a row-major Dim x Dim x Dim lattice.
+template <int Dim>
+struct RowMajorStencil {
+    int offset[STENCIL_SIZE];
+
+    constexpr RowMajorStencil() : offset() {
+        for (int s = 0; s < STENCIL_SIZE; s++) {
+            offset[s] = (SPRING_STENCIL[s].dk * Dim + SPRING_STENCIL[s].di) * Dim + SPRING_STENCIL[s].dj;
+        }
+    }
+};
+
+}
+
+#endif // SPRINGSTENCIL_H
@@ -0,0 +1,118 @@
+#include "SurfaceSubdivision.h"
+
+#include <algorithm>
+
+namespace {
+
+typedef std::vector<std::vector<double>> Matrix;
+
+// One round of curve subdivision with interpolated ends: the 1D part of Catmull-Clark, with the
+// boundary rules at either end.
+Matrix subdivide(const Matrix &points) {
+    size_t count = points.size(), inputs = points[0].size();
+    Matrix refined(2 * count - 1, std::vector<double>(inputs, 0.0));
+    for (size_t n = 0; n < inputs; n++) {
+        refined[0][n] = points[0][n];
+        refined[2 * count - 2][n] = points[count - 1][n];
+        for (size_t i = 1; i + 1 < count; i++) {
+            refined[2 * i][n] = (points[i - 1][n] + 6 * points[i][n] + points[i + 1][n]) / 8;
+        }
+        for (size_t i = 0; i + 1 < count; i++) {
+            refined[2 * i + 1][n] = (points[i][n] + points[i + 1][n]) / 2;
+        }
+    }
+    return refined;
+}
+
+// Moves every point onto the limit curve.
+Matrix limit(const Matrix &points) {
+    Matrix projected = points;
+    size_t count = points.size();
+    for (size_t n = 0; n < points[0].size(); n++) {
+        for (size_t i = 1; i + 1 < count; i++) {
+            projected[i][n] = (points[i - 1][n] + 4 * points[i][n] + points[i + 1][n]) / 6;
+        }
+    }
+    return projected;
+}
+
+// out = the sum of weights[w] times row first + w, over rows of length floats.
+void combineRows(const float *weights, int width, const float *rows, size_t length, float *out) {
+    for (size_t e = 0; e < length; e++) {
+        out[e] = 0.f;
+    }
+    for (int w = 0; w < width; w++) {
+        float weight = weights[w];
+        const float *row = rows + w * length;
+        for (size_t e = 0; e < length; e++) {
+            out[e] += weight * row[e];
+        }
+    }
+}
+
+}
+
+SurfaceSubdivision::SurfaceSubdivision(int dim, int levels) :
+    m_dim(dim),
+    m_levels(std::min(std::max(levels, 1), static_cast<int>(MAX_LEVELS))),
+    m_refinedDim((dim - 1) * (1 << m_levels) + 1),
+    m_width(0)
+{
+    // Row n of the matrix is refined point n in terms of the input points.
+    Matrix matrix(dim, std::vector<double>(dim, 0.0));
+    for (int i = 0; i < dim; i++) {
+        matrix[i][i] = 1.0;
+    }
+    for (int level = 0; level < m_levels; level++) {
+        matrix = subdivide(matrix);
+    }
+    matrix = limit(matrix);
+
+    // Only a few neighbouring inputs contribute to each point; keep that band, all the same width.
+    m_first.resize(m_refinedDim);
+    std::vector<int> last(m_refinedDim);
+    for (int n = 0; n < m_refinedDim; n++) {
+        m_first[n] = dim - 1;
+        last[n] = 0;
+        for (int i = 0; i < dim; i++) {
+            if (matrix[n][i] == 0.0) continue;
+            m_first[n] = std::min(m_first[n], i);
+            last[n] = std::max(last[n], i);
+        }
+        m_width = std::max(m_width, last[n] - m_first[n] + 1);
+    }
+    m_weights.assign(m_refinedDim * m_width, 0.f);
+    for (int n = 0; n < m_refinedDim; n++) {
+        m_first[n] = std::min(m_first[n], dim - m_width);
+        for (int w = 0; w < m_width; w++) {
+            m_weights[n * m_width + w] = static_cast<float>(matrix[n][m_first[n] + w]);
+        }
+    }
+
+    m_refinedColumns.resize(m_refinedDim * dim);
+    m_refinedRows.resize(dim * m_refinedDim);
+}
+
+void SurfaceSubdivision::refine(const glm::vec3 *columns, glm::vec3 *refined) {
+    // Along the rows: each refined column is a blend of whole input columns.
+    const float *input = &columns[0].x;
+    size_t columnLength = 3 * m_dim;
+    for (int n = 0; n < m_refinedDim; n++) {
+        combineRows(&m_weights[n * m_width], m_width, input + m_first[n] * columnLength, columnLength,
+                    &m_refinedColumns[n * m_dim].x);
+    }
+
+    for (int c = 0; c < m_refinedDim; c++) {
+        for (int r = 0; r < m_dim; r++) {
+            m_refinedRows[r * m_refinedDim + c] = m_refinedColumns[c * m_dim + r];
+        }
+    }
+
+    // Along the columns: each refined row is a blend of whole rows from the first pass.
+    const float *rows = &m_refinedRows[0].x;
+    size_t rowLength = 3 * m_refinedDim;
+    for (int n = 0; n < m_refinedDim; n++) {
+        combineRows(&m_weights[n * m_width], m_width, rows + m_first[n] * rowLength, rowLength,
+                    &refined[n * m_refinedDim].x);
+    }
+}
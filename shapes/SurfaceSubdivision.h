@@ -0,0 +1,52 @@
+#ifndef SURFACESUBDIVISION_H
+#define SURFACESUBDIVISION_H
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+/**
+ * @class SurfaceSubdivision
+ *
+ * Smooths one face grid of the lattice for drawing: levels rounds of Catmull-Clark subdivision,
+ * projected onto the limit surface, so every face becomes a bicubic B-spline patch with its
+ * border treated as a crease. The border of a face only depends on the lattice points along it,
+ * which the neighbouring face shares, so the refined faces still meet at the cube's edges.
+ *
+ * On a regular grid Catmull-Clark is the same 1D subdivision applied along the rows and then
+ * the columns, so all of it is precomputed as one table of weights per refined row/column. Each
+ * refined row is then a weighted sum of a few whole input rows, which the compiler vectorizes.
+ */
+class SurfaceSubdivision {
+public:
+    static const int MAX_LEVELS = 4;
+
+    // For dim x dim face grids; levels is clamped to [1, MAX_LEVELS].
+    SurfaceSubdivision(int dim, int levels);
+
+    int dim() const { return m_dim; }
+    int levels() const { return m_levels; }
+
+    // Edge length of the refined grids: (dim - 1) * 2^levels + 1.
+    int refinedDim() const { return m_refinedDim; }
+
+    // Refines a face grid stored column by column (point (r, c) at columns[c * dim + r]) into
+    // refined, stored row by row (point (r, c) at refined[r * refinedDim + c]).
+    void refine(const glm::vec3 *columns, glm::vec3 *refined);
+
+private:
+    int m_dim;
+    int m_levels;
+    int m_refinedDim;
+
+    // Refined point n is the sum of m_weights[n * m_width + w] times input point m_first[n] + w.
+    int m_width;
+    std::vector<int> m_first;
+    std::vector<float> m_weights;
+
+    // Between the two passes: the grid refined along its columns, then transposed.
+    std::vector<glm::vec3> m_refinedColumns;
+    std::vector<glm::vec3> m_refinedRows;
+};
+
+#endif // SURFACESUBDIVISION_H
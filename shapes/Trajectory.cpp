@@ -0,0 +1,284 @@
+#include "Trajectory.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#include <QByteArray>
+
+#include "MappedFile.h"
+#include "Profiler.h"
+
+namespace {
+
+const uint32_t TRAJECTORY_MAGIC = 0x4A52544A; // "JTRJ"
+const uint32_t TRAJECTORY_VERSION = 2;
+
+// Precedes every frame's compressed payload.
+struct BlockHeader {
+    uint32_t keyframe;
+    uint32_t size;
+};
+
+const float QUANTIZATION_STEPS = 65535.0f;
+
+// Maps small negative deltas to small positive numbers, so their high bytes are zero.
+uint16_t zigzag(uint16_t delta) {
+    int16_t value = static_cast<int16_t>(delta);
+    return static_cast<uint16_t>((value << 1) ^ (value >> 15));
+}
+
+uint16_t unzigzag(uint16_t value) {
+    return static_cast<uint16_t>((value >> 1) ^ -(value & 1));
+}
+
+// Low bytes of every value, then the high bytes. The high bytes of deltas are nearly all zero, and
+// grouping them gives the compressor long runs.
+void shuffleBytes(const std::vector<uint16_t> &values, std::vector<unsigned char> &bytes) {
+    size_t n = values.size();
+    bytes.resize(2 * n);
+    for (size_t i = 0; i < n; i++) {
+        bytes[i] = static_cast<unsigned char>(values[i] & 0xFF);
+        bytes[n + i] = static_cast<unsigned char>(values[i] >> 8);
+    }
+}
+
+void unshuffleBytes(const unsigned char *bytes, std::vector<uint16_t> &values) {
+    size_t n = values.size();
+    for (size_t i = 0; i < n; i++) {
+        values[i] = static_cast<uint16_t>(bytes[i] | (bytes[n + i] << 8));
+    }
+}
+
+}
+
+TrajectoryWriter::TrajectoryWriter(const std::string &path, int shapeType, int param1, size_t count, int latticeOrder,
+                                   glm::vec3 low, glm::vec3 high, int keyframeInterval, size_t queueCapacity) :
+    m_header(),
+    m_queueCapacity(std::max<size_t>(queueCapacity, 1)),
+    m_out(path, std::ios::binary | std::ios::trunc),
+    m_closing(false),
+    m_failed(false),
+    m_framesWritten(0)
+{
+    m_header.magic = TRAJECTORY_MAGIC;
+    m_header.version = TRAJECTORY_VERSION;
+    m_header.shapeType = shapeType;
+    m_header.param1 = param1;
+    m_header.count = static_cast<uint32_t>(count);
+    m_header.latticeOrder = static_cast<uint32_t>(latticeOrder);
+    m_header.keyframeInterval = static_cast<uint32_t>(std::max(keyframeInterval, 1));
+    for (int axis = 0; axis < 3; axis++) {
+        m_header.low[axis] = low[axis];
+        m_header.high[axis] = high[axis];
+    }
+
+    if (!m_out) {
+        std::cerr << "Could not write trajectory: " << path << std::endl;
+        m_failed = true;
+        return;
+    }
+    m_out.write(reinterpret_cast<const char*>(&m_header), sizeof(m_header));
+    m_thread = std::thread(&TrajectoryWriter::run, this);
+}
+
+TrajectoryWriter::~TrajectoryWriter()
+{
+    finish();
+}
+
+bool TrajectoryWriter::isValid() const {
+    return m_thread.joinable() || m_framesWritten > 0;
+}
+
+void TrajectoryWriter::push(const glm::vec3 *points) {
+    if (!m_thread.joinable()) return;
+
+    // Stored axis by axis: all the x values, then y, then z, which compresses better than
+    // interleaved triples.
+    size_t count = m_header.count;
+    std::vector<uint16_t> frame(3 * count);
+    for (int axis = 0; axis < 3; axis++) {
+        float low = m_header.low[axis];
+        float scale = QUANTIZATION_STEPS / (m_header.high[axis] - low);
+        uint16_t *values = frame.data() + axis * count;
+        for (size_t i = 0; i < count; i++) {
+            float q = (points[i][axis] - low) * scale + 0.5f;
+            values[i] = static_cast<uint16_t>(std::min(std::max(q, 0.0f), QUANTIZATION_STEPS));
+        }
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_notFull.wait(lock, [this] { return m_queue.size() < m_queueCapacity; });
+    m_queue.push_back(std::move(frame));
+    m_notEmpty.notify_one();
+}
+
+bool TrajectoryWriter::finish() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_closing = true;
+    }
+    m_notEmpty.notify_one();
+    if (m_thread.joinable()) m_thread.join();
+    if (m_out.is_open()) {
+        m_out.close();
+        if (!m_out) m_failed = true;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return !m_failed;
+}
+
+int TrajectoryWriter::framesWritten() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_framesWritten;
+}
+
+void TrajectoryWriter::run() {
+    int index = 0;
+    while (true) {
+        std::vector<uint16_t> frame;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_notEmpty.wait(lock, [this] { return !m_queue.empty() || m_closing; });
+            if (m_queue.empty()) return;
+            frame = std::move(m_queue.front());
+            m_queue.pop_front();
+        }
+        m_notFull.notify_one();
+
+        bool written = write(frame, index++);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (written) {
+            m_framesWritten++;
+        } else {
+            m_failed = true;
+        }
+    }
+}
+
+bool TrajectoryWriter::write(const std::vector<uint16_t> &frame, int index) {
+    PROFILE_SCOPE("encode trajectory frame");
+    bool keyframe = index % m_header.keyframeInterval == 0;
+
+    std::vector<uint16_t> encoded(frame.size());
+    for (size_t i = 0; i < frame.size(); i++) {
+        encoded[i] = keyframe ? frame[i] : zigzag(static_cast<uint16_t>(frame[i] - m_previous[i]));
+    }
+    m_previous = frame;
+
+    std::vector<unsigned char> bytes;
+    shuffleBytes(encoded, bytes);
+    QByteArray compressed = qCompress(bytes.data(), static_cast<int>(bytes.size()));
+
+    BlockHeader block = { keyframe ? 1u : 0u, static_cast<uint32_t>(compressed.size()) };
+    m_out.write(reinterpret_cast<const char*>(&block), sizeof(block));
+    m_out.write(compressed.constData(), compressed.size());
+    // Flushed per frame, so everything recorded so far is playable even if the app dies.
+    m_out.flush();
+    return static_cast<bool>(m_out);
+}
+
+TrajectoryReader::TrajectoryReader(const std::string &path) :
+    m_file(std::make_unique<MappedFile>(path)),
+    m_header(),
+    m_currentFrame(-1)
+{
+    if (!m_file->isValid() || m_file->size() < sizeof(TrajectoryHeader)) {
+        std::cerr << "Not a trajectory: " << path << std::endl;
+        return;
+    }
+    std::memcpy(&m_header, m_file->data(), sizeof(m_header));
+    if (m_header.magic != TRAJECTORY_MAGIC) {
+        std::cerr << "Not a trajectory: " << path << std::endl;
+        return;
+    }
+    if (m_header.version != TRAJECTORY_VERSION) {
+        std::cerr << "Trajectory " << path << " is version " << m_header.version << "; this build reads version "
+                  << TRAJECTORY_VERSION << std::endl;
+        return;
+    }
+    if (m_header.latticeOrder > 1) {
+        std::cerr << "Trajectory " << path << " is truncated or corrupt" << std::endl;
+        return;
+    }
+
+    // Index the blocks; a partial block at the end is a recording that was cut off, and is ignored.
+    size_t offset = sizeof(TrajectoryHeader);
+    while (offset + sizeof(BlockHeader) <= m_file->size()) {
+        BlockHeader block;
+        std::memcpy(&block, m_file->data() + offset, sizeof(block));
+        offset += sizeof(block);
+        if (offset + block.size > m_file->size()) break;
+        if (m_blocks.empty() && !block.keyframe) break;
+
+        m_blocks.push_back({ offset, block.size, block.keyframe != 0 });
+        offset += block.size;
+    }
+    if (m_blocks.empty()) {
+        std::cerr << "Trajectory " << path << " has no complete frames" << std::endl;
+    }
+}
+
+TrajectoryReader::~TrajectoryReader()
+{
+}
+
+bool TrajectoryReader::isValid() const {
+    return !m_blocks.empty();
+}
+
+bool TrajectoryReader::read(int frame, std::vector<glm::vec3> &points) {
+    PROFILE_SCOPE("decode trajectory frame");
+    if (frame < 0 || frame >= frameCount()) return false;
+
+    if (frame != m_currentFrame) {
+        // Carry on from the current frame if it is on the way, else start over at the keyframe.
+        int start = frame;
+        while (!m_blocks[start].keyframe) start--;
+        if (m_currentFrame >= start && m_currentFrame < frame) start = m_currentFrame + 1;
+
+        for (int i = start; i <= frame; i++) {
+            if (!decode(i)) {
+                m_currentFrame = -1;
+                return false;
+            }
+        }
+    }
+
+    size_t count = m_header.count;
+    points.resize(count);
+    for (int axis = 0; axis < 3; axis++) {
+        float low = m_header.low[axis];
+        float step = (m_header.high[axis] - low) / QUANTIZATION_STEPS;
+        const uint16_t *values = m_current.data() + axis * count;
+        for (size_t i = 0; i < count; i++) {
+            points[i][axis] = low + values[i] * step;
+        }
+    }
+    return true;
+}
+
+bool TrajectoryReader::decode(int frame) {
+    const Block &block = m_blocks[frame];
+    QByteArray bytes = qUncompress(m_file->data() + block.offset, static_cast<int>(block.size));
+    size_t valueCount = 3 * static_cast<size_t>(m_header.count);
+    if (static_cast<size_t>(bytes.size()) != 2 * valueCount) {
+        std::cerr << "Trajectory frame " << frame << " is corrupt" << std::endl;
+        return false;
+    }
+
+    std::vector<uint16_t> values(valueCount);
+    unshuffleBytes(reinterpret_cast<const unsigned char*>(bytes.constData()), values);
+    if (block.keyframe) {
+        m_current = std::move(values);
+    } else {
+        for (size_t i = 0; i < valueCount; i++) {
+            m_current[i] = static_cast<uint16_t>(m_current[i] + unzigzag(values[i]));
+        }
+    }
+    m_currentFrame = frame;
+    return true;
+}
@@ -0,0 +1,126 @@
+#ifndef TRAJECTORY_H
+#define TRAJECTORY_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+class MappedFile;
+
+/**
+ * A recorded trajectory is a header followed by one compressed block per recorded frame. Each
+ * position is quantized to 16 bits per axis inside the header's bounds. Keyframe blocks hold the
+ * quantized values as they are; the others hold the difference from the previous frame, which is
+ * small and compresses well. Every keyframeInterval-th frame is a keyframe, so seeking only ever
+ * decodes from the nearest keyframe at or before the target.
+ *
+ * Blocks carry their own sizes and there is no index at the end, so a recording that was cut off
+ * (e.g. by a crash) still plays up to its last complete frame.
+ */
+struct TrajectoryHeader {
+    uint32_t magic;             // "JTRJ"
+    uint32_t version;
+    int32_t shapeType;
+    int32_t param1;
+    uint32_t count;             // points per frame
+    uint32_t keyframeInterval;
+    uint32_t latticeOrder;      // LatticeLayout::Order the points are stored in
+    float low[3];               // quantization bounds; positions outside are clamped
+    float high[3];
+};
+
+/**
+ * @class TrajectoryWriter
+ *
+ * Records frames on its own thread: push() only quantizes the positions and queues them, and the
+ * delta encoding, compression and file writes happen on the writer thread.
+ */
+class TrajectoryWriter {
+public:
+    TrajectoryWriter(const std::string &path, int shapeType, int param1, size_t count, int latticeOrder,
+                     glm::vec3 low, glm::vec3 high, int keyframeInterval = 32, size_t queueCapacity = 8);
+    TrajectoryWriter(const TrajectoryWriter&) = delete;
+    TrajectoryWriter& operator=(const TrajectoryWriter&) = delete;
+    ~TrajectoryWriter();
+
+    // False if the file couldn't be created.
+    bool isValid() const;
+
+    // Queues one frame of count positions. Blocks while the queue is full.
+    void push(const glm::vec3 *points);
+
+    // Writes everything still queued and closes the file. Returns false if any write failed.
+    bool finish();
+
+    int framesWritten() const;
+
+    // Points per frame.
+    size_t count() const { return m_header.count; }
+
+private:
+    void run();
+    bool write(const std::vector<uint16_t> &frame, int index);
+
+    TrajectoryHeader m_header;
+    size_t m_queueCapacity;
+    std::ofstream m_out;
+    std::vector<uint16_t> m_previous;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_notEmpty;
+    std::condition_variable m_notFull;
+    std::deque<std::vector<uint16_t>> m_queue;
+    bool m_closing;
+    bool m_failed;
+    int m_framesWritten;
+    std::thread m_thread;
+};
+
+/**
+ * @class TrajectoryReader
+ *
+ * Plays a recording back. The file is mapped and only the block headers are read on open, so
+ * opening is cheap however long the recording is.
+ */
+class TrajectoryReader {
+public:
+    explicit TrajectoryReader(const std::string &path);
+    TrajectoryReader(const TrajectoryReader&) = delete;
+    TrajectoryReader& operator=(const TrajectoryReader&) = delete;
+    ~TrajectoryReader();
+
+    // False (with the reason printed) if the file isn't a trajectory or has no complete frames.
+    bool isValid() const;
+
+    const TrajectoryHeader &header() const { return m_header; }
+    int frameCount() const { return static_cast<int>(m_blocks.size()); }
+
+    // Decodes a frame into points (resized to the header's count). Reading the frame after the
+    // last one read costs one delta; any other frame is decoded from the keyframe before it.
+    bool read(int frame, std::vector<glm::vec3> &points);
+
+private:
+    struct Block {
+        size_t offset;          // of the compressed payload
+        uint32_t size;
+        bool keyframe;
+    };
+
+    bool decode(int frame);
+
+    std::unique_ptr<MappedFile> m_file;
+    TrajectoryHeader m_header;
+    std::vector<Block> m_blocks;
+    std::vector<uint16_t> m_current; // quantized values of m_currentFrame
+    int m_currentFrame;
+};
+
+#endif // TRAJECTORY_H
@@ -58,6 +58,8 @@ void Settings::loadSettingsOrDefaults() {
     useLighting = s.value("useLighting", true).toBool();
     drawWireframe = s.value("drawWireframe", true).toBool();
     drawNormals = s.value("drawNormals", false).toBool();
+    renderDetail = s.value("renderDetail", 0).toInt();
+    surfaceSmoothing = s.value("surfaceSmoothing", 0).toInt();
 
     // Simulation
     simType = s.value("simType", SIM_JELLO_SIM).toInt();
@@ -67,6 +69,8 @@ void Settings::loadSettingsOrDefaults() {
 
     // Jello Colors
     jelloColor = s.value("jelloColor", JC_White).toInt();
+    useChromaticRefraction = s.value("useChromaticRefraction", true).toBool();
+    skybox = s.value("skybox", "bridge-waterfall").toString().toStdString();
 
     // plane on and off
     usePlane = s.value("usePlane", false).toBool();
@@ -133,6 +137,8 @@ void Settings::saveSettings() {
     s.setValue("useLighting", useLighting);
     s.setValue("drawWireframe", drawWireframe);
     s.setValue("drawNormals", drawNormals);
+    s.setValue("renderDetail", renderDetail);
+    s.setValue("surfaceSmoothing", surfaceSmoothing);
 
     // Simulation
     s.setValue("simType", simType);
@@ -140,6 +146,10 @@ void Settings::saveSettings() {
     // Connections
     s.setValue("cnnctnType", cnnctnType);
 
+    // Jello Colors
+    s.setValue("useChromaticRefraction", useChromaticRefraction);
+    s.setValue("skybox", QString::fromStdString(skybox));
+
     // Camtrans
     s.setValue("useOrbitCamera", useOrbitCamera);
     s.setValue("cameraFov", cameraFov);
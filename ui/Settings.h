@@ -8,6 +8,8 @@
 #ifndef SETTINGS_H
 #define SETTINGS_H
 
+#include <string>
+
 #include <QObject>
 #include "RGBA.h"
 
@@ -111,6 +113,8 @@ struct Settings {
     float gravity;
 
     int jelloColor;
+    bool useChromaticRefraction; // Refract each color channel separately (3 cubemap lookups)
+    std::string skybox;          // Folder in textures/ that the glass reflects
     bool usePlane;
     bool fallCameraY;
 
@@ -137,6 +141,9 @@ struct Settings {
     bool useLighting;           // Enable default lighting
     bool drawWireframe;         // Draw wireframe only
     bool drawNormals;           // Turn normals on and off
+    int renderDetail;           // Quads per cube edge drawn over the lattice; 0 draws the lattice itself
+    std::string renderMesh;     // OBJ drawn over the lattice instead (from the command line, not saved)
+    int surfaceSmoothing;       // Subdivision levels applied to the lattice's surface when drawing it; 0 for none
 
     // Simulation
     int simType;
@@ -4,6 +4,8 @@
 #include <QMouseEvent>
 #include <QMessageBox>
 #include <QApplication>
+#include <QDir>
+#include <QStandardPaths>
 
 #include "RGBA.h"
 #include "CamtransCamera.h"
@@ -12,19 +14,29 @@
 #include "Settings.h"
 #include "ShapesScene.h"
 
+#include <cstring>
 #include <iostream>
 #include "gl/GLDebug.h"
+#include "gl/shaders/ProgramBinaryCache.h"
+#include "gl/shaders/Shader.h"
 #include "CS123XmlSceneParser.h"
+#include "FrameWriter.h"
+#include "PerformanceMonitor.h"
+#include "Profiler.h"
+#include "gl/datatype/FBO.h"
 
 SupportCanvas3D::SupportCanvas3D(QGLFormat format, QWidget *parent) : QGLWidget(format, parent),
     m_isDragging(false),
     m_settingsDirty(true),
+    m_settingsPending(false),
     m_defaultPerspectiveCamera(new CamtransCamera()),
     m_defaultOrbitingCamera(new OrbitingCamera()),
     m_currentScene(nullptr),
     m_timer(this),
     m_fps(48.0f),
-    m_increment(0)
+    m_increment(0),
+    m_startTime(std::chrono::steady_clock::now()),
+    m_timeToFirstFrame(-1.0f)
 {
     // Set up 60 FPS draw loop.
     connect(&m_timer, SIGNAL(timeout()), this, SLOT(tick()));
@@ -34,6 +46,7 @@ SupportCanvas3D::SupportCanvas3D(QGLFormat format, QWidget *parent) : QGLWidget(
 
 SupportCanvas3D::~SupportCanvas3D()
 {
+    CS123::GL::Shader::setProgramBinaryCache(nullptr);
 }
 
 Camera *SupportCanvas3D::getCamera() {
@@ -68,12 +81,15 @@ void SupportCanvas3D::initializeGL() {
     m_oldRotN = settings.cameraRotN;
 
     initializeGlew();
+    initializeShaderCache();
+    m_readback = std::make_unique<CS123::GL::PixelReadback>();
 
     initializeOpenGLSettings();
-    initializeScenes();
+
+    // Only the scene the settings ask for is built; the other is built if and when it's needed.
     setSceneFromSettings();
 
-    settingsChanged();
+    applySettings();
 
 }
 
@@ -87,6 +103,18 @@ void SupportCanvas3D::initializeGlew() {
     }
 }
 
+void SupportCanvas3D::initializeShaderCache() {
+    // Linked programs are cached between runs, so only the first launch (or the first after a
+    // shader edit or driver update) pays for compiling them.
+    QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/shaders";
+    if (!QDir().mkpath(cacheDir)) {
+        std::cerr << "Could not create shader cache directory: " << cacheDir.toStdString() << std::endl;
+        return;
+    }
+    m_programBinaryCache = std::make_unique<CS123::GL::ProgramBinaryCache>(cacheDir.toStdString());
+    CS123::GL::Shader::setProgramBinaryCache(m_programBinaryCache.get());
+}
+
 void SupportCanvas3D::initializeOpenGLSettings() {
     // Enable depth testing, so that objects are occluded based on depth instead of drawing order.
     glEnable(GL_DEPTH_TEST);
@@ -108,12 +136,12 @@ void SupportCanvas3D::initializeOpenGLSettings() {
     getOrbitingCamera()->updateMatrices();
 }
 
-void SupportCanvas3D::initializeScenes() {
-    m_sceneviewScene = std::make_unique<SceneviewScene>();
-    m_shapesScene = std::make_unique<ShapesScene>(width(), height());
-}
-
 void SupportCanvas3D::paintGL() {
+    PROFILE_SCOPE("paintGL");
+    PerformanceMonitor::recordFrame();
+    if (m_settingsPending) {
+        applySettings();
+    }
     if (m_settingsDirty) {
         setSceneFromSettings();
     }
@@ -123,17 +151,41 @@ void SupportCanvas3D::paintGL() {
     getCamera()->setAspectRatio(static_cast<float>(width()) / static_cast<float>(height()));
     m_currentScene->render(this);
 
+    if (m_frameCapture) {
+        // Hand over whatever earlier reads have finished, then queue this frame. If the GPU is so
+        // far behind that the whole ring is still in flight, this frame is skipped.
+        collectCapturedFrames(false);
+        m_readback->request(width() * ratio, height() * ratio);
+    }
 
+    if (m_timeToFirstFrame < 0) {
+        recordFirstFrame();
+    }
+}
+
+void SupportCanvas3D::recordFirstFrame() {
+    // Wait for the GPU once so the number includes the actual drawing, not just its submission.
+    glFinish();
+    std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - m_startTime;
+    m_timeToFirstFrame = elapsed.count();
+    std::cout << "Time to first frame: " << m_timeToFirstFrame << " ms" << std::endl;
 }
 
 void SupportCanvas3D::settingsChanged() {
+    // A dragged slider reports every value it passes through, so changes are only noted here and
+    // applied once, before the next tick or frame.
+    m_settingsPending = true;
+    update(); /* repaint the scene */
+}
+
+void SupportCanvas3D::applySettings() {
+    m_settingsPending = false;
     m_settingsDirty = true;
     if (m_currentScene != nullptr) {
         // Just calling this function so that the scene is always updated.
         setSceneFromSettings();
         m_currentScene->settingsChanged();
     }
-    update(); /* repaint the scene */
 }
 
 void SupportCanvas3D::setSceneFromSettings() {
@@ -155,24 +207,197 @@ void SupportCanvas3D::loadSceneviewSceneFromParser(CS123XmlSceneParser &parser)
 }
 
 void SupportCanvas3D::setSceneToSceneview() {
-    assert(m_sceneviewScene.get());
+    if (!m_sceneviewScene) {
+        m_sceneviewScene = std::make_unique<SceneviewScene>();
+    }
     m_currentScene = m_sceneviewScene.get();
 }
 
 void SupportCanvas3D::setSceneToShapes() {
-    assert(m_shapesScene.get());
+    if (!m_shapesScene) {
+        m_shapesScene = std::make_unique<ShapesScene>(width(), height());
+    }
     m_currentScene = m_shapesScene.get();
 }
 
 void SupportCanvas3D::copyPixels(int width, int height, RGBA *data) {
-    glReadPixels(0, 0, width, height, GL_BGRA, GL_UNSIGNED_BYTE, data);
+    makeCurrent();
+
+    // Reads still in flight for a capture go out first, so this one is the only one left. If one
+    // of them timed out it is still queued, and collecting would return it instead of this read.
+    collectCapturedFrames(true);
+    if (m_readback->pending() != 0) {
+        std::cerr << "Could not read back " << width << "x" << height << " pixels: earlier reads are still "
+                  << "in flight" << std::endl;
+        return;
+    }
+
+    CS123::GL::PixelReadback::Frame frame;
+    if (!m_readback->request(width, height) || !m_readback->collect(frame, true)) {
+        std::cerr << "Could not read back " << width << "x" << height << " pixels" << std::endl;
+        return;
+    }
+    // The readback already flipped it so the top row comes first, like the 2D canvas expects.
+    std::memcpy(data, frame.pixels.data(), frame.pixels.size());
     std::cout << "copied " << width << "x" << height << std::endl;
+}
+
+void SupportCanvas3D::setFrameCapture(std::function<void(const CS123::GL::PixelReadback::Frame&)> callback) {
+    if (!callback && m_frameCapture && m_readback) {
+        makeCurrent();
+        collectCapturedFrames(true);
+    }
+    m_frameCapture = callback;
+}
+
+bool SupportCanvas3D::exportFrames(FrameWriter &writer, int width, int height, int frames, int ticksPerFrame) {
+    // winId() creates the native window, and with it the context, even if it is never shown.
+    winId();
+    makeCurrent();
+    if (!m_readback) glInit();
+
+    m_timer.stop();
+    if (m_settingsPending) applySettings();
+    setSceneToShapes();
+    m_shapesScene->finishLoading();
+
+    // The FBO sets its own viewport and the camera takes the export's aspect ratio; both go back
+    // to the window's when the export is done.
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+
+    CS123::GL::FBO fbo(1, CS123::GL::FBO::DEPTH_STENCIL_ATTACHMENT::DEPTH_ONLY, width, height,
+                       CS123::GL::TextureParameters::WRAP_METHOD::CLAMP_TO_EDGE);
+    getCamera()->setAspectRatio(static_cast<float>(width) / static_cast<float>(height));
+
+    // Three stages overlap: the CPU simulates frame n+1 while the GPU draws and reads back frame
+    // n, and the writer thread encodes whatever has been read back. Each stage only waits when
+    // the next one is a full ring (or queue) behind.
+    CS123::GL::PixelReadback::Frame frame;
+    auto handOver = [&](bool wait) {
+        while (m_readback->collect(frame, wait)) {
+            writer.push(frame.width, frame.height, std::move(frame.pixels));
+        }
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < frames; i++) {
+        PROFILE_SCOPE("export frame");
+        for (int t = 0; t < ticksPerFrame; t++) {
+            m_shapesScene->tick(m_tick++ / m_fps);
+        }
+
+        fbo.bind();
+        m_shapesScene->render(this);
+        while (!m_readback->request(width, height)) {
+            if (m_readback->collect(frame, true)) {
+                writer.push(frame.width, frame.height, std::move(frame.pixels));
+            }
+        }
+        fbo.unbind();
+
+        handOver(false);
+    }
+    while (m_readback->pending() > 0) {
+        handOver(true);
+    }
+    bool written = writer.finish();
+
+    std::chrono::duration<float> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "Exported " << writer.framesWritten() << " frames in " << elapsed.count() << " s ("
+              << writer.framesWritten() / elapsed.count() << " fps)" << std::endl;
+
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    getCamera()->setAspectRatio(static_cast<float>(width()) / static_cast<float>(height()));
+    m_timer.start(1000.0f / m_fps);
+    return written;
+}
+
+bool SupportCanvas3D::saveCheckpoint(const std::string &path) {
+    if (!m_shapesScene) return false;
+
+    return m_shapesScene->saveCheckpoint(path);
+}
 
-    // Flip the image and since OpenGL uses an origin in the lower left and we an origin in the
-    // upper left.
-    for (int y = 0; y < (height + 1) / 2; y++)
-        for (int x = 0; x < width; x++)
-            std::swap(data[x + y * width], data[x + (height - y - 1) * width]);
+void SupportCanvas3D::prepareShapesScene() {
+    // Like exportFrames(), make sure there is a context and a shapes scene even while hidden.
+    winId();
+    makeCurrent();
+    if (!m_readback) glInit();
+    if (m_settingsPending) applySettings();
+    setSceneToShapes();
+}
+
+bool SupportCanvas3D::loadCheckpoint(const std::string &path) {
+    prepareShapesScene();
+    bool loaded = m_shapesScene->loadCheckpoint(path);
+    update();
+    return loaded;
+}
+
+bool SupportCanvas3D::setRenderMesh(const std::string &path) {
+    prepareShapesScene();
+    bool loaded = m_shapesScene->setRenderMesh(path);
+    update();
+    return loaded;
+}
+
+bool SupportCanvas3D::startRecording(const std::string &path, int every) {
+    prepareShapesScene();
+    return m_shapesScene->startRecording(path, every);
+}
+
+void SupportCanvas3D::stopRecording() {
+    if (m_shapesScene) m_shapesScene->stopRecording();
+}
+
+bool SupportCanvas3D::isRecording() const {
+    return m_shapesScene && m_shapesScene->isRecording();
+}
+
+bool SupportCanvas3D::startPlayback(const std::string &path) {
+    prepareShapesScene();
+    bool playing = m_shapesScene->startPlayback(path);
+    update();
+    return playing;
+}
+
+void SupportCanvas3D::stopPlayback() {
+    if (m_shapesScene) m_shapesScene->stopPlayback();
+}
+
+bool SupportCanvas3D::isPlaying() const {
+    return m_shapesScene && m_shapesScene->isPlaying();
+}
+
+int SupportCanvas3D::playbackFrameCount() const {
+    return m_shapesScene ? m_shapesScene->playbackFrameCount() : 0;
+}
+
+int SupportCanvas3D::playbackFrame() const {
+    return m_shapesScene ? m_shapesScene->playbackFrame() : 0;
+}
+
+void SupportCanvas3D::seekPlayback(int frame) {
+    if (!m_shapesScene) return;
+
+    // The shape's buffers are rewritten, which needs the context.
+    makeCurrent();
+    m_shapesScene->seekPlayback(frame);
+    update();
+}
+
+bool SupportCanvas3D::saveProfile(const std::string &path) {
+    if (!m_shapesScene) return false;
+
+    m_shapesScene->gpuProfiler().report(std::cout);
+    return m_shapesScene->gpuProfiler().writeCSV(path);
+}
+
+void SupportCanvas3D::collectCapturedFrames(bool wait) {
+    while (m_readback->collect(m_capturedFrame, wait)) {
+        if (m_frameCapture) m_frameCapture(m_capturedFrame);
+    }
 }
 
 void SupportCanvas3D::resetUpVector() {
@@ -293,7 +518,11 @@ void SupportCanvas3D::resizeEvent(QResizeEvent *event) {
 /** Repaints the canvas. Called 60 times per second. */
 void SupportCanvas3D::tick()
 {
+    PROFILE_SCOPE("tick");
     float time = m_tick++ / (float) m_fps;
+    if (m_settingsPending) {
+        applySettings();
+    }
     if (m_currentScene){
         m_currentScene->tick(time);
         update();
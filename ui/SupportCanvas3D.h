@@ -1,6 +1,8 @@
 #ifndef SUPPORTCANVAS3D_H
 #define SUPPORTCANVAS3D_H
 
+#include <chrono>
+#include <functional>
 #include <memory>
 
 #include "GL/glew.h"
@@ -9,6 +11,8 @@
 #include "glm/glm.hpp"
 #include <QTimer>
 
+#include "gl/util/PixelReadback.h"
+
 class RGBA;
 class Camera;
 class OpenGLScene;
@@ -17,8 +21,13 @@ class SceneviewScene;
 class OrbitingCamera;
 class CamtransCamera;
 class CS123XmlSceneParser;
+class FrameWriter;
 class QGLShaderProgram;
 
+namespace CS123 { namespace GL {
+    class ProgramBinaryCache;
+}}
+
 /**
  * @class  SupportCanvas3D
  *
@@ -54,9 +63,51 @@ public:
     // order and RGBA data format.
     void copyPixels(int width, int height, RGBA *data);
 
-    // This function will be called by the UI when the settings have changed.
+    // While set, every frame drawn is read back and handed to the callback. The reads are
+    // asynchronous, so frames arrive a frame or two late but the render loop never waits on them.
+    // Pass nullptr to stop; frames still in flight are delivered first.
+    void setFrameCapture(std::function<void(const CS123::GL::PixelReadback::Frame&)> callback);
+
+    // Renders the shapes scene offscreen at a fixed size, ticking the simulation ticksPerFrame
+    // times per frame regardless of the display timer, and hands every frame to the writer. Works
+    // whether or not the window has been shown. Returns false if the writer failed.
+    bool exportFrames(FrameWriter &writer, int width, int height, int frames, int ticksPerFrame);
+
+    // Save and restore the shapes scene's simulation; see ShapesScene. Loading works before the
+    // window has been shown.
+    bool saveCheckpoint(const std::string &path);
+    bool loadCheckpoint(const std::string &path);
+
+    // Draws an OBJ over the shapes scene's lattice; see ShapesScene. Works before the window has
+    // been shown.
+    bool setRenderMesh(const std::string &path);
+
+    // Trajectory recording and playback in the shapes scene; see ShapesScene. Both work before
+    // the window has been shown.
+    bool startRecording(const std::string &path, int every);
+    void stopRecording();
+    bool isRecording() const;
+    bool startPlayback(const std::string &path);
+    void stopPlayback();
+    bool isPlaying() const;
+    int playbackFrameCount() const;
+    int playbackFrame() const;
+    void seekPlayback(int frame);
+
+    // Rate the display timer ticks the simulation at, once per tick.
+    float getTargetFps() const { return m_fps; }
+
+    // Prints the per-pass render timings and writes them to path. Returns false if nothing has
+    // been profiled or the file can't be written.
+    bool saveProfile(const std::string &path);
+
+    // This function will be called by the UI when the settings have changed. Changes are
+    // coalesced and reach the scene before the next tick or frame.
     virtual void settingsChanged();
 
+    // Milliseconds from construction until the first frame finished drawing, or -1 before then.
+    float timeToFirstFrame() const { return m_timeToFirstFrame; }
+
 public slots:
     // These will be called by the corresponding UI buttons on the Camtrans dock
     void resetUpVector();
@@ -98,19 +149,27 @@ protected slots:
 private:
 
     void initializeGlew();
+    void initializeShaderCache();
     void initializeOpenGLSettings();
-    void initializeScenes();
+    void recordFirstFrame();
+    void collectCapturedFrames(bool wait);
     void setSceneFromSettings();
+    void applySettings();
     void setSceneToSceneview();
     void setSceneToShapes();
 
+    // Creates the context and the shapes scene if they don't exist yet, even while hidden.
+    void prepareShapesScene();
+
     glm::vec4      m_cameraEye;
     bool           m_isDragging;
 
     bool m_settingsDirty;
+    bool m_settingsPending; // settingsChanged() since the last applySettings()
 
     std::unique_ptr<CamtransCamera> m_defaultPerspectiveCamera;
     std::unique_ptr<OrbitingCamera> m_defaultOrbitingCamera;
+    std::unique_ptr<CS123::GL::ProgramBinaryCache> m_programBinaryCache;
     OpenGLScene *m_currentScene;
     std::unique_ptr<ShapesScene> m_shapesScene;
     std::unique_ptr<SceneviewScene> m_sceneviewScene;
@@ -123,6 +182,13 @@ private:
 
     /** Incremented on every call to paintGL. */
     int m_increment;
+
+    std::chrono::steady_clock::time_point m_startTime;
+    float m_timeToFirstFrame;
+
+    std::unique_ptr<CS123::GL::PixelReadback> m_readback;
+    std::function<void(const CS123::GL::PixelReadback::Frame&)> m_frameCapture;
+    CS123::GL::PixelReadback::Frame m_capturedFrame;
 };
 
 #endif // SUPPORTCANVAS3D_H
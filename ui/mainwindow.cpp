@@ -8,9 +8,27 @@
 #include "scenegraph/SceneviewScene.h"
 #include "camera/CamtransCamera.h"
 #include "CS123XmlSceneParser.h"
+#include "SkyboxLibrary.h"
+#include "shapes/Checkpoint.h"
+#include "shapes/EnergyMonitor.h"
+#include "shapes/Trajectory.h"
+#include "FrameWriter.h"
+#include "PerformanceMonitor.h"
+#include "Profiler.h"
+#include <iostream>
 #include <math.h>
+#include <algorithm>
+#include <cmath>
 #include <QFileDialog>
+#include <QInputDialog>
 #include <QMessageBox>
+#include <QPainter>
+#include <QPixmap>
+#include <QDateTime>
+#include <QDir>
+#include <QShortcut>
+#include <QStandardPaths>
+#include <QTimer>
 
 MainWindow::MainWindow(QWidget *parent) :
     QMainWindow(parent),
@@ -53,6 +71,8 @@ MainWindow::MainWindow(QWidget *parent) :
     SETUP_ACTION(shapesDock,    "CTRL+3");
     SETUP_ACTION(camtransDock,  "CTRL+4");
 //    SETUP_ACTION(rayDock,       "CTRL+5");
+    SETUP_ACTION(metricsDock,   "CTRL+6");
+    SETUP_ACTION(playbackDock,  "CTRL+7");
 
     ui->menuToolbars->addActions(actions);
 #undef SETUP_ACTION
@@ -197,6 +217,9 @@ void MainWindow::dataBind() {
     BIND(BoolBinding::bindCheckbox(ui->drawNormalsCheckbox, settings.drawNormals))
     BIND(BoolBinding::bindCheckbox(ui->usePlaneCheckbox, settings.usePlane))
     BIND(BoolBinding::bindCheckbox(ui->fallCameraY, settings.fallCameraY))
+    BIND(BoolBinding::bindCheckbox(ui->chromaticRefractionCheckbox, settings.useChromaticRefraction))
+    BIND(IntBinding::bindTextbox(ui->renderDetailTextbox, settings.renderDetail))
+    BIND(IntBinding::bindTextbox(ui->surfaceSmoothingTextbox, settings.surfaceSmoothing))
 
     // Camtrans dock
     BIND(BoolBinding::bindCheckbox(ui->cameraOrbitCheckbox, settings.useOrbitCamera))
@@ -224,10 +247,291 @@ void MainWindow::dataBind() {
 
 #undef BIND
 
+    // The skybox sets come from the textures/ folder, so the list is only known at runtime.
+    for (const SkyboxSet &set : SkyboxLibrary::sets()) {
+        ui->skyboxComboBox->addItem(QString::fromStdString(set.name));
+    }
+    if (const SkyboxSet *skybox = SkyboxLibrary::find(settings.skybox)) {
+        ui->skyboxComboBox->setCurrentText(QString::fromStdString(skybox->name));
+    }
+    connect(ui->skyboxComboBox, SIGNAL(currentIndexChanged(int)), this, SLOT(setSkybox(int)));
+
+    // F12 dumps the recent CPU/GPU timeline, e.g. right after a hitch.
+    connect(new QShortcut(QKeySequence(Qt::Key_F12), this), SIGNAL(activated()), this, SLOT(saveTrace()));
+
+    // The monitor samples on its own thread; the panel only copies its latest numbers.
+    m_performanceMonitor = std::make_unique<PerformanceMonitor>(m_canvas3D->getTargetFps());
+    QTimer *metricsTimer = new QTimer(this);
+    connect(metricsTimer, SIGNAL(timeout()), this, SLOT(updateMetrics()));
+    metricsTimer->start(500);
+
+    // The playback panel only shows up once a trajectory is played.
+    ui->playbackDock->hide();
+    QTimer *playbackTimer = new QTimer(this);
+    connect(playbackTimer, SIGNAL(timeout()), this, SLOT(updatePlayback()));
+    playbackTimer->start(100);
+
     // make sure the aspect ratio updates when m_canvas3D changes size
     connect(m_canvas3D, SIGNAL(aspectRatioChanged()), this, SLOT(updateAspectRatio()));
 }
 
+bool MainWindow::exportFrames(FrameWriter &writer, int width, int height, int frames, int ticksPerFrame) {
+    return m_canvas3D->exportFrames(writer, width, height, frames, ticksPerFrame);
+}
+
+void MainWindow::setFrameCapture(FrameWriter *writer) {
+    if (!writer) {
+        m_canvas3D->setFrameCapture(nullptr);
+        return;
+    }
+    // The readback reuses its frame's storage, so the writer gets a copy.
+    m_canvas3D->setFrameCapture([writer](const CS123::GL::PixelReadback::Frame &frame) {
+        writer->push(frame.width, frame.height, std::vector<unsigned char>(frame.pixels));
+    });
+}
+
+bool MainWindow::saveProfile(const std::string &path) {
+    return m_canvas3D->saveProfile(path);
+}
+
+void MainWindow::updateMetrics() {
+    if (!ui->metricsDock->isVisible()) return;
+
+    PerformanceMonitor::Snapshot snapshot = m_performanceMonitor->snapshot();
+    QString rows;
+    auto addRow = [&](const QString &name, const QString &value) {
+        rows += "<tr><td>" + name.toHtmlEscaped() + "</td><td align=right>" + value + "</td></tr>";
+    };
+
+    QString steps = QString("%1 / %2").arg(snapshot.stepsPerSecond, 0, 'f', 1).arg(snapshot.targetStepsPerSecond, 0, 'f', 0);
+    if (snapshot.overBudget) steps = "<font color=red>" + steps + " over budget</font>";
+    addRow("Sim steps/s", steps);
+    addRow("Real-time factor", QString("%1x").arg(snapshot.realTimeFactor, 0, 'f', 3));
+    addRow("Frames/s", QString::number(snapshot.framesPerSecond, 'f', 1));
+    addRow("Frame p50 / p99", QString("%1 / %2 ms").arg(snapshot.frameMsP50, 0, 'f', 2).arg(snapshot.frameMsP99, 0, 'f', 2));
+    addRow("Allocations/tick", snapshot.allocationsPerTick < 0 ? QString("not tracked (CONFIG+=track_allocations)")
+                                                               : QString::number(snapshot.allocationsPerTick));
+    addRow("Vertex upload/frame", QString("%1 KB").arg(snapshot.vertexBytesPerFrame / 1024.0f, 0, 'f', 1));
+
+    std::vector<EnergyMonitor::Sample> energy = EnergyMonitor::history();
+    if (!energy.empty()) {
+        const JelloUtil::Diagnostics &latest = energy.back().diagnostics;
+        rows += "<tr><td colspan=2><b>Energy</b></td></tr>";
+        EnergyMonitor::Sample blowUp;
+        if (EnergyMonitor::blownUp(&blowUp)) {
+            addRow("Blow-up", QString("<font color=red>at step %1</font>").arg(blowUp.step));
+        }
+        addRow("Total", QString::number(latest.total(), 'g', 6));
+        addRow("Kinetic", QString::number(latest.kinetic, 'g', 6));
+        addRow("Spring", QString::number(latest.spring, 'g', 6));
+        addRow("Gravity", QString::number(latest.gravity, 'g', 6));
+        addRow("Collision", QString::number(latest.collision, 'g', 6));
+        addRow("|Momentum|", QString::number(glm::length(latest.momentum), 'g', 4));
+    }
+    plotEnergy();
+
+    rows += "<tr><td colspan=2><b>ms per frame</b></td></tr>";
+    for (const PerformanceMonitor::Stage &stage : snapshot.stages) {
+        addRow(QString::fromStdString(stage.name), QString::number(stage.msPerFrame, 'f', 3));
+    }
+    ui->metricsLabel->setText("<table cellspacing=2>" + rows + "</table>");
+}
+
+void MainWindow::plotEnergy() {
+    std::vector<EnergyMonitor::Sample> history = EnergyMonitor::history();
+    QPixmap plot(240, 100);
+    plot.fill(Qt::black);
+    if (history.size() < 2) {
+        ui->energyPlotLabel->setPixmap(plot);
+        return;
+    }
+
+    // Every series shares one vertical scale, so their exchanges can be compared directly.
+    auto series = [](const JelloUtil::Diagnostics &d, int which) {
+        switch (which) {
+            case 0: return d.total();
+            case 1: return d.kinetic;
+            case 2: return d.spring;
+            case 3: return d.gravity;
+            default: return d.collision;
+        }
+    };
+    const int SERIES = 5;
+    const QColor colors[SERIES] = { Qt::white, Qt::red, Qt::green, QColor(80, 140, 255), Qt::yellow };
+
+    double low = series(history[0].diagnostics, 0), high = low;
+    for (const EnergyMonitor::Sample &sample : history) {
+        for (int which = 0; which < SERIES; which++) {
+            double value = series(sample.diagnostics, which);
+            if (!std::isfinite(value)) continue;
+            low = std::min(low, value);
+            high = std::max(high, value);
+        }
+    }
+    if (high - low < 1e-9) high = low + 1e-9;
+
+    QPainter painter(&plot);
+    for (int which = SERIES - 1; which >= 0; which--) {
+        painter.setPen(colors[which]);
+        QPolygonF line;
+        for (size_t i = 0; i < history.size(); i++) {
+            double value = series(history[i].diagnostics, which);
+            if (!std::isfinite(value)) break;
+            line << QPointF(i * (plot.width() - 1.0) / (EnergyMonitor::HISTORY - 1),
+                            (plot.height() - 1) * (high - value) / (high - low));
+        }
+        painter.drawPolyline(line);
+    }
+    painter.end();
+    ui->energyPlotLabel->setPixmap(plot);
+}
+
+bool MainWindow::saveCheckpoint(const std::string &path) {
+    return m_canvas3D->saveCheckpoint(path);
+}
+
+bool MainWindow::setRenderMesh(const std::string &path) {
+    return m_canvas3D->setRenderMesh(path);
+}
+
+bool MainWindow::loadCheckpoint(const std::string &path) {
+    {
+        Checkpoint checkpoint(path);
+        if (!checkpoint.isValid()) return false;
+        const SimulationState &state = checkpoint.state();
+
+        // Show the checkpoint's shape and constants first. A new shape or resolution rebuilds the
+        // cube, so only the controls that differ are touched, and the state is restored after.
+        QRadioButton *shapeButtons[NUM_SHAPE_TYPES] = { ui->shapeTypeCube, ui->shapeTypeJelloCube, ui->shapeTypeSMCube };
+        if (state.shapeType != settings.shapeType && state.shapeType >= 0 && state.shapeType < NUM_SHAPE_TYPES) {
+            shapeButtons[state.shapeType]->click();
+        }
+        if (state.param1 != settings.shapeParameter1) {
+            ui->shapeParameterTextbox1->setText(QString::number(state.param1));
+        }
+        auto showValue = [](QLineEdit *textbox, float current, float value) {
+            if (current != value) textbox->setText(QString::number(value));
+        };
+        showValue(ui->kElastic, settings.kElastic, state.kElastic);
+        showValue(ui->dElastic, settings.dElastic, state.dElastic);
+        showValue(ui->kCollision, settings.kCollision, state.kCollision);
+        showValue(ui->dCollision, settings.dCollision, state.dCollision);
+        showValue(ui->mass, settings.mass, state.mass);
+        showValue(ui->gravity, settings.gravity, glm::length(state.gravity));
+    }
+    return m_canvas3D->loadCheckpoint(path);
+}
+
+void MainWindow::fileSaveCheckpoint() {
+    QString file = QFileDialog::getSaveFileName(this, "Save Simulation Checkpoint", QString(), "Checkpoints (*.jckp)");
+    if (file.isNull()) return;
+    if (!file.endsWith(".jckp")) file += ".jckp";
+    saveCheckpoint(file.toStdString());
+}
+
+void MainWindow::fileLoadCheckpoint() {
+    QString file = QFileDialog::getOpenFileName(this, "Load Simulation Checkpoint", QString(), "Checkpoints (*.jckp)");
+    if (file.isNull()) return;
+    activateCanvas3D();
+    loadCheckpoint(file.toStdString());
+}
+
+void MainWindow::showRecording(bool recording) {
+    // Checks or unchecks the action without toggling the recording again.
+    ui->actionRecordTrajectory->blockSignals(true);
+    ui->actionRecordTrajectory->setChecked(recording);
+    ui->actionRecordTrajectory->blockSignals(false);
+}
+
+bool MainWindow::startRecording(const std::string &path, int every) {
+    bool recording = m_canvas3D->startRecording(path, every);
+    showRecording(recording);
+    return recording;
+}
+
+bool MainWindow::startPlayback(const std::string &path) {
+    {
+        TrajectoryReader trajectory(path);
+        if (!trajectory.isValid()) return false;
+        const TrajectoryHeader &header = trajectory.header();
+
+        // As in loadCheckpoint(), only the controls that differ are touched.
+        QRadioButton *shapeButtons[NUM_SHAPE_TYPES] = { ui->shapeTypeCube, ui->shapeTypeJelloCube, ui->shapeTypeSMCube };
+        if (header.shapeType != settings.shapeType && header.shapeType >= 0 && header.shapeType < NUM_SHAPE_TYPES) {
+            shapeButtons[header.shapeType]->click();
+        }
+        if (header.param1 != settings.shapeParameter1) {
+            ui->shapeParameterTextbox1->setText(QString::number(header.param1));
+        }
+    }
+    if (!m_canvas3D->startPlayback(path)) return false;
+
+    // Starting playback ended any recording.
+    showRecording(false);
+    ui->playbackDock->show();
+    updatePlayback();
+    return true;
+}
+
+void MainWindow::fileRecordTrajectory(bool record) {
+    if (!record) {
+        m_canvas3D->stopRecording();
+        return;
+    }
+
+    QString file = QFileDialog::getSaveFileName(this, "Record Trajectory", QString(), "Trajectories (*.jtrj)");
+    bool ok = !file.isNull();
+    int every = ok ? QInputDialog::getInt(this, "Record Trajectory", "Record every Nth step:", 1, 1, 1000, 1, &ok) : 0;
+    if (!ok) {
+        showRecording(false);
+        return;
+    }
+    if (!file.endsWith(".jtrj")) file += ".jtrj";
+    activateCanvas3D();
+    startRecording(file.toStdString(), every);
+}
+
+void MainWindow::filePlayTrajectory() {
+    QString file = QFileDialog::getOpenFileName(this, "Play Trajectory", QString(), "Trajectories (*.jtrj)");
+    if (file.isNull()) return;
+    activateCanvas3D();
+    startPlayback(file.toStdString());
+}
+
+void MainWindow::fileStopPlayback() {
+    m_canvas3D->stopPlayback();
+    updatePlayback();
+}
+
+void MainWindow::seekPlayback(int frame) {
+    m_canvas3D->seekPlayback(frame);
+}
+
+void MainWindow::updatePlayback() {
+    // A recording also stops by itself when the cube is rebuilt at another size.
+    showRecording(m_canvas3D->isRecording());
+    if (!ui->playbackDock->isVisible()) return;
+
+    bool playing = m_canvas3D->isPlaying();
+    int frames = m_canvas3D->playbackFrameCount();
+    ui->playbackSlider->blockSignals(true);
+    ui->playbackSlider->setEnabled(playing);
+    ui->playbackSlider->setRange(0, std::max(frames - 1, 0));
+    ui->playbackSlider->setValue(m_canvas3D->playbackFrame());
+    ui->playbackSlider->blockSignals(false);
+    ui->playbackLabel->setText(playing ? QString("%1 / %2").arg(m_canvas3D->playbackFrame() + 1).arg(frames)
+                                       : QString("Not playing"));
+}
+
+void MainWindow::saveTrace() {
+    QString directory = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/traces";
+    QDir().mkpath(directory);
+    QString path = directory + "/trace-" + QDateTime::currentDateTime().toString("yyyyMMdd-hhmmss") + ".json";
+    if (Profiler::writeChromeTrace(path.toStdString())) {
+        std::cout << "Wrote trace to " << path.toStdString() << " (open it in chrome://tracing)" << std::endl;
+    }
+}
+
 void MainWindow::changeEvent(QEvent *e) {
     QMainWindow::changeEvent(e); // allow the superclass to handle this for the most part...
 
@@ -267,6 +571,14 @@ void MainWindow::settingsChanged() {
     m_canvas3D->settingsChanged();
 }
 
+void MainWindow::setSkybox(int index) {
+    const std::vector<SkyboxSet> &sets = SkyboxLibrary::sets();
+    if (index < 0 || index >= static_cast<int>(sets.size())) return;
+
+    settings.skybox = sets[index].name;
+    settingsChanged();
+}
+
 void MainWindow::setAllRayFeatures(bool checked) {
 //    ui->raySuperSamping->setChecked(checked);
 //    ui->rayAntiAliasing->setChecked(checked);
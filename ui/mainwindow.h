@@ -2,11 +2,14 @@
 #define MAINWINDOW_H
 
 #include <memory>
+#include <string>
 
 #include <QButtonGroup>
 #include <QMainWindow>
 
 class CS123XmlSceneParser;
+class FrameWriter;
+class PerformanceMonitor;
 class SupportCanvas3D;
 
 namespace Ui {
@@ -26,6 +29,29 @@ public:
     MainWindow(QWidget *parent = 0);
     ~MainWindow();
 
+    // Renders frames offscreen for the --export command line mode; see SupportCanvas3D::exportFrames.
+    bool exportFrames(FrameWriter &writer, int width, int height, int frames, int ticksPerFrame);
+
+    // Hands every frame the window draws to writer, for the --capture command line option; see
+    // SupportCanvas3D::setFrameCapture. Pass nullptr to stop once frames still in flight are written.
+    void setFrameCapture(FrameWriter *writer);
+
+    // Writes the render pass timings for the --profile command line option.
+    bool saveProfile(const std::string &path);
+
+    // Save and restore the simulation, for the File menu and the --save-checkpoint and
+    // --load-checkpoint command line options. Loading also updates the simulation controls.
+    bool saveCheckpoint(const std::string &path);
+    bool loadCheckpoint(const std::string &path);
+
+    // Record or replay a trajectory, for the File menu and the --record and --play command line
+    // options. Playback also updates the shape controls.
+    bool startRecording(const std::string &path, int every);
+    bool startPlayback(const std::string &path);
+
+    // Draws an OBJ over the lattice, for the --render-mesh command line option.
+    bool setRenderMesh(const std::string &path);
+
 protected:
 
     // Overridden from QWidget. Handles the window resize event.
@@ -46,6 +72,12 @@ private:
     // Sets up the data bindings between the UI and app settings
     void dataBind();
 
+    // Draws the recent energy time series into the metrics panel.
+    void plotEnergy();
+
+    // Updates the Record Trajectory action to match the canvas.
+    void showRecording(bool recording);
+
     // initializes settings and ui for camtrans viewing frustum
     void initializeCamtransFrustum();
 
@@ -54,6 +86,7 @@ private:
     QList<QButtonGroup*> m_buttonGroups;
     SupportCanvas3D *m_canvas3D;
     std::unique_ptr<CS123XmlSceneParser> m_sceneParser;
+    std::unique_ptr<PerformanceMonitor> m_performanceMonitor;
 
     // EXCEPTION: 'ui' member which is auto-generated by Qt. DO NOT RENAME!
     Ui::MainWindow *ui;
@@ -65,6 +98,15 @@ public slots:
     // Used internally to keep data bindings and the user interface in sync.
     void settingsChanged();
 
+    // Switches the glass to the skybox set at this index in the skybox combo box.
+    void setSkybox(int index);
+
+    // Redraws the metrics panel from the performance monitor's latest sample, if it's showing.
+    void updateMetrics();
+
+    // Writes the profiler's recent timeline as Chrome trace JSON to the app cache directory.
+    void saveTrace();
+
     // Copy the contents of the 3D tab to the 2D tab
     void fileCopy3Dto2D();
 
@@ -74,6 +116,24 @@ public slots:
     // Displays a dialog box to open a 2D image or 3D scene file.
     void fileOpen();
 
+    // Display a dialog box to save or restore the simulation as a binary checkpoint.
+    void fileSaveCheckpoint();
+    void fileLoadCheckpoint();
+
+    // Starts recording a trajectory to a file picked in a dialog box, or stops the recording.
+    void fileRecordTrajectory(bool record);
+
+    // Display a dialog box to play a recorded trajectory, or go back to simulating.
+    void filePlayTrajectory();
+    void fileStopPlayback();
+
+    // Shows this frame of the trajectory being played back.
+    void seekPlayback(int frame);
+
+    // Keeps the playback panel's slider and frame counter, and the Record Trajectory action, in
+    // step with the canvas.
+    void updatePlayback();
+
     // Displays a dialog box to save the current 2D image. Can be extended (for extra credit) to
     // save the current 3D scene.
     void fileSave();